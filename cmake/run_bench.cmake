@@ -0,0 +1,26 @@
+# Runs cppinfer_bench for the bench target, at build time: the commit is read when the target
+# runs, so bench-<commit>.json always names the checked-out commit (not the one at configure).
+#
+#   cmake -DBENCH=<cppinfer_bench> -DSOURCE_DIR=<repo> -DOUT_DIR=<dir> -P run_bench.cmake
+execute_process(
+    COMMAND git rev-parse --short HEAD
+    WORKING_DIRECTORY "${SOURCE_DIR}"
+    OUTPUT_VARIABLE commit
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    ERROR_QUIET)
+if(NOT commit)
+    set(commit unknown)
+endif()
+
+execute_process(
+    COMMAND "${BENCH}"
+        --benchmark_out=${OUT_DIR}/bench-${commit}.json
+        --benchmark_out_format=json
+        --benchmark_repetitions=5
+        --benchmark_report_aggregates_only=true
+        --benchmark_context=git_commit=${commit}
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "cppinfer_bench failed (${result})")
+endif()
+message(STATUS "wrote ${OUT_DIR}/bench-${commit}.json")
@@ -4,4 +4,5 @@ struct Det {
     float x1, y1, x2, y2; // original image pixels
     int class_id;
     float score;
+    int track_id = -1;    // Tracker: same object, same id across frames; -1 = not tracked
 };
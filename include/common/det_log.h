@@ -0,0 +1,188 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/det.h"
+
+// Append-only binary log of every detection, for audit and replay.
+//
+// File: a 64-byte file header, then self-contained blocks of up to Options::block_rows rows
+// (one row per Det). A block is a 128-byte header followed by one column per field:
+//
+//   stream_id, pts_us, class_id, track_id   integers; packed blocks store pts as deltas from the
+//                                           previous row and every integer column frame-of-
+//                                           reference + bit-packed (a few bits per value)
+//   x1, y1, x2, y2, score                   float32, raw (lossless)
+//
+// The block header holds the time range [t_min, t_max] and a class bitmask, so a reader skips
+// whole blocks by time / class without touching their columns. Rows of one block need not be in
+// time order (several streams interleave). A block cut short by a crash is ignored on read.
+//
+// Blocks are built in memory by Append() (a few push_backs under a mutex) and encoded and
+// written by a background thread.
+namespace detlog {
+
+    constexpr uint32_t kVersion = 1;
+
+    enum Column : int {
+        kStream, kPts, kClass, kTrack,  // integer columns (packed in packed blocks)
+        kX1, kY1, kX2, kY2, kScore,
+        kNumColumns,
+    };
+    constexpr int kNumIntColumns = 4;
+
+    struct FileHeader {
+        char magic[8];            // "CPDETLOG"
+        uint32_t version;
+        uint32_t header_bytes;    // sizeof(FileHeader)
+        uint8_t reserved[48];
+    };
+
+    struct BlockHeader {
+        uint32_t magic;           // "BLK1"
+        uint32_t rows;
+        int64_t t_min;            // pts_us range of the rows
+        int64_t t_max;
+        uint64_t class_mask;      // bit min(class_id, 63) for every class in the block
+        uint32_t payload_bytes;   // columns, multiple of 8
+        uint32_t packed;
+        uint32_t offset[kNumColumns];    // column start within the payload, 8-byte aligned
+        uint8_t width[kNumIntColumns];   // packed: bits per value
+        int64_t base[kNumIntColumns];    // packed: value subtracted before packing
+        uint8_t reserved[16];
+    };
+
+    static_assert(sizeof(FileHeader) == 64, "detlog::FileHeader layout");
+    static_assert(sizeof(BlockHeader) == 128, "detlog::BlockHeader layout");
+
+    struct Record {
+        uint32_t stream_id;
+        int64_t pts_us;
+        Det det;
+    };
+
+} // namespace detlog
+
+class DetLogWriter {
+public:
+    struct Options {
+        int block_rows = 4096;
+        bool packed = true;          // delta / bit-packed integer columns (~25 instead of 40 bytes a row)
+        int flush_interval_ms = 1000; // a partial block is written after this long at the latest
+    };
+
+    // Appends to an existing log (or creates it). Throws if the file is not a detection log.
+    explicit DetLogWriter(const std::string& path);
+    DetLogWriter(const std::string& path, const Options& opt);
+    ~DetLogWriter();
+
+    DetLogWriter(const DetLogWriter&) = delete;
+    DetLogWriter& operator=(const DetLogWriter&) = delete;
+
+    // Thread-safe, never waits for the disk
+    void Append(uint32_t stream_id, int64_t pts_us, const std::vector<Det>& dets);
+
+    // Writes everything appended so far and returns when it is on disk (as far as the OS goes)
+    void Flush();
+
+    // Flush and stop the writer thread; called by the destructor
+    void Close();
+
+    uint64_t Rows() const;          // appended
+    uint64_t BytesWritten() const;  // file bytes written by this writer
+    bool Failed() const;            // a write error; further rows are discarded
+
+private:
+    struct Block {
+        std::vector<uint32_t> stream;
+        std::vector<int64_t> pts;
+        std::vector<int32_t> cls;
+        std::vector<int32_t> track;
+        std::vector<float> x1, y1, x2, y2, score;
+
+        size_t Rows() const { return pts.size(); }
+        void Reserve(size_t n);
+    };
+
+    void Seal();  // mu_ held
+    void Loop();
+    size_t WriteBlock(const Block& b);  // bytes written
+
+private:
+    std::string path_;
+    Options opt_;
+    std::ofstream file_;
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    Block cur_;
+    std::deque<Block> sealed_;
+    uint64_t sealed_count_ = 0;
+    uint64_t written_count_ = 0;
+    uint64_t rows_ = 0;
+    uint64_t bytes_ = 0;
+    bool failed_ = false;
+    bool closing_ = false;
+    std::thread th_;
+
+    // writer thread only
+    std::vector<uint8_t> buf_;
+};
+
+class DetLogReader {
+public:
+    // [t_begin, t_end) in pts_us; -1 = any class / stream
+    struct Query {
+        int64_t t_begin = std::numeric_limits<int64_t>::min();
+        int64_t t_end = std::numeric_limits<int64_t>::max();
+        int class_id = -1;
+        int64_t stream_id = -1;
+    };
+
+    // Maps the file; blocks appended later are picked up by Refresh()
+    explicit DetLogReader(const std::string& path);
+    ~DetLogReader();
+
+    DetLogReader(const DetLogReader&) = delete;
+    DetLogReader& operator=(const DetLogReader&) = delete;
+
+    // Calls fn for every matching row, block by block in file order. Only the blocks whose time
+    // range and class mask can match are decoded, and of those only the rows that match.
+    void Scan(const Query& q, const std::function<void(const detlog::Record&)>& fn) const;
+    std::vector<detlog::Record> Scan(const Query& q) const;
+
+    // Re-maps the file if it grew and indexes the new blocks
+    void Refresh();
+
+    size_t NumBlocks() const { return blocks_.size(); }
+    uint64_t NumRows() const { return rows_; }
+    int64_t MinTime() const { return t_min_; }
+    int64_t MaxTime() const { return t_max_; }
+
+private:
+    struct Map;
+
+    void Index();
+    void ScanBlock(const detlog::BlockHeader& h, const uint8_t* payload, const Query& q,
+        const std::function<void(const detlog::Record&)>& fn) const;
+
+private:
+    std::string path_;
+    std::unique_ptr<Map> map_;
+    std::vector<size_t> blocks_;  // file offsets of complete blocks
+    size_t indexed_end_ = 0;      // file offset after the last complete block
+    uint64_t rows_ = 0;
+    int64_t t_min_ = std::numeric_limits<int64_t>::max();
+    int64_t t_max_ = std::numeric_limits<int64_t>::min();
+};
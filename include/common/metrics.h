@@ -0,0 +1,225 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Always-on instrumentation: counters, gauges and latency histograms, exported in the Prometheus
+// text format.
+//
+// Hot path: every thread writes only its own shard of a metric with relaxed atomic stores (no
+// locks, no shared cache lines). Recording a sample costs a few ns; a ScopedTimer adds two
+// steady_clock reads. Shards are merged only when exporting.
+namespace metrics {
+
+    using Clock = std::chrono::steady_clock;
+
+    namespace detail {
+
+        // Per-thread shards of one metric. The first use from a thread creates its shard (under a
+        // lock); after that the thread finds it through a thread_local slot table. Shards of
+        // threads that exit are kept (their samples still count). Metrics must not be destroyed
+        // while threads use them, which the Registry guarantees by never removing any.
+        template <typename Shard>
+        class Sharded {
+        public:
+            Shard& Local() {
+                thread_local std::vector<void*> slots;
+                if (id_ < slots.size() && slots[id_]) return *static_cast<Shard*>(slots[id_]);
+
+                std::lock_guard<std::mutex> lk(mu_);
+                shards_.push_back(std::make_unique<Shard>());
+                if (slots.size() <= id_) slots.resize(id_ + 1, nullptr);
+                slots[id_] = shards_.back().get();
+                return *shards_.back();
+            }
+
+            template <typename Fn>
+            void ForEach(Fn fn) const {
+                std::lock_guard<std::mutex> lk(mu_);
+                for (const auto& s : shards_) fn(*s);
+            }
+
+        private:
+            static size_t NextId() {
+                static std::atomic<size_t> next{ 0 };
+                return next++;
+            }
+
+            const size_t id_ = NextId();
+            mutable std::mutex mu_;
+            std::vector<std::unique_ptr<Shard>> shards_;
+        };
+
+        // Single writer per shard: a plain load + store is enough (and cheaper than fetch_add)
+        inline void Bump(std::atomic<uint64_t>& a, uint64_t d) {
+            a.store(a.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+        }
+
+    } // namespace detail
+
+    class Counter {
+    public:
+        void Add(uint64_t n = 1) { detail::Bump(shards_.Local().v, n); }
+        uint64_t Value() const;
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> v{ 0 };
+        };
+        detail::Sharded<Shard> shards_;
+    };
+
+    class Gauge {
+    public:
+        void Set(double v) { v_.store(v, std::memory_order_relaxed); }
+        double Value() const { return v_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<double> v_{ 0.0 };
+    };
+
+    // Latency histogram in nanoseconds with HDR-style log-linear buckets: 16 linear sub-buckets per
+    // power of two, i.e. at most 6.25% relative error, from 1 ns up to ~18 minutes.
+    class Histogram {
+    public:
+        static constexpr int kSubBits = 4;
+        static constexpr int kSub = 1 << kSubBits;
+        static constexpr int kMaxExp = 40;  // larger values are clamped into the last bucket
+        static constexpr int kBuckets = (kMaxExp - kSubBits + 2) * kSub;
+
+        void Record(uint64_t ns) {
+            Shard& s = shards_.Local();
+            detail::Bump(s.counts[Index(ns)], 1);
+            detail::Bump(s.count, 1);
+            detail::Bump(s.sum, ns);
+            if (ns > s.max.load(std::memory_order_relaxed)) s.max.store(ns, std::memory_order_relaxed);
+        }
+
+        void RecordSince(Clock::time_point t0) {
+            const auto d = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+            Record(d > 0 ? static_cast<uint64_t>(d) : 0);
+        }
+
+        struct Snapshot {
+            std::vector<uint64_t> counts;  // kBuckets entries
+            uint64_t count = 0;
+            uint64_t sum = 0;              // ns
+            uint64_t max = 0;              // ns, since the previous TakeSnapshot()
+
+            // q in [0,1]; the representative value (middle) of the bucket holding that rank, in ns
+            double Quantile(double q) const;
+        };
+
+        // Cumulative counts. Also resets the max, so max covers the time between two snapshots.
+        Snapshot TakeSnapshot();
+
+        static int Index(uint64_t ns);
+        static uint64_t BucketLow(int index);
+        static uint64_t BucketHigh(int index);
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> counts[kBuckets] = {};
+            std::atomic<uint64_t> count{ 0 };
+            std::atomic<uint64_t> sum{ 0 };
+            std::atomic<uint64_t> max{ 0 };
+        };
+        detail::Sharded<Shard> shards_;
+    };
+
+    // Records the lifetime of the scope into a histogram
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Histogram& h)
+            : h_(h), t0_(Clock::now()) { }
+        ~ScopedTimer() { h_.RecordSince(t0_); }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Histogram& h_;
+        Clock::time_point t0_;
+    };
+
+    // Owns every metric of the process. Metrics are looked up by name + label set once (keep the
+    // returned reference, e.g. in a function-local static) and live until exit.
+    class Registry {
+    public:
+        static Registry& Global();
+
+        // labels: Prometheus label list without braces, e.g. stage="decode". help is taken from
+        // the first registration of a name.
+        Counter& GetCounter(const std::string& name, const std::string& labels = "", const std::string& help = "");
+        Gauge& GetGauge(const std::string& name, const std::string& labels = "", const std::string& help = "");
+        Histogram& GetHistogram(const std::string& name, const std::string& labels = "", const std::string& help = "");
+
+        // Prometheus text format. Histograms are written as summaries: quantiles 0.5 / 0.95 / 0.99
+        // and <name>_max over the interval since the previous call (NaN if it had no samples),
+        // _sum / _count cumulative. Meant for a single exporter.
+        void WritePrometheus(std::ostream& os);
+
+    private:
+        enum class Type { Counter, Gauge, Histogram };
+
+        struct Entry {
+            std::string labels;
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Gauge> gauge;
+            std::unique_ptr<Histogram> histogram;
+            std::vector<uint64_t> prev_counts;  // histogram: counts at the previous export
+        };
+
+        struct Family {
+            std::string name;
+            std::string help;
+            Type type;
+            std::vector<std::unique_ptr<Entry>> entries;
+        };
+
+        Entry& Get(const std::string& name, const std::string& labels, const std::string& help, Type type);
+
+        std::mutex mu_;
+        std::vector<std::unique_ptr<Family>> families_;
+    };
+
+    // cppinfer_stage_seconds{stage="<stage>"}: per-frame time of one pipeline stage
+    Histogram& Stage(const std::string& stage);
+
+    // cppinfer_frames_dropped_total{where="<where>"}
+    Counter& Dropped(const std::string& where);
+
+    // Rewrites a Prometheus text file every interval_ms (write to <path>.tmp, then rename), e.g.
+    // for node_exporter's textfile collector. Writes a last time when destroyed.
+    class FileExporter {
+    public:
+        explicit FileExporter(std::string path, int interval_ms = 5000, Registry& registry = Registry::Global());
+        ~FileExporter();
+
+        FileExporter(const FileExporter&) = delete;
+        FileExporter& operator=(const FileExporter&) = delete;
+
+        void WriteNow();
+
+    private:
+        void Loop();
+
+        std::string path_;
+        int interval_ms_;
+        Registry& registry_;
+
+        std::mutex mu_;
+        std::condition_variable cv_;
+        bool stop_ = false;
+        std::thread thread_;
+    };
+
+} // namespace metrics
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/det.h"
+
+// SORT / ByteTrack-style multi-object tracker on Det boxes: a constant-velocity Kalman filter
+// per track plus IoU association, so boxes can be reported (predicted) on frames that did not
+// go through inference, and every box carries a stable Det::track_id.
+//
+// Box state is (cx, cy, w, h) and their velocities. With diagonal noise the full 8-dim filter
+// separates into four independent [position, velocity] filters, which is what is stored: a
+// predict + update is a few dozen flops per track.
+//
+// Association is ByteTrack's two passes: high-score detections against all tracks, then the
+// remaining low-score ones against the tracks left over. Candidate pairs come from a sweep over
+// x-sorted boxes (only overlapping pairs get an IoU) and are matched greedily by IoU, which
+// for distinct objects gives the same result as the Hungarian algorithm at a fraction of the
+// cost. A few hundred objects take tens of microseconds per frame.
+//
+// Times are microseconds on any monotonic clock (e.g. Frame::pts_us); velocities are per
+// second, so frames dropped upstream just make a longer step. Not thread-safe: one tracker per
+// stream.
+class Tracker {
+public:
+    struct Options {
+        float high_score = 0.5f;     // detections >= high_score are matched first and may start tracks
+        float match_iou = 0.3f;      // first pass (high-score detections)
+        float low_match_iou = 0.5f;  // second pass (low-score detections, leftover tracks)
+        bool per_class = true;       // only match detections with tracks of the same class
+
+        int min_hits = 2;            // a track is reported (and gets its id) after this many matches
+        double max_coast_s = 0.5;    // keep reporting a predicted box this long after the last match
+        double max_age_s = 1.0;      // forget a track not matched for this long
+        double default_dt_s = 0.04;  // step when timestamps are missing or not increasing
+
+        // Kalman noise, relative to the box size (w for cx / w, h for cy / h)
+        float meas_std = 0.05f;      // detector box jitter
+        float accel_std = 1.0f;      // random acceleration, box sizes / s^2
+        float init_vel_std = 1.5f;   // unknown speed of a new track, box sizes / s
+    };
+
+    Tracker();
+    explicit Tracker(const Options& opt);
+
+    // Frame with detections (t_us: its timestamp). out = confirmed tracks, boxes from the filter
+    // state after this update, class / score from the last matched detection.
+    void Update(const std::vector<Det>& dets, int64_t t_us, std::vector<Det>& out);
+    std::vector<Det> Update(const std::vector<Det>& dets, int64_t t_us);
+
+    // Frame without detections: moves every track to t_us, out = predicted boxes.
+    void Predict(int64_t t_us, std::vector<Det>& out);
+    std::vector<Det> Predict(int64_t t_us);
+
+    void Reset();
+
+    size_t NumTracks() const { return tracks_.size(); }
+
+private:
+    // One coordinate: position, velocity and their covariance
+    struct Kf {
+        float x, v;
+        float pxx, pxv, pvv;
+    };
+
+    struct Track {
+        Kf k[4];             // cx, cy, w, h
+        int id = -1;         // assigned when confirmed
+        int class_id = 0;
+        float score = 0.f;
+        int hits = 0;
+        double since_match_s = 0.0;
+        bool matched = false;  // in the current Update()
+    };
+
+    struct Box { float x1, y1, x2, y2; };
+
+    struct Pair {
+        float iou;
+        int t, d;
+    };
+
+    void Step(int64_t t_us);
+    void PredictAll(double dt);
+    void StartTrack(const Det& d);
+    void Correct(Track& tr, const Det& d);
+
+    // Greedy IoU matching of dets[di] against tracks[ti] (indices into tracks_ / the Update input)
+    void Match(const std::vector<Det>& dets, const std::vector<int>& di, const std::vector<int>& ti,
+        float min_iou, std::vector<int>& det_track);
+
+    void Output(std::vector<Det>& out) const;
+
+    static Box BoxOf(const Track& tr);
+
+private:
+    Options opt_;
+    std::vector<Track> tracks_;
+    int next_id_ = 0;
+    int64_t last_t_us_ = 0;
+    bool has_time_ = false;
+
+    // scratch, reused across frames
+    std::vector<int> high_, low_, free_tracks_, det_track_;
+    std::vector<Box> tbox_;
+    std::vector<int> torder_, dorder_, tactive_, dactive_;
+    std::vector<Pair> pairs_;
+};
@@ -1,4 +1,11 @@
 #pragma once
+#include <array>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <opencv2/opencv.hpp>
@@ -9,24 +16,145 @@
 #include "letterbox.h"
 #include "Infer_result.h"
 
+// Process-wide ORT state shared by several engines (see EnginePool): one Env with global
+// thread pools and a shared CPU arena, and one prepacked-weights container.
+struct OrtSharedState {
+    std::shared_ptr<void> thread_hooks;  // state of custom thread creation; outlives env
+    Ort::Env env{ nullptr };
+    Ort::PrepackedWeightsContainer prepacked;
+};
+
 class InferEngine {
 public:
+    // ORT file paths: wchar_t on Windows, char elsewhere
+    using Path = std::basic_string<ORTCHAR_T>;
+
+    // Which model variant is loaded
+    enum class Precision {
+        FP32,
+        FP16,  // converted with float16 weights (input may stay float32 or be float16)
+        INT8,  // QDQ (static) or dynamically quantized; enables the int8 QDQ kernels on x86
+    };
+
     struct Options {
         int input_w = 640;
         int input_h = 640;
         bool use_cuda = false;     // Ŀǰ CPU false
         int intra_op_num_threads = 0; // 0=ORT Լ
+
+        // Do the IO setup once in LoadModel (input buffer, name pointers, output tensors bound
+        // through Ort::IoBinding) so that RunBound() does no heap allocation per frame.
+        bool persistent_io = false;
+
+        // The input tensor type always follows the model: float32 (RGB 0..1), float16 (same
+        // values in half precision) or uint8 (RGB 0..255, no normalization).
+        Precision precision = Precision::FP32;
+
+        // Optimized-graph cache: the first start saves the optimized model as
+        // <dir>/<model name>-<hash>.ort (hash of the model bytes, the options that change the
+        // graph and the ORT version); later starts load it and skip graph optimization. Empty = off.
+        Path optimized_cache_dir;
+
+        // Dummy inferences at the end of LoadModel, so lazy allocation and kernel selection are
+        // paid before the engine reports ready instead of on the first real frames.
+        int warmup_runs = 0;
+
+        // RunAsync: number of input buffers, i.e. requests that may be in flight at once
+        // (2 = double buffering: one frame in the session while the next is preprocessed)
+        int max_in_flight = 2;
     };
 
-    explicit InferEngine(const Options& opt = Options());
+    struct StartupStats {
+        bool cache_hit = false;
+        double session_ms = 0.0;    // session creation (graph optimization or cache load)
+        double first_run_ms = 0.0;  // first warmup run
+        double warmup_ms = 0.0;     // all warmup runs
+        std::chrono::steady_clock::time_point ready{};  // end of LoadModel
+    };
+
+    InferEngine();
+    explicit InferEngine(const Options& opt);
+
+    // Session on a shared Env: no per-session thread pools (intra_op_num_threads is ignored),
+    // shared arena allocator and prepacked weights.
+    InferEngine(const Options& opt, std::shared_ptr<OrtSharedState> shared);
+
+    // Finishes the queued RunAsync requests first
+    ~InferEngine();
 
-    void LoadModel(const std::wstring& model_path);
+    InferEngine(const InferEngine&) = delete;
+    InferEngine& operator=(const InferEngine&) = delete;
+
+    void LoadModel(const Path& model_path);
 
     //
     
     // С汾ȷԭʼ tensorsԺٱ Detections
+    // Run / Preprocess / RunPrepared / RunBatch may be called from several threads at once
+    // (scratch buffers are per thread); RunBound may not.
     InferResult Run(const cv::Mat& bgr);
 
+    // Run() split in two halves, so preprocessing and session execution can be
+    // placed on different threads (see pipeline::Pipeline). Run() == Preprocess + RunPrepared.
+    struct PreparedInput {
+        std::vector<float> chw;      // [3,H,W] RGB 0..1 (scratch for non-float32 models)
+        std::vector<uint8_t> typed;  // float16 / uint8 models: the same image in the model's input type
+        LetterBoxInfo lb;
+        int orig_w = 0;
+        int orig_h = 0;
+    };
+
+    void Preprocess(const cv::Mat& bgr, PreparedInput& in) const;
+    InferResult RunPrepared(const PreparedInput& in);
+
+    // Preprocess for planar RGB that is already letterboxed to InputW() x InputH() (decoder-side
+    // scaling): only the u8 -> float conversion is left. lb must describe the letterbox that
+    // was applied to the orig_w x orig_h source.
+    void PreprocessPlanarRGB(const cv::Mat& planes, const LetterBoxInfo& lb,
+        int orig_w, int orig_h, PreparedInput& in) const;
+
+    // Same for decoder-letterboxed NV12 (InputH() * 3 / 2 rows): YUV -> RGB, then as above
+    void PreprocessNV12(const cv::Mat& nv12, const LetterBoxInfo& lb,
+        int orig_w, int orig_h, PreparedInput& in) const;
+
+    // Persistent-IO version of Run() (requires Options::persistent_io). Preprocesses straight into
+    // the bound input tensor and lets ORT write into the pre-allocated outputs.
+    // The returned result is owned by the engine and is overwritten by the next RunBound() call.
+    // For consumers that own the engine on one thread and postprocess right away (one
+    // StreamManager / OfflineRunner worker per engine).
+    const InferResult& RunBound(const cv::Mat& bgr);
+
+    // Same for decoder-letterboxed planar RGB (see PreprocessPlanarRGB)
+    const InferResult& RunBoundPlanarRGB(const cv::Mat& planes, const LetterBoxInfo& lb, int orig_w, int orig_h);
+    const InferResult& RunBoundNV12(const cv::Mat& nv12, const LetterBoxInfo& lb, int orig_w, int orig_h);
+
+    bool PersistentIO() const { return opt_.persistent_io; }
+
+    // Runs `count` frames in one session call ([N,3,H,W]). More than one frame needs a model
+    // exported with a dynamic batch axis. Split the output with PostprocessRTDETRBatch.
+    BatchInferResult RunBatch(const cv::Mat* frames, size_t count);
+    BatchInferResult RunBatch(const std::vector<cv::Mat>& frames) { return RunBatch(frames.data(), frames.size()); }
+
+    // Non-blocking Run(): the frame is letterboxed on the calling thread into a free input buffer
+    // (waits while Options::max_in_flight requests are pending), then the session call runs on
+    // the engine's run thread. The caller can preprocess frame N+1 while frame N is in the
+    // session. Requests complete in submission order. A preprocessing error is thrown here,
+    // a session error is delivered with the result.
+    std::future<InferResult> RunAsync(const cv::Mat& bgr);
+
+    // Callback version: done(result, nullptr) or done({}, error) on the run thread, e.g. to
+    // postprocess there. The run thread starts the next request only after done returns.
+    using DoneFn = std::function<void(InferResult result, std::exception_ptr error)>;
+    void RunAsync(const cv::Mat& bgr, DoneFn done);
+
+    // Blocks until every RunAsync request so far has completed (callbacks included)
+    void WaitAsync();
+
+    bool DynamicBatch() const { return dynamic_batch_; }
+    ONNXTensorElementDataType InputType() const { return input_type_; }
+
+    const StartupStats& Startup() const { return startup_; }
+
     int InputW() const { return input_w_; }
     int InputH() const { return input_h_; }
 
@@ -34,17 +162,53 @@ public:
     void PrintModelInfo() const;
 
 private:
-    std::vector<float> PreprocessToCHW(const cv::Mat& bgr, LetterBoxInfo& lb) const;
+    void PreprocessToCHW(const cv::Mat& bgr, LetterBoxInfo& lb, std::vector<float>& chw) const;
+    void SetupBoundIO();
+    const InferResult& RunBoundInput(bool typed_ready);
+    void CreateSession(const Path& model_path, bool from_cache, const Path& save_to);
+    void Warmup();
+
+    // Tensor over f32 (float32 models) or over `typed` after converting f32 into the model's input type
+    Ort::Value MakeInputTensor(float* f32, std::vector<uint8_t>& typed, size_t count,
+        const int64_t* shape, size_t rank) const;
+
+    // RunAsync machinery (input slots, request queue, run thread), created on first use
+    struct AsyncState;
+    AsyncState& Async();
+    void AsyncLoop();
 
 private:
     Options opt_;
     int input_w_ = 0, input_h_ = 0;
+    bool dynamic_batch_ = false;
+    StartupStats startup_;
+    ONNXTensorElementDataType input_type_ = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
 
-    Ort::Env env_;
+    std::shared_ptr<OrtSharedState> shared_;  // null: own Env below
+    Ort::Env env_{ nullptr };
     Ort::SessionOptions session_opt_;
     Ort::Session session_{ nullptr };
 
     // IO names string 棬⣩
     std::vector<std::string> input_names_;
     std::vector<std::string> output_names_;
+    std::vector<const char*> input_name_ptrs_;   // c_str() of the names above, built once
+    std::vector<const char*> output_name_ptrs_;
+
+    Ort::MemoryInfo mem_info_{ nullptr };
+
+    // Persistent IO (Options::persistent_io)
+    Ort::RunOptions run_opt_{ nullptr };
+    Ort::IoBinding io_binding_{ nullptr };
+    std::array<int64_t, 4> io_input_shape_{};
+    std::vector<float> io_input_;
+    std::vector<uint8_t> io_input_typed_;  // bound instead of io_input_ for float16 / uint8 models
+    Ort::Value io_input_tensor_{ nullptr };
+    std::vector<std::vector<float>> io_output_bufs_;
+    std::vector<Ort::Value> io_bound_outputs_;
+    bool io_outputs_prebound_ = false; // false: some output has a dynamic shape, ORT allocates it
+    InferResult io_result_;
+
+    std::once_flag async_once_;
+    std::unique_ptr<AsyncState> async_;
 };
\ No newline at end of file
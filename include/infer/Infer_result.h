@@ -8,4 +8,16 @@ struct InferResult {
     LetterBoxInfo lb;                // letterbox
     int orig_w = 0;
     int orig_h = 0;
+};
+
+// Per-frame letterbox info of a batched run (index = batch position)
+struct BatchItemInfo {
+    LetterBoxInfo lb;
+    int orig_w = 0;
+    int orig_h = 0;
+};
+
+struct BatchInferResult {
+    std::vector<Ort::Value> outputs;   // outputs[0]: [N,Q,4+C]
+    std::vector<BatchItemInfo> items;  // one per input frame
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "InferEngine.h"
+#include "postprocess_rtdetr.h"
+#include "common/det.h"
+
+// When to close a batch: whichever comes first of "max_batch frames are waiting" and
+// "the oldest waiting frame has waited max_wait_ms". Larger values = more throughput, more latency.
+struct BatchPolicy {
+    int max_batch = 4;
+    int max_wait_ms = 10;
+};
+
+// Collects frames from any number of callers (e.g. one per camera) and runs them through
+// InferEngine::RunBatch on a single worker thread.
+class BatchRunner {
+public:
+    // The engine must outlive the runner. Without a dynamic batch axis max_batch is forced to 1.
+    BatchRunner(InferEngine& engine, const BatchPolicy& policy = BatchPolicy(),
+        const PostprocessOptions& pp = PostprocessOptions());
+    ~BatchRunner();
+
+    BatchRunner(const BatchRunner&) = delete;
+    BatchRunner& operator=(const BatchRunner&) = delete;
+
+    // Thread-safe. The future receives the detections (original image coordinates) or the
+    // exception thrown by the engine.
+    std::future<std::vector<Det>> Submit(const cv::Mat& bgr);
+
+    // Fails every pending request and joins the worker.
+    void Stop();
+
+private:
+    struct Request {
+        cv::Mat bgr;
+        std::promise<std::vector<Det>> done;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    void WorkerLoop();
+
+private:
+    InferEngine& engine_;
+    BatchPolicy policy_;
+    PostprocessOptions pp_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Request> pending_;
+    bool stop_ = false;
+    std::thread worker_;
+};
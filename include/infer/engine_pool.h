@@ -0,0 +1,56 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "infer/InferEngine.h"
+
+// Several InferEngine sessions of one model on one process-wide ORT state:
+//   - one Ort::Env with global intra/inter-op thread pools (no per-session pools, so adding
+//     sessions does not add threads that fight over the same cores)
+//   - one shared CPU arena and one PrepackedWeightsContainer (prepacked weights exist once)
+//   - optional pinning of the pool threads to a core list or a NUMA node
+//
+// Every engine can also be called from several threads at once; more sessions mainly help
+// when one session cannot keep the cores busy.
+class EnginePool {
+public:
+    struct Options {
+        InferEngine::Options engine;   // intra_op_num_threads is replaced by intra_op_threads
+        int sessions = 1;
+
+        int intra_op_threads = 0;      // global pool size incl. the calling thread; 0 = one per core
+        int inter_op_threads = 1;
+        bool allow_spinning = false;   // spinning idle threads burn cores other workers could use
+
+        std::vector<int> cpu_cores;    // pin the pool threads to these logical cores
+        int numa_node = -1;            // >= 0 and cpu_cores empty: use the cores of this node
+    };
+
+    EnginePool();
+    explicit EnginePool(const Options& opt);
+
+    EnginePool(const EnginePool&) = delete;
+    EnginePool& operator=(const EnginePool&) = delete;
+
+    void LoadModel(const InferEngine::Path& model_path);
+
+    size_t Size() const { return engines_.size(); }
+    InferEngine& operator[](size_t i) { return *engines_[i]; }
+
+    // e.g. StreamManager(pool.Engines(), ...); the same engine may appear for several workers,
+    // except with engine.persistent_io (at most Size() workers then)
+    std::vector<InferEngine*> Engines(size_t workers = 0);
+
+    // Callers of Run take part in the intra-op work: worker threads should call this once so
+    // they stay on the pool's cores too. No-op without affinity options.
+    void PinCurrentThread() const;
+
+    const std::vector<int>& Cores() const { return cores_; }
+
+private:
+    Options opt_;
+    std::vector<int> cores_;
+    std::shared_ptr<OrtSharedState> shared_;
+    std::vector<std::unique_ptr<InferEngine>> engines_;
+};
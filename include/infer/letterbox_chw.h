@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "letterbox.h"
+
+// Reference path (3 passes, 3 allocations): cv::resize -> cv::copyMakeBorder -> scalar CHW loop.
+// Kept for comparisons and benchmarks; the engine uses LetterboxToCHWFloat01_RGB below.
+cv::Mat LetterboxBGR(const cv::Mat& src_bgr, int dst_w, int dst_h, LetterBoxInfo& info);
+void BGRToCHWFloat01_RGB(const cv::Mat& bgr, std::vector<float>& chw);
+
+// Fused letterbox + BGR->RGB + /255 + HWC->CHW in a single pass over the source.
+//
+// - src_bgr: CV_8UC3, may be a non-continuous ROI view
+// - dst_chw: caller-owned buffer of 3*dst_w*dst_h floats ([3,H,W], RGB, 0..1). It can be handed
+//   straight to Ort::Value::CreateTensor. Only the pad border is written with 114/255, the
+//   content region is written directly by the resize.
+//
+// The resize reproduces the fixed-point arithmetic of cv::resize(INTER_LINEAR) on 8-bit input
+// (11-bit coefficients, and the 2x-downscale case that OpenCV routes to INTER_AREA), so the
+// result matches LetterboxBGR + BGRToCHWFloat01_RGB. The vertical blend and float conversion
+// use AVX2 / SSE4.1 when the CPU has them, with a scalar fallback.
+void LetterboxToCHWFloat01_RGB(const cv::Mat& src_bgr, int dst_w, int dst_h,
+    float* dst_chw, LetterBoxInfo& info);
+
+// Planar 8-bit RGB that is already letterboxed at model size (e.g. scaled by the decoder, see
+// video::PixelFormat::RGB_PLANAR) -> [3,H,W] float 0..1. planes: CV_8UC1, 3*H rows (R, G, B).
+void PlanarU8ToCHWFloat01(const cv::Mat& planes, float* dst_chw);
+
+// NV12 (CV_8UC1, H*3/2 rows: Y plane + interleaved UV, see video::PixelFormat::NV12) -> the
+// planar layout above (3*H rows R, G, B). BT.601 video range like sws' default; the grey pad
+// (Y 114, UV 128) comes out as 114. planes is reallocated only when the size changes.
+void NV12ToPlanarRGB(const cv::Mat& nv12, cv::Mat& planes);
+
+// [0,1] floats -> the input type of FP16 / uint8-input models (see InferEngine::Options::precision).
+// Float01ToHalf writes IEEE half bits (F16C when available); Float01ToU8 writes round(v * 255).
+void Float01ToHalf(const float* src, uint16_t* dst, size_t n);
+void Float01ToU8(const float* src, uint8_t* dst, size_t n);
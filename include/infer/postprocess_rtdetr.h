@@ -3,11 +3,13 @@
 #include <onnxruntime_cxx_api.h>
 
 #include "letterbox.h"
+#include "Infer_result.h"
 #include "common/det.h"
 
 struct PostprocessOptions {
     float score_thresh = 0.49f;
     bool apply_sigmoid = true;   // RT-DETR  logits
+    int top_k = 0;               // > 0: keep only the K highest scores (sorted by score)
 };
 
 //  RT-DETR Ĭ outputs[0] -> detsԭͼ꣩
@@ -18,3 +20,21 @@ std::vector<Det> PostprocessRTDETR(
     int orig_w, int orig_h,           // ԭͼߴ
     const PostprocessOptions& opt = {}
 );
+
+// Same, writing into a caller-owned vector (cleared first; its capacity is reused across frames)
+void PostprocessRTDETR(
+    const Ort::Value& out0,
+    int input_w, int input_h,
+    const LetterBoxInfo& lb,
+    int orig_w, int orig_h,
+    const PostprocessOptions& opt,
+    std::vector<Det>& dets
+);
+
+// Batched version: splits [N,Q,4+C] per image, result[i] belongs to items[i]
+std::vector<std::vector<Det>> PostprocessRTDETRBatch(
+    const Ort::Value& out0,
+    int input_w, int input_h,
+    const std::vector<BatchItemInfo>& items,
+    const PostprocessOptions& opt = {}
+);
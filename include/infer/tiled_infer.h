@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "InferEngine.h"
+#include "postprocess_rtdetr.h"
+#include "common/det.h"
+
+// Tiled / ROI inference for small objects on high-resolution frames: instead of letterboxing
+// the whole 4K frame to the model input (where a distant person is a few pixels), the frame is
+// cut into overlapping tiles (or user ROIs) that are each letterboxed on their own.
+//
+// - tiles are cv::Mat ROI views of the caller's frame, never copies (the fused letterbox reads
+//   non-continuous views directly)
+// - all tiles go through InferEngine::RunBatch in one session call with a dynamic-batch model
+//   (max_batch can cap it to bound the input tensor's memory); one call per tile otherwise
+// - boxes are mapped back to frame coordinates and merged across tiles (NMS or WBF, per class).
+//   A box that touches an inner tile edge is a cut-off part of an object, so it is compared by
+//   intersection over the smaller box instead of IoU.
+// - tiles covered by a static mask (sky, walls, OSD text) are not run at all
+//
+// Not thread-safe (the tile layout is cached per frame size); use one per thread.
+class TiledInfer {
+public:
+    enum class Merge {
+        NMS,  // keep the highest-scoring box of each overlapping group
+        WBF,  // weighted box fusion: score-weighted average of the group, best score
+    };
+
+    struct Options {
+        // Grid: tile size in frame pixels (0 = model input size, i.e. tiles run at full
+        // resolution) and the overlap between neighbours, as a fraction of the tile
+        int tile_w = 0;
+        int tile_h = 0;
+        float overlap = 0.2f;
+
+        // User ROIs in normalized [0,1] frame coordinates; non-empty replaces the grid
+        std::vector<cv::Rect2f> rois;
+
+        // Also run the whole frame letterboxed, for objects larger than a tile
+        bool full_frame = true;
+
+        // CV_8UC1, any size (stretched to the frame), nonzero = nothing to detect there. A tile
+        // with more than mask_skip_fraction of its pixels masked is skipped.
+        cv::Mat static_mask;
+        float mask_skip_fraction = 0.9f;
+
+        Merge merge = Merge::NMS;
+        float merge_thresh = 0.5f;  // IoU (or intersection over the smaller box, see above)
+        int edge_margin = 2;        // px: a box this close to an inner tile edge counts as cut off
+
+        int max_batch = 0;          // tiles per session call, 0 = all; forced to 1 without a dynamic batch axis
+
+        PostprocessOptions pp;
+    };
+
+    // The engine must outlive this object
+    explicit TiledInfer(InferEngine& engine);
+    TiledInfer(InferEngine& engine, const Options& opt);
+
+    // bgr: full-resolution CV_8UC3 frame. Detections in frame coordinates.
+    void Run(const cv::Mat& bgr, std::vector<Det>& dets);
+    std::vector<Det> Run(const cv::Mat& bgr);
+
+    // Layout of the last Run(): the tiles that are run (frame pixels), and how many the mask skipped
+    const std::vector<cv::Rect>& Tiles() const { return tiles_; }
+    int SkippedTiles() const { return skipped_; }
+
+    // Evenly spread grid of tile_w x tile_h tiles over a w x h frame: neighbours overlap by at
+    // least `overlap`, the outer tiles touch the frame borders. Tiles are clipped to small frames.
+    static std::vector<cv::Rect> GridTiles(int w, int h, int tile_w, int tile_h, float overlap);
+
+    // Merges boxes in place. cut[i]: dets[i] touches an inner tile edge (may be empty).
+    static void MergeDetections(std::vector<Det>& dets, const std::vector<char>& cut,
+        Merge merge, float thresh);
+
+private:
+    void Layout(int w, int h);
+
+private:
+    InferEngine& engine_;
+    Options opt_;
+
+    // cached for frames of layout_size_
+    cv::Size layout_size_;
+    std::vector<cv::Rect> tiles_;   // tiles that are run; a full_frame pass is the last entry
+    int skipped_ = 0;
+
+    // scratch
+    std::vector<cv::Mat> views_;
+    std::vector<Det> raw_;
+    std::vector<char> cut_;
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pipeline/deadline.h"
+#include "video/ffmpeg_video_source.h"
+#include "video/frame.h"
+#include "video/video_source.h"
+
+namespace pipeline {
+
+    // One rung of the quality ladder: which stream to decode and at which model input size.
+    struct StreamProfile {
+        std::string name;  // for logs, e.g. "hd-640"
+        std::string url;   // empty = the URL passed to AdaptiveSource::Open (same stream, other size)
+        int input_w = 640; // decoder output / model input; needs an InferEngine of this size
+        int input_h = 640;
+    };
+
+    // Keeps the end-to-end latency of one stream under a target by moving along a ladder of
+    // profiles, best first: e.g. HD at 640, substream at 640, substream at 480.
+    //
+    // Latency of a frame = its age at output measured from its capture time (PtsClock), which
+    // includes how far the decoder has fallen behind the stream, so both a slow model and a
+    // decoder that cannot keep up push it over the target. The smoothed value has to
+    // stay above the target for degrade_after_ms before the controller steps down one level,
+    // and well below it (upgrade_below) for the longer upgrade_after_ms before it steps up; after
+    // any switch it holds the level for min_dwell_ms. Under CPU contention the stream degrades
+    // step by step instead of falling behind, and comes back once there is headroom.
+    //
+    // An upgrade that has to be reverted within revert_window dwells was a failed probe: the
+    // level remembers the latency that drove it out, and the wait before the next attempt to go
+    // back up to it doubles (up to max_upgrade_after_ms). Once an upgrade holds for the window the
+    // wait for that level is back to upgrade_after_ms. A load that the better profile cannot
+    // carry therefore costs a switch every few minutes, not one every upgrade_after_ms.
+    class ProfileController {
+    public:
+        struct Options {
+            double target_ms = 200.0;
+            double degrade_above = 1.0;    // step down above target_ms * degrade_above
+            double upgrade_below = 0.5;    // step up below target_ms * upgrade_below
+            int degrade_after_ms = 2000;
+            int upgrade_after_ms = 15000;  // longer than degrade: probing upwards costs a switch
+            int min_dwell_ms = 5000;
+            int revert_window = 3;             // an upgrade reverted within this many dwells failed
+            int max_upgrade_after_ms = 600000; // cap of the backed-off upgrade wait
+            double smoothing = 0.1;        // EWMA weight of a new sample
+            int start_level = 0;
+        };
+
+        struct Stats {
+            int level = 0;
+            double latency_ms = 0.0;  // smoothed
+            uint64_t degrades = 0;
+            uint64_t upgrades = 0;
+            uint64_t failed_upgrades = 0;    // reverted within the window
+            int upgrade_after_ms = 0;        // current wait before stepping up one level
+            double degrade_latency_ms = 0.0; // latency that last drove the next better level out, 0 = none
+        };
+
+        // ladder: best quality first. Throws if it is empty.
+        explicit ProfileController(std::vector<StreamProfile> ladder);
+        ProfileController(std::vector<StreamProfile> ladder, const Options& opt);
+
+        ProfileController(const ProfileController&) = delete;
+        ProfileController& operator=(const ProfileController&) = delete;
+
+        // One output frame (e.g. from the render thread); may switch the level
+        void Observe(const video::Frame& f);
+
+        // A latency sample measured elsewhere; may switch the level
+        void ObserveLatency(double latency_ms);
+
+        // Current level, read by the decode side (lock-free)
+        int Level() const { return level_.load(std::memory_order_acquire); }
+        const StreamProfile& Profile(int level) const { return ladder_[level]; }
+        const std::vector<StreamProfile>& Ladder() const { return ladder_; }
+
+        // Manual override, or going back after a failed switch; restarts the hysteresis
+        void SetLevel(int level);
+
+        Stats GetStats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        void SwitchLocked(int level, Clock::time_point now);
+        void Degrade(int level, Clock::time_point now);
+
+    private:
+        std::vector<StreamProfile> ladder_;
+        Options opt_;
+        std::atomic<int> level_{ 0 };
+
+        mutable std::mutex mu_;
+        double ewma_ = -1.0;  // < 0: no sample since the last switch
+        Clock::time_point above_since_{};
+        Clock::time_point below_since_{};
+        Clock::time_point switched_at_{};
+        bool last_was_upgrade_ = false;
+        std::vector<int> upgrade_after_ms_;     // per level: wait before stepping up to it
+        std::vector<double> degrade_latency_;   // per level: latency of the last step down from it
+        PtsClock pts_clock_;
+        uint64_t degrades_ = 0;
+        uint64_t upgrades_ = 0;
+        uint64_t failed_upgrades_ = 0;
+    };
+
+    // FFmpegVideoSource that follows a ProfileController: before each Read() it applies the
+    // controller's level. A new URL is opened before the old stream is closed (make before
+    // break, no gap longer than the connect) and a failed switch falls back to the old level;
+    // a size-only change just resizes the decoder's scaler.
+    //
+    // Frames come out at the profile's input size, so a consumer must pick the engine by frame
+    // size (pipeline::Pipeline does with Options::engines).
+    class AdaptiveSource final : public video::IVideoSource {
+    public:
+        // opt: out_format should be RGB_PLANAR or NV12; out_w / out_h come from the profiles.
+        // ctl must outlive the source.
+        AdaptiveSource(ProfileController& ctl, const video::FFmpegVideoSource::Options& opt);
+
+        void Open(const std::string& url) override;
+        bool Read(video::Frame& out) override;
+        void Close() override;
+
+        // Reaches the open stream and a switch that is still connecting
+        void Interrupt() override;
+
+        int OpenLevel() const { return open_level_; }
+
+    private:
+        std::string UrlOf(int level) const;
+        std::unique_ptr<video::FFmpegVideoSource> Connect(int level);
+        void Apply(int level);
+
+    private:
+        ProfileController& ctl_;
+        video::FFmpegVideoSource::Options opt_;
+        std::string base_url_;
+        std::unique_ptr<video::FFmpegVideoSource> src_;  // replaced with live_mu_ held
+        int open_level_ = -1;
+
+        // Interrupt() comes from another thread
+        std::mutex live_mu_;
+        video::FFmpegVideoSource* connecting_ = nullptr;  // guarded by live_mu_
+        bool interrupted_ = false;                        // guarded by live_mu_
+    };
+
+} // namespace pipeline
@@ -0,0 +1,105 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace pipeline {
+
+    // What Push() does when the queue is already at its depth.
+    enum class DropPolicy {
+        Block,       // wait for the consumer (lossless, upstream slows down)
+        DropOldest,  // evict the head so the newest item always gets in (live video)
+        DropNewest,  // reject the incoming item
+    };
+
+    struct QueueOptions {
+        size_t depth = 2;
+        DropPolicy drop = DropPolicy::Block;
+    };
+
+    // Bounded MPMC queue linking two pipeline stages.
+    // Close() wakes every waiter: Push() then fails, Pop() drains what is left and then fails.
+    template <typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(const QueueOptions& opt = QueueOptions())
+            : depth_(opt.depth > 0 ? opt.depth : 1), drop_(opt.drop) { }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        // Returns false only when the queue is closed. A dropped item still counts as success.
+        bool Push(T item) {
+            std::unique_lock<std::mutex> lk(mu_);
+            if (closed_) return false;
+
+            if (items_.size() >= depth_) {
+                switch (drop_) {
+                case DropPolicy::Block:
+                    not_full_.wait(lk, [&] { return closed_ || items_.size() < depth_; });
+                    if (closed_) return false;
+                    break;
+                case DropPolicy::DropOldest:
+                    items_.pop_front();
+                    ++dropped_;
+                    break;
+                case DropPolicy::DropNewest:
+                    ++dropped_;
+                    return true;
+                }
+            }
+
+            items_.push_back(std::move(item));
+            lk.unlock();
+            not_empty_.notify_one();
+            return true;
+        }
+
+        // Blocks until an item is available. Returns false once closed and empty.
+        bool Pop(T& out) {
+            std::unique_lock<std::mutex> lk(mu_);
+            not_empty_.wait(lk, [&] { return closed_ || !items_.empty(); });
+            if (items_.empty()) return false;
+
+            out = std::move(items_.front());
+            items_.pop_front();
+            lk.unlock();
+            not_full_.notify_one();
+            return true;
+        }
+
+        void Close() {
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                closed_ = true;
+            }
+            not_empty_.notify_all();
+            not_full_.notify_all();
+        }
+
+        size_t Size() const {
+            std::lock_guard<std::mutex> lk(mu_);
+            return items_.size();
+        }
+
+        uint64_t Dropped() const {
+            std::lock_guard<std::mutex> lk(mu_);
+            return dropped_;
+        }
+
+    private:
+        const size_t depth_;
+        const DropPolicy drop_;
+
+        mutable std::mutex mu_;
+        std::condition_variable not_empty_;
+        std::condition_variable not_full_;
+        std::deque<T> items_;
+        bool closed_ = false;
+        uint64_t dropped_ = 0;
+    };
+
+} // namespace pipeline
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+
+#include "video/frame.h"
+
+namespace pipeline {
+
+    // Maps one stream's pts_us to the steady clock (Frame::wall_us's clock).
+    //
+    // The camera's clock is not the host's, so the mapping is relative: the frame with the
+    // smallest wall_us - pts_us seen so far is taken as delivered without delay, and every other
+    // frame is as old as it is behind that one. Ages therefore include decoder backlog, network
+    // stalls and queueing, but not the fixed capture / encode / network latency of the best case.
+    // The baseline may creep up by a clock drift allowance, so a camera clock that runs slow is
+    // not taken for growing lag. A jump of more than 10 s (reconnect, pts wrap) or another source
+    // resolution (switch to another stream of the camera, see AdaptiveSource) starts over.
+    // A stream without usable timestamps (no pts, which the decoder reports as 0, or pts that
+    // do not increase) has no capture time to go by: such frames are taken as captured when they
+    // were decoded (wall_us), so their age is the pipeline's latency after the decoder.
+    // Not thread-safe.
+    class PtsClock {
+    public:
+        // Learns from one decoded frame
+        void Observe(const video::Frame& f);
+
+        // Estimated steady-clock time (us) at which the frame was captured; its wall_us before the
+        // first Observe() and while the stream's pts are unusable
+        int64_t CaptureUs(const video::Frame& f) const;
+
+        // After switching streams (another pts base)
+        void Reset();
+
+        bool Calibrated() const { return has_; }
+
+    private:
+        bool has_ = false;
+        bool seen_ = false;      // last_pts_us_ is valid
+        bool pts_known_ = false; // the last observed frame's pts went forward
+        int64_t last_pts_us_ = 0;
+        double min_offset_us_ = 0.0;  // smallest wall_us - pts_us, plus drift allowance
+        int64_t last_offset_us_ = 0;
+        int64_t last_wall_us_ = 0;
+        int src_w_ = 0;
+        int src_h_ = 0;
+    };
+
+    // Frame-age admission control for one stream: frames already older than the deadline are
+    // dropped before any work is spent on them, and every result is counted as on time or late.
+    // Under overload the stream then runs at a lower FPS with bounded latency instead of
+    // processing an ever older backlog (and raising alerts about the past). A decoder that cannot
+    // keep up with the stream in the first place has to be fixed upstream (AdaptiveSource,
+    // FFmpegVideoSource::Options::drop_packets_before_decode): then every frame is too old.
+    class DeadlineGate {
+    public:
+        struct Options {
+            double deadline_ms = 0.0;      // max frame age, at admission and at output; 0 = off
+            double base_latency_ms = 0.0;  // known capture -> decode latency of the best case, added to every age
+        };
+
+        struct Stats {
+            uint64_t admitted = 0;
+            uint64_t dropped = 0;   // older than the deadline at admission
+            uint64_t on_time = 0;   // result out within the deadline
+            uint64_t late = 0;      // admitted, but the result came out after the deadline
+            double age_ms = 0.0;    // smoothed age at output
+        };
+
+        DeadlineGate();
+        explicit DeadlineGate(const Options& opt);
+
+        bool Enabled() const { return opt_.deadline_ms > 0.0; }
+
+        // Before preprocessing. false = the frame is too old, drop it. Always true when off.
+        bool Admit(const video::Frame& f);
+
+        // When the frame's result goes out (render / on_result)
+        void Done(const video::Frame& f);
+
+        Stats GetStats() const;
+
+    private:
+        double AgeMsLocked(const video::Frame& f) const;
+
+    private:
+        Options opt_;
+        mutable std::mutex mu_;  // Admit and Done may run on different threads
+        PtsClock clock_;
+        Stats stats_;
+    };
+
+} // namespace pipeline
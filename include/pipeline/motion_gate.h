@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "video/frame.h"
+
+namespace pipeline {
+
+    // Cheap change detection in front of inference: a small luma thumbnail of each frame is
+    // compared with the thumbnail of the last frame that went through inference. If too few
+    // pixels changed, the frame is skipped and the caller reuses the previous detections.
+    //
+    // The thumbnail is Frame::luma when the decoder provides it (FFmpegVideoSource::Options::
+    // luma_w, taken from the Y plane), otherwise it is computed here from the BGR / planar pixels.
+    //
+    // Not thread-safe: one gate per stream, used by one thread at a time.
+    class MotionGate {
+    public:
+        struct Options {
+            int luma_w = 160;                 // thumbnail width when the frame has no Frame::luma
+
+            // sensitivity: a pixel changed if |diff| > pixel_thresh (0..255), the frame changed if
+            // more than changed_fraction of the watched pixels did
+            int pixel_thresh = 20;
+            double changed_fraction = 0.002;
+
+            // watched areas in normalized [0,1] frame coordinates (may overlap); empty = whole frame
+            std::vector<cv::Rect2f> regions;
+
+            // run inference at least every refresh_interval frames even without motion
+            // (objects that stop moving keep fresh boxes / scores); 0 = never forced
+            int refresh_interval = 50;
+        };
+
+        struct Stats {
+            uint64_t frames = 0;
+            uint64_t skipped = 0;
+            double skip_ratio = 0.0;
+            double saved_ms = 0.0;   // skipped frames x average inference cost
+        };
+
+        MotionGate();
+        explicit MotionGate(const Options& opt);
+
+        // true: run inference on this frame (it becomes the new reference); false: nothing
+        // changed, reuse the previous result
+        bool Check(const video::Frame& frame);
+
+        // Cost of the inference that followed a true Check(), for the saved-CPU estimate. May be
+        // called from another thread than Check().
+        void OnInferred(double ms);
+
+        Stats GetStats() const;
+
+        // Small grayscale image of the frame (Frame::luma if present), luma_w wide
+        static void Thumbnail(const video::Frame& frame, int luma_w, cv::Mat& out);
+
+    private:
+        void BuildSpans(int w, int h);
+
+    private:
+        Options opt_;
+
+        cv::Mat ref_;                  // thumbnail of the last inferred frame
+        cv::Mat cur_;
+        int since_infer_ = 0;
+
+        // watched pixels as [x0, x1) spans per row; rebuilt when the thumbnail size changes
+        struct Span { int y, x0, x1; };
+        std::vector<Span> spans_;
+        size_t watched_ = 0;
+        cv::Size spans_size_;
+
+        // OnInferred() / GetStats() may run on other threads than Check()
+        std::atomic<double> avg_infer_ms_{ 0.0 };
+        std::atomic<uint64_t> frames_{ 0 };
+        std::atomic<uint64_t> skipped_{ 0 };
+        std::atomic<double> saved_ms_{ 0.0 };
+    };
+
+} // namespace pipeline
@@ -0,0 +1,122 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/det.h"
+#include "infer/InferEngine.h"
+#include "infer/postprocess_rtdetr.h"
+#include "pipeline/bounded_queue.h"
+#include "video/ffmpeg_video_source.h"
+
+namespace pipeline {
+
+    // Archive processing: one recorded file as fast as the machine goes, nothing dropped.
+    //
+    // The file is cut into segments at keyframes (a demux-only scan, no decoding), and several
+    // decode workers each decode whole segments with their own single-threaded decoder. Their
+    // frames share one blocking queue in front of the inference workers (one per engine, like
+    // StreamManager), and the results are put back into presentation order before on_result.
+    //
+    //   segments -> decode[0..D) -> queue -> workers[0..M) -> reorder -> on_result (pts order)
+    //
+    // Segment decoding scales across cores much better than FFmpeg's frame threads inside one
+    // decoder, and a segment starts at a keyframe so its frames are exact.
+    class OfflineRunner {
+    public:
+        struct Options {
+            int decode_workers = 0;    // 0 = half the cores (at least 1)
+            double segment_s = 20.0;   // minimum segment length; cut at the next keyframe after it
+            size_t queue_depth = 32;   // decoded frames waiting for inference
+
+            // false: the pixels are released right after inference, on_result only gets the
+            // metadata (pts, sizes, letterbox) and the boxes. true: frames keep their pixels until
+            // on_result; the decoders' frame pools then bound how far a segment runs ahead.
+            bool keep_frames = false;
+
+            // decoder / output format; async, start_us and end_us are set per segment, and
+            // decode_threads 0 (one per core) becomes 1 since the segments already use the cores
+            video::FFmpegVideoSource::Options source;
+            PostprocessOptions pp;
+        };
+
+        struct Stats {
+            uint64_t frames = 0;
+            int segments = 0;
+            double media_s = 0.0;  // length of the video
+            double wall_s = 0.0;
+            double fps = 0.0;      // frames / wall_s
+            double speed = 0.0;    // media_s / wall_s: 10 = ten times real time
+        };
+
+        struct Segment {
+            int64_t start_us = 0;  // a keyframe (0 for the first segment)
+            int64_t end_us = 0;    // the next segment's start, 0 for the last one
+        };
+
+        // Called on one thread at a time, in pts order. Return false to stop the run early.
+        using ResultFn = std::function<bool(const video::Frame& frame, const std::vector<Det>& dets)>;
+
+        // engines: one inference worker per entry (the same engine may be listed more than once,
+        // except one with persistent_io: its worker uses RunBound)
+        OfflineRunner(std::vector<InferEngine*> engines, ResultFn on_result);
+        OfflineRunner(std::vector<InferEngine*> engines, ResultFn on_result, const Options& opt);
+
+        OfflineRunner(const OfflineRunner&) = delete;
+        OfflineRunner& operator=(const OfflineRunner&) = delete;
+
+        // Processes the whole file; returns when every frame went through on_result (or it
+        // returned false). Throws if the file cannot be opened.
+        Stats Run(const std::string& path);
+
+        // The same for a file already in memory (e.g. fetched from object storage); the buffer
+        // is read by every decode worker and must stay valid during the call.
+        Stats RunMemory(const uint8_t* data, size_t size);
+
+        // Cuts [0, end) at keyframes into segments of at least segment_s seconds
+        static std::vector<Segment> Segments(const std::vector<int64_t>& keyframes, int64_t end_us, double segment_s);
+
+    private:
+        struct Item {
+            int seg = 0;
+            uint64_t idx = 0;  // frame number within the segment
+            video::Frame frame;
+            std::vector<Det> dets;
+        };
+
+        Stats RunInput(const std::string& path, const uint8_t* data, size_t size);
+        void OpenSource(video::FFmpegVideoSource& src, const std::string& path, const uint8_t* data, size_t size) const;
+
+        void DecodeLoop(const std::string& path, const uint8_t* data, size_t size);
+        void WorkerLoop(InferEngine& engine);
+
+        // Hands every result that is next in order to on_result_. Called with emit_mu_ held.
+        void EmitLocked();
+
+    private:
+        std::vector<InferEngine*> engines_;
+        ResultFn on_result_;
+        Options opt_;
+
+        // one run
+        std::vector<Segment> segments_;
+        std::atomic<int> next_segment_{ 0 };
+        std::unique_ptr<BoundedQueue<Item>> queue_;
+        std::atomic<bool> stop_{ false };
+
+        std::mutex emit_mu_;
+        std::map<std::pair<int, uint64_t>, Item> pending_;  // inferred, waiting for their turn
+        std::vector<int64_t> seg_frames_;                  // frames of a finished segment, -1 = still decoding
+        int emit_seg_ = 0;
+        uint64_t emit_idx_ = 0;
+        uint64_t emitted_ = 0;
+    };
+
+} // namespace pipeline
@@ -0,0 +1,167 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/det.h"
+#include "common/metrics.h"
+#include "common/tracker.h"
+#include "infer/InferEngine.h"
+#include "infer/postprocess_rtdetr.h"
+#include "infer/tiled_infer.h"
+#include "pipeline/adaptive_profile.h"
+#include "pipeline/bounded_queue.h"
+#include "pipeline/deadline.h"
+#include "pipeline/motion_gate.h"
+#include "video/video_source.h"
+
+namespace pipeline {
+
+    // One frame travelling through the stages. Each stage fills in its part.
+    struct FramePacket {
+        uint64_t seq = 0;
+        video::Frame frame;
+        InferEngine* engine = nullptr;     // picked by preprocess for this frame's size
+        InferEngine::PreparedInput input;  // preprocess -> infer
+        cv::Mat full_bgr;                  // tiled mode: full-resolution frame, preprocess -> infer
+        InferResult result;                // infer -> postprocess
+        std::vector<Det> dets;             // postprocess -> render
+        double infer_ms = 0.0;             // session + postprocess time for this frame
+        bool gated = false;                // no inference (motion gate / infer_every): dets are the tracker's
+                                           // prediction, or copied from the last inferred frame
+    };
+
+    // decode -> preprocess -> infer -> postprocess -> render, one thread per stage,
+    // linked by bounded queues. Throughput is set by the slowest stage instead of the sum.
+    class Pipeline {
+    public:
+        struct Options {
+            // Live sources: drop old frames rather than let latency pile up in front of inference.
+            QueueOptions decode_queue{ 2, DropPolicy::DropOldest };
+            QueueOptions preprocess_queue{ 2, DropPolicy::Block };
+            QueueOptions infer_queue{ 2, DropPolicy::Block };
+            QueueOptions postprocess_queue{ 2, DropPolicy::DropOldest };
+            PostprocessOptions pp;
+
+            // skip inference on frames without change (see MotionGate)
+            bool motion_gate = false;
+            MotionGate::Options motion;
+
+            // run the model on every Nth frame only; worth it with track = true
+            int infer_every = 1;
+
+            // small objects on HD frames: infer on tiles of the full-resolution frame (see
+            // TiledInfer, tiles.pp is replaced by pp); the infer stage then also postprocesses
+            bool tiled = false;
+            TiledInfer::Options tiles;
+
+            // Det::track_id, and boxes predicted by the tracker on frames without inference
+            bool track = false;
+            Tracker::Options tracker;
+
+            // More engines with other input sizes (pre-loaded sessions, or one dynamic-shape
+            // model loaded at several sizes): an RGB_PLANAR / NV12 frame goes to the engine whose
+            // input matches the frame, a BGR24 frame to the one of adaptive's current profile.
+            // The engine passed to the constructor is the default. Must outlive the pipeline.
+            std::vector<InferEngine*> engines;
+
+            // fed with every rendered frame; switches the stream profile (see AdaptiveSource)
+            ProfileController* adaptive = nullptr;
+
+            // frames older than deadline.deadline_ms are dropped before preprocessing, results
+            // are counted as on time / late at render
+            DeadlineGate::Options deadline;
+
+            // pipeline="..." label of this pipeline's queue gauges; empty = "0", "1", ... in
+            // construction order
+            std::string name;
+        };
+
+        // Called on the render thread. Return false to stop the pipeline (e.g. 'q' pressed).
+        using RenderFn = std::function<bool(FramePacket& pkt)>;
+
+        struct Stats {
+            uint64_t decoded = 0;
+            uint64_t rendered = 0;
+            uint64_t dropped = 0;  // sum over all queues
+            double first_result_ms = -1.0;  // Start() -> first rendered frame; -1 = none yet
+            MotionGate::Stats motion;       // all zero without Options::motion_gate
+            DeadlineGate::Stats deadline;   // all zero without Options::deadline
+        };
+
+        // src and engine must outlive the pipeline; the pipeline only calls their public API.
+        Pipeline(video::IVideoSource& src, InferEngine& engine, RenderFn render);
+        Pipeline(video::IVideoSource& src, InferEngine& engine, RenderFn render, const Options& opt);
+        ~Pipeline();
+
+        Pipeline(const Pipeline&) = delete;
+        Pipeline& operator=(const Pipeline&) = delete;
+
+        void Start();
+
+        // Ask every stage to finish. The decode thread exits after its current Read() returns.
+        void Stop();
+
+        // Blocks until the source ends, render returns false or Stop() is called, then joins
+        // all stage threads. Rethrows the first exception raised inside a stage.
+        void Wait();
+
+        Stats GetStats() const;
+
+    private:
+        void DecodeLoop();
+        void PreprocessLoop();
+        void InferLoop();
+        void PostprocessLoop();
+        void RenderLoop();
+
+        InferEngine& EngineFor(const video::Frame& f) const;
+
+        // Runs one stage body; on exception records it and stops the pipeline.
+        void Guard(void (Pipeline::*body)());
+        void CloseQueues();
+
+        // queue depth / drop gauges (common/metrics.h), refreshed once per rendered frame
+        void PublishQueueGauges() const;
+
+    private:
+        struct QueueGauges {
+            metrics::Gauge* depth = nullptr;
+            metrics::Gauge* dropped = nullptr;
+        };
+
+        video::IVideoSource& src_;
+        InferEngine& engine_;
+        RenderFn render_;
+        Options opt_;
+        MotionGate gate_;
+        DeadlineGate deadline_;
+        Tracker tracker_;  // postprocess thread
+        std::unique_ptr<TiledInfer> tiler_;  // infer thread, Options::tiled only
+
+        BoundedQueue<FramePacket> decoded_q_;
+        BoundedQueue<FramePacket> prepared_q_;
+        BoundedQueue<FramePacket> inferred_q_;
+        BoundedQueue<FramePacket> detected_q_;
+        QueueGauges gauges_[4];  // decoded, prepared, inferred, detected
+
+        std::vector<std::thread> threads_;
+        std::atomic<bool> stop_{ false };
+
+        std::atomic<uint64_t> decoded_{ 0 };
+        std::atomic<uint64_t> rendered_{ 0 };
+        std::chrono::steady_clock::time_point started_{};
+        std::atomic<double> first_result_ms_{ -1.0 };
+
+        std::mutex err_mu_;
+        std::exception_ptr error_;
+    };
+
+} // namespace pipeline
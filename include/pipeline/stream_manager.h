@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/det.h"
+#include "common/tracker.h"
+#include "infer/InferEngine.h"
+#include "infer/postprocess_rtdetr.h"
+#include "pipeline/deadline.h"
+#include "pipeline/motion_gate.h"
+#include "video/video_source.h"
+
+namespace pipeline {
+
+    struct StreamConfig {
+        std::string url;
+        int priority = 1;      // weight in the fair scheduler: priority 2 gets twice the inference slots of 1
+        double max_fps = 0.0;  // inference cap for this stream, 0 = uncapped
+
+        // served before every non-critical stream that has a frame waiting (fair queueing only
+        // among streams of the same kind)
+        bool critical = false;
+
+        // frames older than deadline.deadline_ms when a worker picks them are dropped
+        DeadlineGate::Options deadline;
+
+        // skip inference on frames without change and report the previous detections again
+        bool motion_gate = false;
+        MotionGate::Options motion;
+
+        // Det::track_id; frames skipped by the motion gate get the tracker's predicted boxes
+        bool track = false;
+        Tracker::Options tracker;
+    };
+
+    struct StreamStats {
+        int id = 0;
+        std::string url;
+        uint64_t decoded = 0;
+        uint64_t inferred = 0;
+        uint64_t dropped = 0;      // decoded frames replaced by a newer one before inference
+        uint64_t reconnects = 0;
+        double infer_fps = 0.0;    // smoothed
+        double first_result_ms = -1.0;  // Start() -> first successful result of this stream; -1 = none yet
+        MotionGate::Stats motion;       // skip ratio / saved inference time; zero without motion_gate
+        DeadlineGate::Stats deadline;   // dropped / late / on-time frames; zero without a deadline
+        bool connected = false;
+        bool finished = false;     // a file (not a live URL) was read to its end
+    };
+
+    // One process, many cameras: every stream has its own decode thread that keeps only the newest
+    // frame, and a shared pool of inference workers picks streams with weighted fair queueing.
+    //
+    //   decode[0..N) -> latest-frame slot -> scheduler -> workers[0..M) (one InferEngine each) -> on_result
+    class StreamManager {
+    public:
+        struct Options {
+            PostprocessOptions pp;
+            // live URLs (rtsp://, http://, ... anything with a scheme but file:) reconnect after
+            // a failure or the end of input; a file is finished at its end and not reopened
+            int reconnect_delay_ms = 2000; // < 0: a stream that fails stays down
+        };
+
+        // Called on a worker thread; must be thread-safe across streams.
+        using ResultFn = std::function<void(int stream_id, const video::Frame& frame, const std::vector<Det>& dets)>;
+
+        // engines: one worker thread per entry. The same engine may be listed more than once to
+        // share one session between workers (InferEngine::Run can be called concurrently), except
+        // an engine with persistent_io: its worker uses RunBound and owns it.
+        StreamManager(std::vector<InferEngine*> engines, ResultFn on_result);
+        StreamManager(std::vector<InferEngine*> engines, ResultFn on_result, const Options& opt);
+        ~StreamManager();
+
+        StreamManager(const StreamManager&) = delete;
+        StreamManager& operator=(const StreamManager&) = delete;
+
+        // Must be called before Start(). The source is opened on its own decode thread.
+        int AddStream(std::unique_ptr<video::IVideoSource> src, const StreamConfig& cfg);
+
+        void Start();
+
+        // Interrupts every source (a decode thread blocked in Open/Read returns) and joins all threads.
+        void Stop();
+
+        std::vector<StreamStats> GetStats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Stream {
+            int id = 0;
+            StreamConfig cfg;
+            std::unique_ptr<video::IVideoSource> src;
+            std::thread decode_thread;
+
+            // guarded by StreamManager::mu_
+            video::Frame latest;
+            bool has_frame = false;
+            bool busy = false;           // a worker is running this stream
+            double vtime = 0.0;          // virtual finish time (weighted fair queueing)
+            Clock::time_point next_allowed{};
+
+            std::atomic<uint64_t> decoded{ 0 };
+            std::atomic<uint64_t> inferred{ 0 };
+            std::atomic<uint64_t> dropped{ 0 };
+            std::atomic<uint64_t> reconnects{ 0 };
+            std::atomic<bool> connected{ false };
+            std::atomic<bool> finished{ false };
+            double infer_fps = 0.0;      // guarded by mu_
+            Clock::time_point last_infer{};
+            double first_result_ms = -1.0;  // guarded by mu_
+
+            // used by the one worker that has the stream busy
+            std::unique_ptr<MotionGate> gate;
+            std::unique_ptr<DeadlineGate> deadline;
+            std::vector<Det> last_dets;
+            std::unique_ptr<Tracker> tracker;
+        };
+
+        void DecodeLoop(Stream& s);
+        static bool IsLive(const std::string& url);
+        void WorkerLoop(InferEngine& engine);
+
+        // Picks the eligible stream with the smallest virtual time, critical streams first.
+        // Called with mu_ held.
+        Stream* PickLocked(Clock::time_point now, Clock::time_point& next_wakeup);
+
+    private:
+        std::vector<InferEngine*> engines_;
+        ResultFn on_result_;
+        Options opt_;
+
+        std::vector<std::unique_ptr<Stream>> streams_;
+        std::vector<std::thread> workers_;
+
+        mutable std::mutex mu_;
+        std::condition_variable cv_;       // workers: a frame arrived / a stream became free
+        std::condition_variable stop_cv_;  // decode threads sleeping before a reconnect
+        double vclock_ = 0.0;              // virtual time of the last scheduled frame
+        std::atomic<bool> stop_{ false };
+        bool started_ = false;
+        Clock::time_point start_time_{};
+    };
+
+} // namespace pipeline
@@ -1,9 +1,20 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+#include "video/frame_pool.h"
 #include "video/video_source.h"
 
 // ǰͷļ FFmpeg ͷٱȾ
 struct AVFormatContext;
+struct AVIOContext;
 struct AVCodecContext;
 struct AVFrame;
 struct AVPacket;
@@ -13,18 +24,133 @@ namespace video {
 
     class FFmpegVideoSource final : public IVideoSource {
     public:
+        enum class DecodeThreading {
+            Frame,          // best throughput for HD; adds ~1 frame of latency per extra thread
+            Slice,          // no added latency, only helps streams encoded with several slices
+            FrameAndSlice,  // let the codec pick
+        };
+
+        enum class SkipFrames {
+            None,
+            NonRef,   // drop non-reference (usually B) frames
+            NonKey,   // keyframes only: a few FPS for analytics that does not need more
+        };
+
+        enum class ScaleFilter {
+            FastBilinear,
+            Bilinear,
+            Area,
+        };
+
+        struct Options {
+            // Latest-frame-wins: a background thread demuxes + decodes continuously into a small
+            // ring, Read() returns the newest frame and reports the dropped ones in Frame::skipped.
+            // Frame age then stays bounded no matter how slow the consumer is.
+            bool async = false;
+            int ring_size = 2;
+
+            // async only: when the consumer has fallen behind - the ring is full, or its newest
+            // unread frame is older than drop_after_ms - drop compressed packets up to the next
+            // keyframe instead of decoding them (saves the decode cost of frames that would be
+            // dropped anyway; the decoder restarts cleanly at the keyframe). A consumer that just
+            // has not picked up the latest frame yet does not trigger it. Each skipped GOP counts
+            // as one dropped frame.
+            bool drop_packets_before_decode = false;
+            int drop_after_ms = 500;
+
+            // Output pixel format. BGR24 is always full resolution. RGB_PLANAR / NV12 let sws do the
+            // YUV conversion, the downscale to out_w x out_h and the letterbox placement in one
+            // pass (pads = grey 114), so the frame can go to the engine without another resize.
+            // NATIVE skips sws entirely: the pixels are only in Frame::source (zero-copy).
+            PixelFormat out_format = PixelFormat::BGR24;
+            int out_w = 0;  // 0 = source size (no scaling)
+            int out_h = 0;
+
+            // RGB_PLANAR / NV12: keep a reference to the decoded frame in Frame::source so that
+            // video::ToBGR can still produce a full-res BGR image when a consumer asks for it.
+            bool keep_source_frame = true;
+
+            // > 0: also fill Frame::luma, a luma_w wide thumbnail of the Y plane (YUV / NV12 /
+            // gray decoder output only), for pipeline::MotionGate
+            int luma_w = 0;
+
+            // Output pixels come from a FramePool of this many buffers. Frames can be kept by the
+            // consumer as long as needed; when all buffers are out, a sync Read() waits up to
+            // pool_timeout_ms (< 0: forever) and then throws, the async decode thread first drops
+            // unread frames and then waits (backpressure).
+            int pool_size = 8;
+            int pool_timeout_ms = -1;
+
+            // Decoder threads: 0 = one per core, 1 = single-threaded. Frame threading is not
+            // combined with AV_CODEC_FLAG_LOW_DELAY (FFmpeg would disable it).
+            int decode_threads = 0;
+            DecodeThreading threading = DecodeThreading::FrameAndSlice;
+            SkipFrames skip_frames = SkipFrames::None;
+
+            ScaleFilter scale_filter = ScaleFilter::Bilinear;
+
+            // Files / memory inputs: only frames with start_us <= pts_us < end_us come out (0 = from
+            // the start / to the end). Open() seeks to the keyframe at or before start_us; frames
+            // before start_us are decoded as references only. See pipeline::OfflineRunner.
+            int64_t start_us = 0;
+            int64_t end_us = 0;
+        };
+
         FFmpegVideoSource();
+        explicit FFmpegVideoSource(const Options& opt);
         ~FFmpegVideoSource() override;
 
+        // rtsp:// URLs get the live options (TCP transport, socket timeout, max_delay); anything
+        // else (local files, http) is opened with FFmpeg's defaults
         void Open(const std::string& url) override;
+
+        // A whole file held in memory, read through a custom AVIOContext (no temporary file).
+        // The buffer must stay valid until Close().
+        void OpenMemory(const uint8_t* data, size_t size);
+
+        // Demux-only pass over the input (nothing is decoded): pts_us of every video keyframe, in
+        // order, and in *end_us the end of the last frame. Rewinds to the start afterwards.
+        // Synchronous mode, seekable inputs only.
+        std::vector<int64_t> ScanKeyframes(int64_t* end_us = nullptr);
+
+        // RGB_PLANAR / NV12: change out_w x out_h while running (thread-safe); frames decoded
+        // after the call have the new size, sws is rebuilt once. Used by pipeline::AdaptiveSource
+        // to switch between model input sizes without reconnecting.
+        void SetOutputSize(int w, int h);
+
         bool Read(Frame& out) override;
         void Close() override;
+        void Interrupt() override;
 
     private:
+        void OpenInput(const std::string& url);
         void Cleanup();
-        void InitScalerIfNeeded(int src_w, int src_h, int src_pix_fmt);
+        void InitScalerIfNeeded(int src_w, int src_h, int src_pix_fmt, int dst_w, int dst_h, int dst_pix_fmt);
+
+        // Demux + decode the next video frame into a pooled buffer. false on EOF / error / stop.
+        bool DecodeNext(Frame& out);
+        bool ConvertBGR(Frame& out);
+        bool ConvertScaled(Frame& out);
+        bool AcquirePixels(cv::Mat& dst, int rows, int cols, int type);
+        void MakeLuma(Frame& out);
+
+        // async mode
+        void DecodeThread();
+        void StopDecodeThread();
+        static int InterruptCallback(void* opaque);
+
+        // OpenMemory
+        struct MemoryInput {
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            size_t pos = 0;
+        };
+        static int ReadMemory(void* opaque, uint8_t* buf, int size);
+        static int64_t SeekMemory(void* opaque, int64_t offset, int whence);
 
     private:
+        Options opt_;
+
         AVFormatContext* fmt_ = nullptr;
         AVCodecContext* dec_ = nullptr;
         AVFrame* frame_ = nullptr;   // ԭʼ֡ͨ YUV
@@ -32,9 +158,42 @@ namespace video {
         SwsContext* sws_ = nullptr;     // ظʽתYUV -> BGR
 
         int video_stream_index_ = -1;
+        std::atomic<uint64_t> out_size_{ 0 };  // (out_w << 32) | out_h, see SetOutputSize
+        bool draining_ = false;         // end of input reached, the decoder is being flushed
+
+        AVIOContext* avio_ = nullptr;   // OpenMemory
+        std::unique_ptr<MemoryInput> mem_;
 
-        //  BGR ĻϢⷴ䣩
-        cv::Mat bgr_;
+        // sws_ is rebuilt only when one of these changes
+        struct ScalerKey {
+            int src_w = 0, src_h = 0, src_fmt = -1;
+            int dst_w = 0, dst_h = 0, dst_fmt = -1;
+            int flags = 0;
+            bool operator==(const ScalerKey& o) const {
+                return src_w == o.src_w && src_h == o.src_h && src_fmt == o.src_fmt
+                    && dst_w == o.dst_w && dst_h == o.dst_h && dst_fmt == o.dst_fmt && flags == o.flags;
+            }
+        };
+        ScalerKey sws_key_;
+
+        // أüһͷʱգ
+        FramePool pool_;
+
+        // async mode: ring of decoded frames, newest at the back
+        std::thread decode_thread_;
+        std::atomic<bool> stop_{ false };
+        std::atomic<bool> interrupted_{ false };  // Interrupt(): sticky, unlike stop_
+        std::mutex ring_mu_;
+        std::condition_variable ring_cv_;
+        std::deque<Frame> ring_;
+        uint32_t skipped_ = 0;            // dropped since the last Read()
+        bool decode_done_ = false;        // EOF / error in the decode thread
+        bool skip_to_keyframe_ = false;
     };
 
+    // Full-resolution BGR view of a frame: the frame's own bgr for BGR24, otherwise a conversion
+    // of Frame::source (falls back to the model-size planes when the source was not kept).
+    // Returns false if there is nothing to convert. Thread-safe.
+    bool ToBGR(const Frame& f, cv::Mat& bgr);
+
 } // namespace video
@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "video/video_sink.h"
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVCodec;
+struct AVStream;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+namespace video {
+
+    // Writes annotated video to a local file; the container follows the extension (.mp4, .mkv, ...).
+    //
+    // Write() queues what the encoder needs without holding the decoder's FramePool buffers (a
+    // backlog would otherwise pin the whole pool and stall decoding): a reference to the decoded
+    // source frame when the frame has one, else a writer-owned copy of the pixels (BGR24, or the
+    // model-size planes). Drawing, BGR -> YUV conversion and encoding run on the writer's own
+    // thread. When the encoder falls behind and queue_size frames are waiting, further frames are
+    // skipped (Skipped(), cppinfer_frames_dropped_total{where="encoder"}) instead of stalling the
+    // caller; the file then has a lower frame rate, its timestamps stay those of the source.
+    //
+    // An encoder / file error is logged once, after which frames are discarded (Failed()): a broken
+    // recording does not stop the analytics.
+    class FFmpegVideoWriter final : public IVideoSink {
+    public:
+        struct Options {
+            std::string encoder;     // e.g. "libx264", "h264_nvenc"; empty = default H.264 encoder, else MPEG-4
+            int width = 0;           // output size; 0 = full-res size of the first frame
+            int height = 0;
+            int fps = 25;            // nominal rate, also the step for frames without increasing pts_us
+            int64_t bit_rate = 0;    // 0 = 2 bits per pixel per frame second (~4 Mbit/s at 1080p25)
+            int gop = 50;
+            int queue_size = 8;      // frames waiting for the encoder before new ones are skipped
+            bool draw = true;        // boxes + label; false = the plain video
+        };
+
+        // Throws if no usable encoder is found. The file is created at the first frame.
+        explicit FFmpegVideoWriter(std::string path);
+        FFmpegVideoWriter(std::string path, const Options& opt);
+        ~FFmpegVideoWriter() override;
+
+        FFmpegVideoWriter(const FFmpegVideoWriter&) = delete;
+        FFmpegVideoWriter& operator=(const FFmpegVideoWriter&) = delete;
+
+        bool Write(const Frame& frame, const std::vector<Det>& dets, const std::string& label) override;
+
+        // Encodes what is queued, writes the trailer and closes the file
+        void Close() override;
+
+        uint64_t Written() const { return written_.load(); }
+        uint64_t Skipped() const { return skipped_.load(); }
+        bool Failed() const { return failed_.load(); }
+
+    private:
+        struct Item {
+            Frame frame;
+            std::vector<Det> dets;
+            std::string label;
+        };
+
+        // frame without its pooled buffers, see the class comment
+        static Frame EncoderFrame(const Frame& frame);
+
+        void Loop();
+        void Open(int w, int h);
+        void Encode(const cv::Mat& bgr, int64_t pts_us);
+        void Send(AVFrame* in);
+        void Release();
+
+    private:
+        std::string path_;
+        Options opt_;
+        const AVCodec* codec_ = nullptr;
+
+        std::mutex mu_;
+        std::condition_variable cv_;
+        std::deque<Item> q_;
+        bool closing_ = false;
+        std::thread th_;
+
+        std::atomic<uint64_t> written_{ 0 };
+        std::atomic<uint64_t> skipped_{ 0 };
+        std::atomic<bool> failed_{ false };
+
+        // writer thread only
+        AVFormatContext* fmt_ = nullptr;
+        AVCodecContext* enc_ = nullptr;
+        AVStream* st_ = nullptr;
+        AVFrame* yuv_ = nullptr;
+        AVPacket* pkt_ = nullptr;
+        SwsContext* sws_ = nullptr;
+        bool header_written_ = false;
+        int64_t first_pts_us_ = 0;
+        int64_t last_pts_ = -1;  // ms
+        cv::Mat vis_;
+    };
+
+} // namespace video
@@ -1,13 +1,20 @@
 #pragma once
 #include <cstdint>
+#include <memory>
 #include <opencv2/opencv.hpp>
 
+#include "infer/letterbox.h"
+
+struct AVFrame;
+
 namespace video {
 
     enum class PixelFormat {
-        BGR24,     // cv::Mat(CV_8UC3)
+        BGR24,       // cv::Mat(CV_8UC3)
+        RGB_PLANAR,  // planes: CV_8UC1, 3*H rows = R, G, B planes ([3,H,W], model input layout)
+        NV12,        // planes: CV_8UC1, H*3/2 rows = Y plane + interleaved UV plane
+        NATIVE,      // no conversion: the decoder's own planes in Frame::source (zero-copy)
         // δչ
-        // NV12,
         // YUV420P,
     };
 
@@ -19,11 +26,40 @@ namespace video {
         // ʱ΢룩ӳͳơͬ·
         int64_t pts_us = 0;
 
+        // steady_clock time (us) at which the frame came out of the decoder; now - wall_us = frame age
+        int64_t wall_us = 0;
+
+        // async sources: decoded frames dropped between the previous Read() and this one
+        uint32_t skipped = 0;
+
+        // Pixel Mats from a FramePool are ref-counted like any cv::Mat: copies share the buffer,
+        // and it returns to the pool when the last one is released. No clone() needed to keep them.
+
         // ֽ׶ΣֱӸϲ cv::MatBGR
         // Լ union/variant  GPU buffer ֶ
         cv::Mat bgr;
 
-        bool empty() const { return bgr.empty() || width <= 0 || height <= 0; }
+        // RGB_PLANAR / NV12: the source scaled straight to the model input size by sws.
+        // width/height are the output size, src_width/src_height the decoded size, and lb maps
+        // output pixels back to source pixels (same convention as the engine's letterbox).
+        cv::Mat planes;
+        int src_width = 0;
+        int src_height = 0;
+        LetterBoxInfo lb;
+
+        // Reference to the decoded source frame (FFmpeg sources, scaled mode). Lets a consumer
+        // that needs full-res pixels (e.g. the visualizer) convert on demand, see video::ToBGR.
+        std::shared_ptr<AVFrame> source;
+
+        // Optional small grayscale thumbnail (CV_8UC1, e.g. 160 px wide) for change detection,
+        // downscaled straight from the decoder's Y plane (FFmpegVideoSource::Options::luma_w).
+        cv::Mat luma;
+
+        bool empty() const {
+            if (width <= 0 || height <= 0) return true;
+            if (format == PixelFormat::NATIVE) return !source;
+            return format == PixelFormat::BGR24 ? bgr.empty() : planes.empty();
+        }
     };
 
 } // namespace video
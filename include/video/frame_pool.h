@@ -0,0 +1,42 @@
+#pragma once
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+namespace video {
+
+    // Fixed-capacity pool of pixel buffers handed out as ordinary, ref-counted cv::Mat.
+    //
+    // The Mats use a custom cv::MatAllocator, so every copy of a Mat (or of the Frame holding it)
+    // keeps the buffer alive, and the buffer goes back to the pool when the last reference drops
+    // instead of being freed. Consumers can keep, queue or draw on frames without clone().
+    // Only the buffer Acquire() hands out is pooled: create() with another size on the Mat (or a
+    // copy of it) allocates outside the pool.
+    //
+    // Backpressure: at most `capacity` buffers are out at once; Acquire() waits for one to come
+    // back. Buffers may outlive the pool object (the allocator state is shared with them).
+    class FramePool {
+    public:
+        explicit FramePool(int capacity = 8);
+        ~FramePool();
+
+        FramePool(const FramePool&) = delete;
+        FramePool& operator=(const FramePool&) = delete;
+
+        // out = pooled rows x cols Mat of `type` (continuous). Waits while the pool is exhausted:
+        // timeout_ms < 0 waits forever, 0 does not wait. Returns false on timeout or after Close().
+        // One producer per pool: waiting and allocating are not a single atomic step.
+        bool Acquire(int rows, int cols, int type, cv::Mat& out, int timeout_ms = -1);
+
+        // Wakes waiting Acquire() calls and makes new ones fail until Reopen().
+        void Close();
+        void Reopen();
+
+        int Capacity() const;
+        int InUse() const;
+
+    private:
+        class Allocator;
+        std::shared_ptr<Allocator> alloc_;
+    };
+
+} // namespace video
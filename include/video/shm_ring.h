@@ -0,0 +1,198 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "common/det.h"
+#include "video/video_sink.h"
+
+// Publishing frames + detections to other processes through a shared-memory ring buffer
+// (POSIX shm_open + mmap; a named file mapping on Windows).
+//
+// One producer (ShmPublisher, an IVideoSink) and any number of readers (ShmReader) in other
+// processes. Each slot is guarded by its own sequence counter (a seqlock): the producer never
+// waits for anyone, a reader that is too slow just finds its frames overwritten and skips
+// ahead (counted as lost). Readers get the pixels as a cv::Mat over the shared memory itself.
+
+namespace video {
+
+    namespace shm {
+
+        constexpr uint32_t kMagic = 0x48535043;  // "CPSH"
+        constexpr uint32_t kVersion = 1;
+
+        // Pixel layout of a slot's image
+        enum class Image : int32_t {
+            None = 0,
+            BGR = 1,         // rows x cols CV_8UC3
+            RGB_PLANAR = 2,  // 3*H rows CV_8UC1 (R, G, B planes), letterboxed, see Slot::lb_*
+            NV12 = 3,        // H*3/2 rows CV_8UC1, letterboxed like RGB_PLANAR
+            GRAY = 4,        // rows x cols CV_8UC1 (Frame::luma thumbnail)
+        };
+
+        // Fixed-size, naturally aligned, little-endian: the layout is the protocol, readers in
+        // other languages can map it too. Memory: Header, then `slots` slots of slot_bytes each;
+        // a slot is Slot, Det[max_dets], image_capacity bytes of pixels.
+        struct alignas(64) Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t slots;
+            uint32_t max_dets;
+            uint64_t image_capacity;
+            uint64_t slot_bytes;
+            std::atomic<uint64_t> published;   // frames published so far; the newest is published - 1
+            std::atomic<uint32_t> closed;      // the producer has shut down
+        };
+
+        struct Det {
+            float x1, y1, x2, y2;  // source frame pixels
+            float score;
+            int32_t class_id;
+            int32_t track_id;
+            int32_t reserved;
+        };
+
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> seq;  // 2n+1 while frame n is being written, 2n+2 once complete
+            uint64_t frame_no;
+            int64_t pts_us;
+            int64_t wall_us;     // steady_clock when decoded (Frame::wall_us)
+            int64_t publish_us;  // steady_clock when published; the clock is system-wide
+            int32_t src_width;   // frame the boxes refer to
+            int32_t src_height;
+            Image image;
+            int32_t rows;
+            int32_t cols;
+            int32_t step;        // bytes per row, rows packed
+            float lb_scale;      // RGB_PLANAR / NV12: source px -> image px (x * scale + pad)
+            int32_t lb_pad_x;
+            int32_t lb_pad_y;
+            uint32_t n_dets;
+            uint64_t image_bytes;
+        };
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+            "shared-memory counters must be lock-free");
+
+        // Named shared memory; the creator owns the name and removes it again
+        class Mapping {
+        public:
+            Mapping() = default;
+            ~Mapping();
+
+            Mapping(const Mapping&) = delete;
+            Mapping& operator=(const Mapping&) = delete;
+
+            void Create(const std::string& name, size_t bytes);  // replaces a stale segment
+            void Open(const std::string& name);                  // read-only, whole segment
+
+            void Close();
+
+            uint8_t* Data() const { return data_; }
+            size_t Size() const { return size_; }
+
+        private:
+            std::string name_;
+            uint8_t* data_ = nullptr;
+            size_t size_ = 0;
+            bool owner_ = false;
+#ifdef _WIN32
+            void* handle_ = nullptr;
+#endif
+        };
+
+    } // namespace shm
+
+    class ShmPublisher final : public IVideoSink {
+    public:
+        enum class Pixels {
+            None,   // metadata and boxes only
+            Frame,  // the frame's own pixels: BGR, or the model-size planes (RGB_PLANAR / NV12)
+            Luma,   // the Frame::luma thumbnail
+        };
+
+        struct Options {
+            int slots = 8;
+            int max_dets = 256;                     // extra boxes are dropped
+            size_t image_capacity = 640 * 640 * 3;  // per slot; larger images go out without pixels
+            Pixels pixels = Pixels::Frame;
+        };
+
+        // name: e.g. "cppinfer" (shared memory "/cppinfer"). Throws if it cannot be created.
+        explicit ShmPublisher(const std::string& name);
+        ShmPublisher(const std::string& name, const Options& opt);
+        ~ShmPublisher() override;
+
+        // Wait-free: a few memcpy, never blocks on readers. The label is not published.
+        bool Write(const Frame& frame, const std::vector<Det>& dets, const std::string& label) override;
+
+        // Removes the name; attached readers keep their mapping (and see no new frames)
+        void Close() override;
+
+        uint64_t Published() const { return next_; }
+
+    private:
+        shm::Slot& SlotAt(uint64_t n) const;
+
+    private:
+        Options opt_;
+        shm::Mapping map_;
+        shm::Header* hdr_ = nullptr;
+        uint64_t next_ = 0;
+    };
+
+    class ShmReader {
+    public:
+        // One frame. The image points into shared memory (no copy): the producer may overwrite
+        // it at any time, so check Valid() after using it (or use Copy()).
+        struct View {
+            uint64_t frame_no = 0;
+            int64_t pts_us = 0;
+            int64_t wall_us = 0;
+            int64_t publish_us = 0;
+            int src_width = 0;
+            int src_height = 0;
+            shm::Image image_format = shm::Image::None;
+            cv::Mat image;
+            LetterBoxInfo lb;
+            std::vector<Det> dets;  // copied (and validated) by Next() / Latest()
+        };
+
+        // Throws if no publisher with this name exists or the layout version differs
+        explicit ShmReader(const std::string& name);
+
+        // The oldest frame not read yet; frames already overwritten are skipped (Lost()).
+        // false = nothing new.
+        bool Next(View& v);
+
+        // The newest frame, if it was not read yet (skips everything in between)
+        bool Latest(View& v);
+
+        // v's pixels are still those of its frame
+        bool Valid(const View& v) const;
+
+        // Copies v's pixels out; false if they were overwritten meanwhile
+        bool Copy(const View& v, cv::Mat& image) const;
+
+        uint64_t Published() const;
+        uint64_t Lost() const { return lost_; }
+
+        // The producer has shut down (a restarted producer needs a new reader)
+        bool Closed() const;
+
+    private:
+        bool Get(uint64_t n, View& v) const;
+        const shm::Slot& SlotAt(uint64_t n) const;
+
+    private:
+        std::string name_;
+        shm::Mapping map_;
+        const shm::Header* hdr_ = nullptr;
+        uint64_t next_ = 0;
+        uint64_t lost_ = 0;
+    };
+
+} // namespace video
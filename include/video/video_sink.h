@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "common/det.h"
+#include "video/frame.h"
+
+namespace video {
+
+    // Where results go. Write() is called for every result on one thread (e.g. the pipeline's
+    // render thread) and should return quickly: a sink that needs pixels converts and draws
+    // itself, so a headless run never touches them.
+    class IVideoSink {
+    public:
+        virtual ~IVideoSink() = default;
+
+        // label: one line of text for the overlay (may be empty). false = stop (window closed).
+        virtual bool Write(const Frame& frame, const std::vector<Det>& dets, const std::string& label) = 0;
+
+        // Flush and release; called once at the end (also by the destructors)
+        virtual void Close() {}
+    };
+
+    // Headless: drops everything, only counts
+    class NullSink final : public IVideoSink {
+    public:
+        bool Write(const Frame&, const std::vector<Det>&, const std::string&) override {
+            ++frames_;
+            return true;
+        }
+
+        uint64_t Frames() const { return frames_.load(); }
+
+    private:
+        std::atomic<uint64_t> frames_{ 0 };
+    };
+
+    // HighGUI window (the previous render path). The window belongs to the thread of the first
+    // Write(), so all calls must come from that thread. Write() returns false on 'q' / ESC.
+    class WindowSink final : public IVideoSink {
+    public:
+        explicit WindowSink(std::string title = "RT-DETR Live");
+
+        bool Write(const Frame& frame, const std::vector<Det>& dets, const std::string& label) override;
+
+    private:
+        std::string title_;
+        bool created_ = false;
+        cv::Mat vis_;
+    };
+
+    // Full-resolution BGR image of the frame with the boxes and the label drawn on it. Never
+    // draws into the frame's own (possibly shared) pixels. false if the frame has no pixels.
+    bool DrawFrame(const Frame& frame, const std::vector<Det>& dets, const std::string& label, cv::Mat& out);
+
+} // namespace video
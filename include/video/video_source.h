@@ -11,6 +11,11 @@ namespace video {
         virtual void Open(const std::string& url) = 0;
         virtual bool Read(Frame& out) = 0; //  false ʾʱ//ʵ־
         virtual void Close() = 0;
+
+        // Thread-safe, for shutdown: a blocking Open()/Read() on another thread returns (Open
+        // throws, Read returns false) and so does every later one. Default: not interruptible,
+        // the call returns at its own timeout.
+        virtual void Interrupt() { }
     };
 
 } // namespace video
@@ -0,0 +1,489 @@
+#include "common/det_log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+using detlog::BlockHeader;
+using detlog::FileHeader;
+
+static const char kFileMagic[8] = { 'C', 'P', 'D', 'E', 'T', 'L', 'O', 'G' };
+static const uint32_t kBlockMagic = 0x314b4c42;  // "BLK1"
+
+static size_t Align8(size_t v) {
+    return (v + 7) & ~size_t(7);
+}
+
+static int BitsFor(uint64_t v) {
+    int b = 0;
+    while (v) {
+        ++b;
+        v >>= 1;
+    }
+    return b;
+}
+
+// LSB-first bit packing. dst must be zeroed.
+static void PutBits(uint8_t* dst, size_t bitpos, uint64_t v, int width) {
+    for (int done = 0; done < width;) {
+        const size_t pos = bitpos + done;
+        const int shift = static_cast<int>(pos & 7);
+        const int take = std::min(8 - shift, width - done);
+        dst[pos >> 3] |= static_cast<uint8_t>(((v >> done) & ((1u << take) - 1)) << shift);
+        done += take;
+    }
+}
+
+// Columns are followed by at least 8 bytes of padding, so one unaligned 8-byte load covers any
+// value of up to 56 bits
+static uint64_t GetBits(const uint8_t* src, size_t bitpos, int width) {
+    if (width == 0) return 0;
+    if (width <= 56) {
+        uint64_t w;
+        std::memcpy(&w, src + (bitpos >> 3), sizeof(w));
+        return (w >> (bitpos & 7)) & ((uint64_t(1) << width) - 1);
+    }
+    uint64_t v = 0;
+    for (int i = 0; i < width; ++i) {
+        const size_t pos = bitpos + i;
+        v |= static_cast<uint64_t>((src[pos >> 3] >> (pos & 7)) & 1) << i;
+    }
+    return v;
+}
+
+// Scans the blocks of an open log: the offset after the last complete block
+static size_t ValidEnd(const uint8_t* data, size_t size, size_t from, std::vector<size_t>* blocks) {
+    size_t pos = from;
+    while (pos + sizeof(BlockHeader) <= size) {
+        BlockHeader h;
+        std::memcpy(&h, data + pos, sizeof(h));
+        if (h.magic != kBlockMagic || pos + sizeof(h) + h.payload_bytes > size) break;
+        if (blocks) blocks->push_back(pos);
+        pos += sizeof(h) + h.payload_bytes;
+    }
+    return pos;
+}
+
+static void CheckFileHeader(const FileHeader& fh, const std::string& path) {
+    if (std::memcmp(fh.magic, kFileMagic, sizeof(kFileMagic)) != 0) {
+        throw std::runtime_error("Not a detection log: " + path);
+    }
+    if (fh.version != detlog::kVersion || fh.header_bytes != sizeof(FileHeader)) {
+        throw std::runtime_error("Unsupported detection log version in " + path);
+    }
+}
+
+// ---------------------------------------------------------------- writer
+
+void DetLogWriter::Block::Reserve(size_t n) {
+    stream.reserve(n);
+    pts.reserve(n);
+    cls.reserve(n);
+    track.reserve(n);
+    for (auto* v : { &x1, &y1, &x2, &y2, &score }) v->reserve(n);
+}
+
+DetLogWriter::DetLogWriter(const std::string& path)
+    : DetLogWriter(path, Options()) { }
+
+DetLogWriter::DetLogWriter(const std::string& path, const Options& opt)
+    : path_(path),
+    opt_(opt) {
+    opt_.block_rows = std::max(1, opt_.block_rows);
+    opt_.flush_interval_ms = std::max(10, opt_.flush_interval_ms);
+
+    std::error_code ec;
+    const uintmax_t size = fs::exists(path_, ec) ? fs::file_size(path_, ec) : 0;
+    if (size > 0) {
+        // existing log: continue after its last complete block (drops a tail cut off by a crash)
+        std::ifstream in(path_, std::ios::binary);
+        FileHeader fh{};
+        if (!in.read(reinterpret_cast<char*>(&fh), sizeof(fh))) throw std::runtime_error("Not a detection log: " + path_);
+        CheckFileHeader(fh, path_);
+
+        size_t end = sizeof(FileHeader);
+        BlockHeader h{};
+        while (in.seekg(static_cast<std::streamoff>(end)) && in.read(reinterpret_cast<char*>(&h), sizeof(h))) {
+            if (h.magic != kBlockMagic || end + sizeof(h) + h.payload_bytes > size) break;
+            end += sizeof(h) + h.payload_bytes;
+        }
+        in.close();
+        if (end < size) {
+            std::cerr << "[DetLog] " << path_ << ": dropping " << (size - end) << " bytes of an incomplete block\n";
+            fs::resize_file(path_, end);
+        }
+        file_.open(path_, std::ios::binary | std::ios::app);
+    }
+    else {
+        file_.open(path_, std::ios::binary | std::ios::trunc);
+        FileHeader fh{};
+        std::memcpy(fh.magic, kFileMagic, sizeof(kFileMagic));
+        fh.version = detlog::kVersion;
+        fh.header_bytes = sizeof(FileHeader);
+        file_.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
+        file_.flush();
+    }
+    if (!file_) throw std::runtime_error("Cannot write detection log: " + path_);
+
+    cur_.Reserve(opt_.block_rows);
+    th_ = std::thread(&DetLogWriter::Loop, this);
+}
+
+DetLogWriter::~DetLogWriter() {
+    Close();
+}
+
+void DetLogWriter::Append(uint32_t stream_id, int64_t pts_us, const std::vector<Det>& dets) {
+    if (dets.empty()) return;
+    std::lock_guard<std::mutex> lk(mu_);
+    if (failed_ || closing_) return;
+
+    for (const Det& d : dets) {
+        cur_.stream.push_back(stream_id);
+        cur_.pts.push_back(pts_us);
+        cur_.cls.push_back(d.class_id);
+        cur_.track.push_back(d.track_id);
+        cur_.x1.push_back(d.x1);
+        cur_.y1.push_back(d.y1);
+        cur_.x2.push_back(d.x2);
+        cur_.y2.push_back(d.y2);
+        cur_.score.push_back(d.score);
+        if (cur_.Rows() >= static_cast<size_t>(opt_.block_rows)) Seal();
+    }
+    rows_ += dets.size();
+}
+
+void DetLogWriter::Seal() {
+    sealed_.push_back(std::move(cur_));
+    ++sealed_count_;
+    cur_ = Block();
+    cur_.Reserve(opt_.block_rows);
+    cv_.notify_one();
+}
+
+void DetLogWriter::Flush() {
+    std::unique_lock<std::mutex> lk(mu_);
+    if (cur_.Rows() > 0) Seal();
+    const uint64_t target = sealed_count_;
+    flushed_cv_.wait(lk, [&] { return written_count_ >= target; });
+}
+
+void DetLogWriter::Close() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        closing_ = true;
+    }
+    cv_.notify_all();
+    if (th_.joinable()) th_.join();
+    if (file_.is_open()) file_.close();
+}
+
+uint64_t DetLogWriter::Rows() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return rows_;
+}
+
+uint64_t DetLogWriter::BytesWritten() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return bytes_;
+}
+
+bool DetLogWriter::Failed() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return failed_;
+}
+
+void DetLogWriter::Loop() {
+    std::unique_lock<std::mutex> lk(mu_);
+    for (;;) {
+        cv_.wait_for(lk, std::chrono::milliseconds(opt_.flush_interval_ms),
+            [&] { return closing_ || !sealed_.empty(); });
+        // interval over (or closing) with nothing full: write the partial block
+        if (sealed_.empty() && cur_.Rows() > 0) Seal();
+        if (sealed_.empty()) {
+            if (closing_) break;
+            continue;
+        }
+
+        Block b = std::move(sealed_.front());
+        sealed_.pop_front();
+        const bool failed = failed_;
+        lk.unlock();
+
+        size_t n = 0;
+        bool ok = true;
+        if (!failed) {
+            try {
+                n = WriteBlock(b);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[DetLog] " << path_ << ": " << e.what() << " (logging stopped)\n";
+                ok = false;
+            }
+        }
+
+        lk.lock();
+        if (!ok) failed_ = true;
+        bytes_ += n;
+        ++written_count_;
+        flushed_cv_.notify_all();
+    }
+}
+
+size_t DetLogWriter::WriteBlock(const Block& b) {
+    const size_t rows = b.Rows();
+    BlockHeader h{};
+    h.magic = kBlockMagic;
+    h.rows = static_cast<uint32_t>(rows);
+    h.t_min = *std::min_element(b.pts.begin(), b.pts.end());
+    h.t_max = *std::max_element(b.pts.begin(), b.pts.end());
+    for (int32_t c : b.cls) h.class_mask |= uint64_t(1) << std::clamp(c, 0, 63);
+    h.packed = opt_.packed ? 1 : 0;
+
+    // integer columns as int64 (pts as deltas when packed)
+    std::vector<int64_t> ints[detlog::kNumIntColumns];
+    for (auto& v : ints) v.resize(rows);
+    int64_t prev = h.t_min;
+    for (size_t r = 0; r < rows; ++r) {
+        ints[detlog::kStream][r] = b.stream[r];
+        ints[detlog::kPts][r] = opt_.packed ? b.pts[r] - prev : b.pts[r];
+        ints[detlog::kClass][r] = b.cls[r];
+        ints[detlog::kTrack][r] = b.track[r];
+        prev = b.pts[r];
+    }
+
+    // layout
+    size_t size = 0;
+    for (int c = 0; c < detlog::kNumIntColumns; ++c) {
+        h.offset[c] = static_cast<uint32_t>(size);
+        size_t bytes;
+        if (opt_.packed) {
+            const auto mm = std::minmax_element(ints[c].begin(), ints[c].end());
+            h.base[c] = *mm.first;
+            h.width[c] = static_cast<uint8_t>(BitsFor(static_cast<uint64_t>(*mm.second) - static_cast<uint64_t>(*mm.first)));
+            bytes = (rows * h.width[c] + 7) / 8 + 8;  // padding for GetBits
+        }
+        else {
+            bytes = rows * (c == detlog::kPts ? sizeof(int64_t) : sizeof(int32_t));
+        }
+        size = Align8(size + bytes);
+    }
+    for (int c = detlog::kX1; c < detlog::kNumColumns; ++c) {
+        h.offset[c] = static_cast<uint32_t>(size);
+        size = Align8(size + rows * sizeof(float));
+    }
+    h.payload_bytes = static_cast<uint32_t>(size);
+
+    buf_.assign(sizeof(h) + size, 0);
+    uint8_t* payload = buf_.data() + sizeof(h);
+    for (int c = 0; c < detlog::kNumIntColumns; ++c) {
+        uint8_t* dst = payload + h.offset[c];
+        if (opt_.packed) {
+            const int w = h.width[c];
+            for (size_t r = 0; r < rows; ++r) {
+                PutBits(dst, r * w, static_cast<uint64_t>(ints[c][r]) - static_cast<uint64_t>(h.base[c]), w);
+            }
+        }
+        else if (c == detlog::kPts) {
+            std::memcpy(dst, b.pts.data(), rows * sizeof(int64_t));
+        }
+        else {
+            const void* src = c == detlog::kStream ? static_cast<const void*>(b.stream.data())
+                : c == detlog::kClass ? static_cast<const void*>(b.cls.data()) : static_cast<const void*>(b.track.data());
+            std::memcpy(dst, src, rows * sizeof(int32_t));
+        }
+    }
+    const std::vector<float>* floats[] = { &b.x1, &b.y1, &b.x2, &b.y2, &b.score };
+    for (int c = detlog::kX1; c < detlog::kNumColumns; ++c) {
+        std::memcpy(payload + h.offset[c], floats[c - detlog::kX1]->data(), rows * sizeof(float));
+    }
+    std::memcpy(buf_.data(), &h, sizeof(h));
+
+    file_.write(reinterpret_cast<const char*>(buf_.data()), static_cast<std::streamsize>(buf_.size()));
+    file_.flush();
+    if (!file_) throw std::runtime_error("write failed");
+    return buf_.size();
+}
+
+// ---------------------------------------------------------------- reader
+
+struct DetLogReader::Map {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    explicit Map(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open " + path);
+        LARGE_INTEGER sz{};
+        GetFileSizeEx(file, &sz);
+        size = static_cast<size_t>(sz.QuadPart);
+        if (size > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (!data) {
+                Release();
+                throw std::runtime_error("Cannot map " + path);
+            }
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open " + path);
+        struct stat st {};
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path);
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map " + path);
+            }
+            data = static_cast<const uint8_t*>(p);
+            // blocks are visited in file order, often only a few of them
+            madvise(p, size, MADV_RANDOM);
+        }
+        ::close(fd);
+#endif
+    }
+
+    ~Map() { Release(); }
+
+    void Release() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+        data = nullptr;
+    }
+};
+
+DetLogReader::DetLogReader(const std::string& path)
+    : path_(path) {
+    map_ = std::make_unique<Map>(path_);
+    if (map_->size < sizeof(FileHeader)) throw std::runtime_error("Not a detection log: " + path_);
+    FileHeader fh;
+    std::memcpy(&fh, map_->data, sizeof(fh));
+    CheckFileHeader(fh, path_);
+
+    indexed_end_ = sizeof(FileHeader);
+    Index();
+}
+
+DetLogReader::~DetLogReader() = default;
+
+void DetLogReader::Index() {
+    const size_t first = blocks_.size();
+    indexed_end_ = ValidEnd(map_->data, map_->size, indexed_end_, &blocks_);
+    for (size_t i = first; i < blocks_.size(); ++i) {
+        BlockHeader h;
+        std::memcpy(&h, map_->data + blocks_[i], sizeof(h));
+        rows_ += h.rows;
+        t_min_ = std::min(t_min_, h.t_min);
+        t_max_ = std::max(t_max_, h.t_max);
+    }
+}
+
+void DetLogReader::Refresh() {
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(path_, ec);
+    if (ec || size <= map_->size) return;
+    map_ = std::make_unique<Map>(path_);
+    Index();
+}
+
+void DetLogReader::Scan(const Query& q, const std::function<void(const detlog::Record&)>& fn) const {
+    if (q.t_begin >= q.t_end) return;
+    const uint64_t class_bit = q.class_id >= 0 ? uint64_t(1) << std::min(q.class_id, 63) : 0;
+
+    for (size_t off : blocks_) {
+        // the header lives in the mapping at an 8-byte aligned offset
+        const BlockHeader& h = *reinterpret_cast<const BlockHeader*>(map_->data + off);
+        if (h.t_max < q.t_begin || h.t_min >= q.t_end) continue;
+        if (class_bit && !(h.class_mask & class_bit)) continue;
+        ScanBlock(h, map_->data + off + sizeof(BlockHeader), q, fn);
+    }
+}
+
+std::vector<detlog::Record> DetLogReader::Scan(const Query& q) const {
+    std::vector<detlog::Record> out;
+    Scan(q, [&](const detlog::Record& r) { out.push_back(r); });
+    return out;
+}
+
+void DetLogReader::ScanBlock(const BlockHeader& h, const uint8_t* payload, const Query& q,
+    const std::function<void(const detlog::Record&)>& fn) const {
+    auto get_int = [&](int c, uint32_t r) -> int64_t {
+        const uint8_t* col = payload + h.offset[c];
+        if (h.packed) return h.base[c] + static_cast<int64_t>(GetBits(col, static_cast<size_t>(r) * h.width[c], h.width[c]));
+        if (c == detlog::kPts) {
+            int64_t v;
+            std::memcpy(&v, col + static_cast<size_t>(r) * sizeof(v), sizeof(v));
+            return v;
+        }
+        int32_t v;
+        std::memcpy(&v, col + static_cast<size_t>(r) * sizeof(v), sizeof(v));
+        return c == detlog::kStream ? static_cast<int64_t>(static_cast<uint32_t>(v)) : v;
+    };
+    auto get_float = [&](int c, uint32_t r) {
+        float v;
+        std::memcpy(&v, payload + h.offset[c] + static_cast<size_t>(r) * sizeof(v), sizeof(v));
+        return v;
+    };
+
+    // time filter is a no-op for blocks entirely inside the range
+    const bool check_time = h.t_min < q.t_begin || h.t_max >= q.t_end;
+    int64_t pts = h.t_min;  // packed: running sum of the deltas
+    detlog::Record rec{};
+    for (uint32_t r = 0; r < h.rows; ++r) {
+        if (h.packed) pts += get_int(detlog::kPts, r);
+        else pts = get_int(detlog::kPts, r);
+
+        if (check_time && (pts < q.t_begin || pts >= q.t_end)) continue;
+        if (q.class_id >= 0 && get_int(detlog::kClass, r) != q.class_id) continue;
+        const int64_t stream = get_int(detlog::kStream, r);
+        if (q.stream_id >= 0 && stream != q.stream_id) continue;
+
+        rec.stream_id = static_cast<uint32_t>(stream);
+        rec.pts_us = pts;
+        rec.det.x1 = get_float(detlog::kX1, r);
+        rec.det.y1 = get_float(detlog::kY1, r);
+        rec.det.x2 = get_float(detlog::kX2, r);
+        rec.det.y2 = get_float(detlog::kY2, r);
+        rec.det.score = get_float(detlog::kScore, r);
+        rec.det.class_id = static_cast<int>(get_int(detlog::kClass, r));
+        rec.det.track_id = static_cast<int>(get_int(detlog::kTrack, r));
+        fn(rec);
+    }
+}
@@ -0,0 +1,255 @@
+#include "common/metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace metrics {
+
+    uint64_t Counter::Value() const {
+        uint64_t v = 0;
+        shards_.ForEach([&](const Shard& s) { v += s.v.load(std::memory_order_relaxed); });
+        return v;
+    }
+
+    // ---------------- Histogram ----------------
+
+    int Histogram::Index(uint64_t ns) {
+        if (ns < static_cast<uint64_t>(kSub)) return static_cast<int>(ns);
+
+        int e = 63;
+        while (!(ns >> e)) --e;  // highest set bit, >= kSubBits
+        if (e > kMaxExp) return kBuckets - 1;
+
+        const int sub = static_cast<int>((ns >> (e - kSubBits)) & (kSub - 1));
+        return (e - kSubBits + 1) * kSub + sub;
+    }
+
+    uint64_t Histogram::BucketLow(int index) {
+        if (index < kSub) return static_cast<uint64_t>(index);
+        const int e = index / kSub + kSubBits - 1;
+        const uint64_t sub = static_cast<uint64_t>(index % kSub);
+        return (static_cast<uint64_t>(kSub) + sub) << (e - kSubBits);
+    }
+
+    uint64_t Histogram::BucketHigh(int index) {
+        if (index < kSub) return static_cast<uint64_t>(index);
+        const int e = index / kSub + kSubBits - 1;
+        return BucketLow(index) + (uint64_t(1) << (e - kSubBits)) - 1;
+    }
+
+    double Histogram::Snapshot::Quantile(double q) const {
+        if (count == 0) return std::numeric_limits<double>::quiet_NaN();
+
+        const double rank = std::max(1.0, std::ceil(q * static_cast<double>(count)));
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (static_cast<double>(seen) >= rank) {
+                return 0.5 * (static_cast<double>(BucketLow(i)) + static_cast<double>(BucketHigh(i)));
+            }
+        }
+        return static_cast<double>(BucketHigh(kBuckets - 1));
+    }
+
+    Histogram::Snapshot Histogram::TakeSnapshot() {
+        Snapshot s;
+        s.counts.assign(kBuckets, 0);
+        shards_.ForEach([&](Shard& sh) {
+            for (int i = 0; i < kBuckets; ++i) s.counts[i] += sh.counts[i].load(std::memory_order_relaxed);
+            s.count += sh.count.load(std::memory_order_relaxed);
+            s.sum += sh.sum.load(std::memory_order_relaxed);
+            // the writer may overwrite the reset with a smaller value; that sample then just
+            // counts for the next interval
+            s.max = std::max(s.max, sh.max.exchange(0, std::memory_order_relaxed));
+        });
+        return s;
+    }
+
+    // ---------------- Registry ----------------
+
+    Registry& Registry::Global() {
+        static Registry r;
+        return r;
+    }
+
+    Registry::Entry& Registry::Get(const std::string& name, const std::string& labels,
+        const std::string& help, Type type) {
+        std::lock_guard<std::mutex> lk(mu_);
+
+        auto fit = std::find_if(families_.begin(), families_.end(),
+            [&](const std::unique_ptr<Family>& f) { return f->name == name; });
+        if (fit == families_.end()) {
+            auto f = std::make_unique<Family>();
+            f->name = name;
+            f->help = help;
+            f->type = type;
+            families_.push_back(std::move(f));
+            fit = families_.end() - 1;
+        }
+        Family& fam = **fit;
+        if (fam.type != type) {
+            throw std::runtime_error("metrics: " + name + " is already registered with another type.");
+        }
+
+        for (auto& e : fam.entries) {
+            if (e->labels == labels) return *e;
+        }
+
+        auto e = std::make_unique<Entry>();
+        e->labels = labels;
+        switch (type) {
+        case Type::Counter: e->counter = std::make_unique<Counter>(); break;
+        case Type::Gauge: e->gauge = std::make_unique<Gauge>(); break;
+        case Type::Histogram: e->histogram = std::make_unique<Histogram>(); break;
+        }
+        fam.entries.push_back(std::move(e));
+        return *fam.entries.back();
+    }
+
+    Counter& Registry::GetCounter(const std::string& name, const std::string& labels, const std::string& help) {
+        return *Get(name, labels, help, Type::Counter).counter;
+    }
+
+    Gauge& Registry::GetGauge(const std::string& name, const std::string& labels, const std::string& help) {
+        return *Get(name, labels, help, Type::Gauge).gauge;
+    }
+
+    Histogram& Registry::GetHistogram(const std::string& name, const std::string& labels, const std::string& help) {
+        return *Get(name, labels, help, Type::Histogram).histogram;
+    }
+
+    // {labels} / {labels,extra} / {extra} / nothing
+    static std::string LabelSet(const std::string& labels, const std::string& extra = "") {
+        if (labels.empty() && extra.empty()) return "";
+        if (labels.empty()) return "{" + extra + "}";
+        if (extra.empty()) return "{" + labels + "}";
+        return "{" + labels + "," + extra + "}";
+    }
+
+    static void WriteValue(std::ostream& os, double v) {
+        if (std::isnan(v)) os << "NaN";
+        else os << v;
+    }
+
+    void Registry::WritePrometheus(std::ostream& os) {
+        std::lock_guard<std::mutex> lk(mu_);
+        os << std::setprecision(9);
+
+        for (const auto& fp : families_) {
+            Family& f = *fp;
+            if (!f.help.empty()) os << "# HELP " << f.name << " " << f.help << "\n";
+
+            if (f.type == Type::Counter) {
+                os << "# TYPE " << f.name << " counter\n";
+                for (const auto& e : f.entries) {
+                    os << f.name << LabelSet(e->labels) << " " << e->counter->Value() << "\n";
+                }
+                continue;
+            }
+            if (f.type == Type::Gauge) {
+                os << "# TYPE " << f.name << " gauge\n";
+                for (const auto& e : f.entries) {
+                    os << f.name << LabelSet(e->labels) << " ";
+                    WriteValue(os, e->gauge->Value());
+                    os << "\n";
+                }
+                continue;
+            }
+
+            // histogram -> summary (seconds) + separate _max gauge family
+            std::vector<double> maxes;
+            os << "# TYPE " << f.name << " summary\n";
+            for (const auto& e : f.entries) {
+                Histogram::Snapshot cur = e->histogram->TakeSnapshot();
+
+                Histogram::Snapshot win;
+                win.counts = cur.counts;
+                if (e->prev_counts.size() == cur.counts.size()) {
+                    for (size_t i = 0; i < win.counts.size(); ++i) win.counts[i] -= e->prev_counts[i];
+                }
+                for (uint64_t c : win.counts) win.count += c;
+                e->prev_counts = std::move(cur.counts);
+
+                for (double q : { 0.5, 0.95, 0.99 }) {
+                    std::ostringstream ql;
+                    ql << "quantile=\"" << q << "\"";
+                    os << f.name << LabelSet(e->labels, ql.str()) << " ";
+                    WriteValue(os, win.Quantile(q) * 1e-9);
+                    os << "\n";
+                }
+                os << f.name << "_sum" << LabelSet(e->labels) << " " << static_cast<double>(cur.sum) * 1e-9 << "\n";
+                os << f.name << "_count" << LabelSet(e->labels) << " " << cur.count << "\n";
+
+                maxes.push_back(win.count ? static_cast<double>(cur.max) * 1e-9 : std::numeric_limits<double>::quiet_NaN());
+            }
+
+            os << "# TYPE " << f.name << "_max gauge\n";
+            for (size_t i = 0; i < f.entries.size(); ++i) {
+                os << f.name << "_max" << LabelSet(f.entries[i]->labels) << " ";
+                WriteValue(os, maxes[i]);
+                os << "\n";
+            }
+        }
+    }
+
+    Histogram& Stage(const std::string& stage) {
+        return Registry::Global().GetHistogram("cppinfer_stage_seconds", "stage=\"" + stage + "\"",
+            "Per-frame time of each pipeline stage");
+    }
+
+    Counter& Dropped(const std::string& where) {
+        return Registry::Global().GetCounter("cppinfer_frames_dropped_total", "where=\"" + where + "\"",
+            "Frames dropped before inference");
+    }
+
+    // ---------------- FileExporter ----------------
+
+    FileExporter::FileExporter(std::string path, int interval_ms, Registry& registry)
+        : path_(std::move(path)),
+        interval_ms_(std::max(100, interval_ms)),
+        registry_(registry) {
+        thread_ = std::thread(&FileExporter::Loop, this);
+    }
+
+    FileExporter::~FileExporter() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+        WriteNow();
+    }
+
+    void FileExporter::WriteNow() {
+        std::ostringstream text;
+        registry_.WritePrometheus(text);
+
+        // scrapers must never see a half-written file
+        const std::string tmp = path_ + ".tmp";
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            if (!f) return;
+            f << text.str();
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path_, ec);
+    }
+
+    void FileExporter::Loop() {
+        std::unique_lock<std::mutex> lk(mu_);
+        while (!stop_) {
+            if (cv_.wait_for(lk, std::chrono::milliseconds(interval_ms_), [&] { return stop_; })) break;
+            lk.unlock();
+            WriteNow();
+            lk.lock();
+        }
+    }
+
+} // namespace metrics
@@ -0,0 +1,236 @@
+#include "common/tracker.h"
+#include <algorithm>
+
+static inline float IoU(float ax1, float ay1, float ax2, float ay2, float bx1, float by1, float bx2, float by2) {
+    const float iw = std::min(ax2, bx2) - std::max(ax1, bx1);
+    const float ih = std::min(ay2, by2) - std::max(ay1, by1);
+    if (iw <= 0.f || ih <= 0.f) return 0.f;
+    const float inter = iw * ih;
+    const float uni = (ax2 - ax1) * (ay2 - ay1) + (bx2 - bx1) * (by2 - by1) - inter;
+    return uni > 0.f ? inter / uni : 0.f;
+}
+
+Tracker::Tracker()
+    : Tracker(Options()) { }
+
+Tracker::Tracker(const Options& opt)
+    : opt_(opt) { }
+
+void Tracker::Reset() {
+    tracks_.clear();
+    next_id_ = 0;
+    has_time_ = false;
+}
+
+Tracker::Box Tracker::BoxOf(const Track& tr) {
+    const float cx = tr.k[0].x, cy = tr.k[1].x;
+    const float hw = 0.5f * tr.k[2].x, hh = 0.5f * tr.k[3].x;
+    return { cx - hw, cy - hh, cx + hw, cy + hh };
+}
+
+void Tracker::Step(int64_t t_us) {
+    double dt = opt_.default_dt_s;
+    if (has_time_ && t_us > last_t_us_) dt = static_cast<double>(t_us - last_t_us_) * 1e-6;
+    last_t_us_ = t_us; // also resyncs after a timestamp jump backwards (e.g. reconnect)
+    has_time_ = true;
+
+    // a track this old is dropped anyway; keeps the covariance finite
+    PredictAll(std::min(dt, opt_.max_age_s + opt_.default_dt_s));
+}
+
+void Tracker::PredictAll(double dt_s) {
+    const float dt = static_cast<float>(dt_s);
+    const float dt2 = dt * dt;
+
+    for (Track& tr : tracks_) {
+        const float w = tr.k[2].x, h = tr.k[3].x;
+        for (int c = 0; c < 4; ++c) {
+            Kf& k = tr.k[c];
+            const float s = opt_.accel_std * ((c & 1) ? h : w);
+            const float q = s * s;  // white acceleration noise: Q = q * [dt^3/3, dt^2/2; dt^2/2, dt]
+
+            k.x += k.v * dt;
+            k.pxx += dt * (2.f * k.pxv + dt * k.pvv) + q * dt2 * dt / 3.f;
+            k.pxv += dt * k.pvv + q * dt2 * 0.5f;
+            k.pvv += q * dt;
+        }
+        tr.k[2].x = std::max(tr.k[2].x, 1.f);
+        tr.k[3].x = std::max(tr.k[3].x, 1.f);
+
+        tr.since_match_s += dt_s;
+        tr.matched = false;
+    }
+}
+
+void Tracker::StartTrack(const Det& d) {
+    const float z[4] = { 0.5f * (d.x1 + d.x2), 0.5f * (d.y1 + d.y2), d.x2 - d.x1, d.y2 - d.y1 };
+
+    Track tr;
+    for (int c = 0; c < 4; ++c) {
+        const float s = std::max((c & 1) ? z[3] : z[2], 1.f);
+        const float sp = 2.f * opt_.meas_std * s;
+        const float sv = opt_.init_vel_std * s;
+        tr.k[c] = { z[c], 0.f, sp * sp, 0.f, sv * sv };
+    }
+    tr.class_id = d.class_id;
+    tr.score = d.score;
+    tr.hits = 1;
+    tr.matched = true;
+    if (tr.hits >= opt_.min_hits) tr.id = next_id_++;
+    tracks_.push_back(tr);
+}
+
+void Tracker::Correct(Track& tr, const Det& d) {
+    const float z[4] = { 0.5f * (d.x1 + d.x2), 0.5f * (d.y1 + d.y2), d.x2 - d.x1, d.y2 - d.y1 };
+
+    for (int c = 0; c < 4; ++c) {
+        Kf& k = tr.k[c];
+        const float s = opt_.meas_std * std::max((c & 1) ? z[3] : z[2], 1.f);
+        const float inv = 1.f / (k.pxx + s * s);
+        const float gx = k.pxx * inv, gv = k.pxv * inv;
+        const float y = z[c] - k.x;
+
+        k.x += gx * y;
+        k.v += gv * y;
+        k.pvv -= gv * k.pxv;
+        k.pxx -= gx * k.pxx;
+        k.pxv -= gx * k.pxv;
+    }
+    tr.k[2].x = std::max(tr.k[2].x, 1.f);
+    tr.k[3].x = std::max(tr.k[3].x, 1.f);
+
+    tr.class_id = d.class_id;
+    tr.score = d.score;
+    tr.since_match_s = 0.0;
+    tr.matched = true;
+    if (++tr.hits >= opt_.min_hits && tr.id < 0) tr.id = next_id_++;
+}
+
+void Tracker::Match(const std::vector<Det>& dets, const std::vector<int>& di, const std::vector<int>& ti,
+    float min_iou, std::vector<int>& det_track) {
+    if (di.empty() || ti.empty()) return;
+
+    torder_ = ti;
+    dorder_ = di;
+    std::sort(torder_.begin(), torder_.end(), [&](int a, int b) { return tbox_[a].x1 < tbox_[b].x1; });
+    std::sort(dorder_.begin(), dorder_.end(), [&](int a, int b) { return dets[a].x1 < dets[b].x1; });
+
+    auto try_pair = [&](int t, int d) {
+        const Det& dd = dets[d];
+        if (opt_.per_class && tracks_[t].class_id != dd.class_id) return;
+        const Box& tb = tbox_[t];
+        const float iou = IoU(tb.x1, tb.y1, tb.x2, tb.y2, dd.x1, dd.y1, dd.x2, dd.y2);
+        if (iou >= min_iou && iou > 0.f) pairs_.push_back({ iou, t, d });
+    };
+
+    // sweep left to right: a box is only tested against the boxes of the other side that are
+    // still open (started before it and not yet ended)
+    pairs_.clear();
+    tactive_.clear();
+    dactive_.clear();
+    size_t a = 0, b = 0;
+    while (a < torder_.size() || b < dorder_.size()) {
+        const bool take_track = b == dorder_.size()
+            || (a < torder_.size() && tbox_[torder_[a]].x1 <= dets[dorder_[b]].x1);
+        if (take_track) {
+            const int t = torder_[a++];
+            const float x1 = tbox_[t].x1;
+            size_t n = 0;
+            for (size_t i = 0; i < dactive_.size(); ++i) {
+                const int d = dactive_[i];
+                if (dets[d].x2 <= x1) continue;  // ended, drop it
+                dactive_[n++] = d;
+                try_pair(t, d);
+            }
+            dactive_.resize(n);
+            tactive_.push_back(t);
+        }
+        else {
+            const int d = dorder_[b++];
+            const float x1 = dets[d].x1;
+            size_t n = 0;
+            for (size_t i = 0; i < tactive_.size(); ++i) {
+                const int t = tactive_[i];
+                if (tbox_[t].x2 <= x1) continue;
+                tactive_[n++] = t;
+                try_pair(t, d);
+            }
+            tactive_.resize(n);
+            dactive_.push_back(d);
+        }
+    }
+
+    std::sort(pairs_.begin(), pairs_.end(), [](const Pair& p, const Pair& q) {
+        if (p.iou != q.iou) return p.iou > q.iou;
+        return p.t != q.t ? p.t < q.t : p.d < q.d;
+    });
+    for (const Pair& p : pairs_) {
+        if (tracks_[p.t].matched || det_track[p.d] >= 0) continue;
+        det_track[p.d] = p.t;
+        Correct(tracks_[p.t], dets[p.d]);
+    }
+}
+
+void Tracker::Update(const std::vector<Det>& dets, int64_t t_us, std::vector<Det>& out) {
+    Step(t_us);
+
+    tbox_.resize(tracks_.size());
+    for (size_t i = 0; i < tracks_.size(); ++i) tbox_[i] = BoxOf(tracks_[i]);
+
+    high_.clear();
+    low_.clear();
+    for (int i = 0; i < static_cast<int>(dets.size()); ++i) {
+        (dets[i].score >= opt_.high_score ? high_ : low_).push_back(i);
+    }
+    det_track_.assign(dets.size(), -1);
+
+    free_tracks_.clear();
+    for (int i = 0; i < static_cast<int>(tracks_.size()); ++i) free_tracks_.push_back(i);
+    Match(dets, high_, free_tracks_, opt_.match_iou, det_track_);
+
+    free_tracks_.clear();
+    for (int i = 0; i < static_cast<int>(tracks_.size()); ++i) {
+        if (!tracks_[i].matched) free_tracks_.push_back(i);
+    }
+    Match(dets, low_, free_tracks_, opt_.low_match_iou, det_track_);
+
+    // unconfirmed tracks must match on every frame with detections; others live for max_age_s
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(), [&](const Track& tr) {
+        return (!tr.matched && tr.id < 0) || tr.since_match_s > opt_.max_age_s;
+    }), tracks_.end());
+
+    for (int d : high_) {
+        if (det_track_[d] < 0) StartTrack(dets[d]);
+    }
+
+    Output(out);
+}
+
+std::vector<Det> Tracker::Update(const std::vector<Det>& dets, int64_t t_us) {
+    std::vector<Det> out;
+    Update(dets, t_us, out);
+    return out;
+}
+
+void Tracker::Predict(int64_t t_us, std::vector<Det>& out) {
+    Step(t_us);
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(), [&](const Track& tr) {
+        return tr.since_match_s > opt_.max_age_s;
+    }), tracks_.end());
+    Output(out);
+}
+
+std::vector<Det> Tracker::Predict(int64_t t_us) {
+    std::vector<Det> out;
+    Predict(t_us, out);
+    return out;
+}
+
+void Tracker::Output(std::vector<Det>& out) const {
+    out.clear();
+    for (const Track& tr : tracks_) {
+        if (tr.id < 0 || tr.since_match_s > opt_.max_coast_s) continue;
+        const Box b = BoxOf(tr);
+        out.push_back({ b.x1, b.y1, b.x2, b.y2, tr.class_id, tr.score, tr.id });
+    }
+}
@@ -12,7 +12,8 @@ void DrawDetections(cv::Mat& img_bgr, const std::vector<Det>& dets) {
             cv::Scalar(0, 255, 0), 2);
 
         char buf[64];
-        std::snprintf(buf, sizeof(buf), "id=%d %.2f", d.class_id, d.score);
+        if (d.track_id >= 0) std::snprintf(buf, sizeof(buf), "#%d id=%d %.2f", d.track_id, d.class_id, d.score);
+        else std::snprintf(buf, sizeof(buf), "id=%d %.2f", d.class_id, d.score);
         int y = std::max(0, (int)d.y1 - 5);
         cv::putText(img_bgr, buf, cv::Point((int)d.x1, y),
             cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 2);
@@ -1,94 +1,242 @@
 #include "infer/InferEngine.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <thread>
 
-namespace {
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
 
-    cv::Mat LetterboxBGR(const cv::Mat& src_bgr, int dst_w, int dst_h, LetterBoxInfo& info) {
-        int src_w = src_bgr.cols;
-        int src_h = src_bgr.rows;
+#include "infer/letterbox_chw.h"
+#include "common/metrics.h"
 
-        float r = std::min(
-            dst_w / static_cast<float>(src_w),
-            dst_h / static_cast<float>(src_h)
-        );
-        int new_w = static_cast<int>(std::round(src_w * r));
-        int new_h = static_cast<int>(std::round(src_h * r));
-
-        cv::Mat resized;
-        cv::resize(src_bgr, resized, cv::Size(new_w, new_h), 0, 0, cv::INTER_LINEAR);
-
-        int pad_w = dst_w - new_w;
-        int pad_h = dst_h - new_h;
+InferEngine::InferEngine()
+    : InferEngine(Options()) { }
 
-        int pad_left = pad_w / 2;
-        int pad_right = pad_w - pad_left;
-        int pad_top = pad_h / 2;
-        int pad_bottom = pad_h - pad_top;
-
-        cv::Mat out;
-        cv::copyMakeBorder(
-            resized, out,
-            pad_top, pad_bottom, pad_left, pad_right,
-            cv::BORDER_CONSTANT, cv::Scalar(114, 114, 114)
-        );
+InferEngine::InferEngine(const Options& opt)
+    : opt_(opt),
+    env_(ORT_LOGGING_LEVEL_WARNING, "CppInferDemo") { } // Constructor: initialize ORT environment only
 
-        info.scale = r;
-        info.pad_x = pad_left;
-        info.pad_y = pad_top;
-        info.dst_w = dst_w;
-        info.dst_h = dst_h;
-        return out;
+InferEngine::InferEngine(const Options& opt, std::shared_ptr<OrtSharedState> shared)
+    : opt_(opt),
+    shared_(std::move(shared)) {
+    if (!shared_) {
+        env_ = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "CppInferDemo");
     }
+}
 
-    void BGRToCHWFloat01_RGB(const cv::Mat& bgr, std::vector<float>& chw) {
-        CV_Assert(bgr.type() == CV_8UC3);
+// Input buffers double as the in-flight limit: a request holds its slot until the session is
+// done with it.
+struct InferEngine::AsyncState {
+    struct Job {
+        PreparedInput* slot = nullptr;
+        DoneFn done;
+    };
+
+    std::vector<std::unique_ptr<PreparedInput>> slots;
+    std::vector<PreparedInput*> free_slots;
+    std::deque<Job> jobs;
+    int pending = 0;  // submitted, callback not yet returned
+    bool stop = false;
+
+    std::mutex mu;
+    std::condition_variable slot_cv;  // a slot was released
+    std::condition_variable job_cv;   // a job was queued / stop
+    std::condition_variable idle_cv;  // pending dropped to 0
+    std::thread worker;
+};
+
+InferEngine::~InferEngine() {
+    if (!async_) return;
+    {
+        std::lock_guard<std::mutex> lk(async_->mu);
+        async_->stop = true;
+    }
+    async_->job_cv.notify_all();
+    async_->worker.join(); // runs the queued requests first
+}
 
-        // output: [3,H,W], float, RGB, normalized to 0..1
-        int H = bgr.rows;
-        int W = bgr.cols;
-        int HW = H * W;
+// stage latency histograms, see common/metrics.h
+static metrics::Histogram& g_letterbox_time = metrics::Stage("letterbox");
+static metrics::Histogram& g_tensor_time = metrics::Stage("tensor");
+static metrics::Histogram& g_run_time = metrics::Stage("run");
 
-        if ((int)chw.size() != 3 * HW) {
-            throw std::runtime_error("chw must be preallocated to 3*H*W");
-        }
+static double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
 
-        float* dstR = chw.data();
-        float* dstG = chw.data() + HW;
-        float* dstB = chw.data() + 2 * HW;
+// FNV-1a over the model bytes and everything else that changes the optimized graph
+static InferEngine::Path OptimizedCachePath(const InferEngine::Path& dir, const InferEngine::Path& model_path,
+    const std::string& options_key) {
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](const char* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) { h ^= static_cast<unsigned char>(p[i]); h *= 1099511628211ull; }
+    };
+
+    std::ifstream f(std::filesystem::path(model_path), std::ios::binary);
+    if (!f) throw std::runtime_error("Cannot read model file for the optimized-model cache.");
+    std::vector<char> buf(1 << 20);
+    while (f) {
+        f.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        mix(buf.data(), static_cast<size_t>(f.gcount()));
+    }
+    mix(options_key.data(), options_key.size());
 
-        for (int y = 0; y < H; ++y) {
-            const cv::Vec3b* row = bgr.ptr<cv::Vec3b>(y);
-            for (int x = 0; x < W; ++x) {
-                const int idx = y * W + x;
-                const float inv255 = 1.0f / 255.0f;
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(h));
 
-                const float B = row[x][0] * inv255;
-                const float G = row[x][1] * inv255;
-                const float R = row[x][2] * inv255;
+    std::filesystem::path p = std::filesystem::path(dir) / std::filesystem::path(model_path).stem();
+    p += std::string("-") + hex + ".ort";
+    return p.native();
+}
 
-                dstR[idx] = R;
-                dstG[idx] = G;
-                dstB[idx] = B;
-            }
-        }
+// The optimized graph depends on the host: ORT_ENABLE_ALL picks layouts / fused kernels for the
+// instruction sets MLAS finds (AVX2, AVX-512, VNNI, AMX, ...), so a cache copied to another CPU
+// must not be picked up there. Hashes the x86 feature words; elsewhere the architecture only.
+static std::string CpuIsaKey() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    auto cpuid = [](unsigned leaf, unsigned sub, unsigned r[4]) {
+#if defined(_M_X64) || defined(_M_IX86)
+        int regs[4];
+        __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(sub));
+        for (int i = 0; i < 4; ++i) r[i] = static_cast<unsigned>(regs[i]);
+#else
+        r[0] = r[1] = r[2] = r[3] = 0;
+        __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+    };
+    unsigned max_leaf[4], l1[4], l7[4] = { 0, 0, 0, 0 }, l7s1[4] = { 0, 0, 0, 0 };
+    cpuid(0, 0, max_leaf);
+    cpuid(1, 0, l1);
+    if (max_leaf[0] >= 7) {
+        cpuid(7, 0, l7);
+        cpuid(7, 1, l7s1);
     }
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "x86:%08x%08x:%08x%08x%08x:%08x",
+        l1[2], l1[3], l7[1], l7[2], l7[3], l7s1[0]);
+    return buf;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    return "arm64";
+#else
+    return "other";
+#endif
 }
 
-InferEngine::InferEngine(const Options& opt)
-    : opt_(opt),
-    env_(ORT_LOGGING_LEVEL_WARNING, "CppInferDemo") { } // Constructor: initialize ORT environment only
+// Unique per process and call: two processes (or engines) building the same cache at once must
+// not write into one file.
+static InferEngine::Path TempCachePath(const InferEngine::Path& cache) {
+    static std::atomic<unsigned> seq{ 0 };
+#if defined(_WIN32)
+    const long long pid = _getpid();
+#else
+    const long long pid = getpid();
+#endif
+    std::filesystem::path p(cache);
+    p += "." + std::to_string(pid) + "-" + std::to_string(seq++) + ".tmp";
+    return p.native();
+}
 
-void InferEngine::LoadModel(const std::wstring& model_path) {
+void InferEngine::CreateSession(const Path& model_path, bool from_cache, const Path& save_to) {
     session_opt_ = Ort::SessionOptions{};
 
-    session_opt_.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+    if (from_cache) {
+        // already optimized for this ORT version / options: load as-is
+        session_opt_.AddConfigEntry("session.load_model_format", "ORT");
+        session_opt_.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+    }
+    else if (opt_.precision == Precision::INT8) {
+        // QDQ node-unit fusion + int8 (not only uint8) QDQ kernels on x86
+        session_opt_.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        session_opt_.AddConfigEntry("session.qdqisint8allowed", "1");
+    }
+    else {
+        session_opt_.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+    }
 
-    if (opt_.intra_op_num_threads > 0) {
+    if (shared_) {
+        // compute on the Env's global pools; allocate from the Env's registered arena
+        session_opt_.DisablePerSessionThreads();
+        session_opt_.AddConfigEntry("session.use_env_allocators", "1");
+    }
+    else if (opt_.intra_op_num_threads > 0) {
         session_opt_.SetIntraOpNumThreads(opt_.intra_op_num_threads);
     }
 
+    if (!save_to.empty()) {
+        session_opt_.SetOptimizedModelFilePath(save_to.c_str());
+        session_opt_.AddConfigEntry("session.save_model_format", "ORT");
+    }
+
     // Create ONNX Runtime session 
-    session_ = Ort::Session(env_, model_path.c_str(), session_opt_);
+    if (shared_) {
+        session_ = Ort::Session(shared_->env, model_path.c_str(), session_opt_, shared_->prepacked);
+    }
+    else {
+        session_ = Ort::Session(env_, model_path.c_str(), session_opt_);
+    }
+}
+
+void InferEngine::LoadModel(const Path& model_path) {
+    startup_ = {};
+    auto t0 = std::chrono::steady_clock::now();
+
+    if (opt_.optimized_cache_dir.empty()) {
+        CreateSession(model_path, false, Path());
+    }
+    else {
+        std::string key = "ort=" + Ort::GetVersionString()
+            + ";precision=" + std::to_string(static_cast<int>(opt_.precision))
+            + ";cuda=" + std::to_string(opt_.use_cuda ? 1 : 0)
+            + ";isa=" + CpuIsaKey();
+        const Path cache = OptimizedCachePath(opt_.optimized_cache_dir, model_path, key);
+
+        bool loaded = false;
+        if (std::filesystem::exists(cache)) {
+            try {
+                CreateSession(cache, true, Path());
+                loaded = true;
+                startup_.cache_hit = true;
+            }
+            catch (const Ort::Exception& e) {
+                // stale / truncated file: rebuild it
+                std::cerr << "[InferEngine] optimized-model cache unusable, rebuilding: " << e.what() << "\n";
+                std::error_code ec;
+                std::filesystem::remove(cache, ec);
+            }
+        }
+
+        if (!loaded) {
+            // write next to the final name and rename, so a crash never leaves a half file behind
+            std::filesystem::create_directories(std::filesystem::path(opt_.optimized_cache_dir));
+            const Path tmp = TempCachePath(cache);
+            CreateSession(model_path, false, tmp);
+
+            // another process may have stored the same cache meanwhile: the rename replaces it
+            // with an identical file
+            std::error_code ec;
+            std::filesystem::rename(tmp, cache, ec);
+            if (ec) {
+                std::cerr << "[InferEngine] could not store optimized model: " << ec.message() << "\n";
+                std::filesystem::remove(tmp, ec);
+            }
+        }
+    }
+    startup_.session_ms = MsSince(t0);
 
     Ort::AllocatorWithDefaultOptions allocator;
 
@@ -117,18 +265,27 @@ void InferEngine::LoadModel(const std::wstring& model_path) {
     auto input_type_info = session_.GetInputTypeInfo(0);
     auto input_tensor_info = input_type_info.GetTensorTypeAndShapeInfo();
     auto shape = input_tensor_info.GetShape();
+
+    input_type_ = input_tensor_info.GetElementType();
+    if (input_type_ != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT
+        && input_type_ != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16
+        && input_type_ != ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8) {
+        throw std::runtime_error("InferEngine supports float32, float16 or uint8 model input.");
+    }
     
     if (shape.size() != 4) {
         throw std::runtime_error("InferEngine expects input rank 4: [N,C,H,W].");
     }
 
+    // a dynamic batch axis (exported with dynamic=True / dynamic_axes) enables RunBatch
+    dynamic_batch_ = shape[0] <= 0;
     int64_t N = shape[0] > 0 ? shape[0] : 1;
     int64_t C = shape[1] > 0 ? shape[1] : 3;
     int64_t Hm = shape[2] > 0 ? shape[2] : -1;
     int64_t Wm = shape[3] > 0 ? shape[3] : -1;
 
     if (N != 1 || C != 3) {
-        throw std::runtime_error("InferEngine expects input shape [1,3,H,W].");
+        throw std::runtime_error("InferEngine expects input shape [1,3,H,W] or [N,3,H,W] with dynamic N.");
     }
 
     if (opt_.input_h > 0 && opt_.input_w > 0) {
@@ -143,12 +300,127 @@ void InferEngine::LoadModel(const std::wstring& model_path) {
         input_h_ = 640;
         input_w_ = 640;
     }
+
+    input_name_ptrs_.clear();
+    for (auto& s : input_names_) input_name_ptrs_.push_back(s.c_str());
+    output_name_ptrs_.clear();
+    for (auto& s : output_names_) output_name_ptrs_.push_back(s.c_str());
+
+    mem_info_ = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+
+    if (opt_.persistent_io) {
+        SetupBoundIO();
+    }
+
+    Warmup();
+    startup_.ready = std::chrono::steady_clock::now();
+
+    std::cout << "[InferEngine] ready in " << MsSince(t0) << " ms (session " << startup_.session_ms
+        << " ms" << (opt_.optimized_cache_dir.empty() ? "" : startup_.cache_hit ? ", cache hit" : ", cache miss")
+        << "; warmup " << opt_.warmup_runs << " runs " << startup_.warmup_ms
+        << " ms, first " << startup_.first_run_ms << " ms)\n";
+}
+
+void InferEngine::Warmup() {
+    if (opt_.warmup_runs <= 0) return;
+
+    // grey frame at the model size: same tensor shapes as real frames
+    cv::Mat dummy(input_h_, input_w_, CV_8UC3, cv::Scalar(114, 114, 114));
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < opt_.warmup_runs; ++i) {
+        auto t = std::chrono::steady_clock::now();
+        if (opt_.persistent_io) RunBound(dummy);
+        else Run(dummy);
+        if (i == 0) startup_.first_run_ms = MsSince(t);
+    }
+    startup_.warmup_ms = MsSince(t0);
+}
+
+void InferEngine::SetupBoundIO() {
+    run_opt_ = Ort::RunOptions{};
+    io_binding_ = Ort::IoBinding(session_);
+
+    // input: one host buffer that the preprocessing writes into every frame
+    io_input_shape_ = { 1, 3, input_h_, input_w_ };
+    io_input_.assign(static_cast<size_t>(3) * input_h_ * input_w_, 0.0f);
+    io_input_tensor_ = MakeInputTensor(io_input_.data(), io_input_typed_, io_input_.size(),
+        io_input_shape_.data(), io_input_shape_.size());
+    io_binding_.BindInput(input_name_ptrs_[0], io_input_tensor_);
+
+    // outputs: pre-allocate every float output whose shape is known (dynamic batch -> 1)
+    io_output_bufs_.clear();
+    io_result_ = {};
+    std::vector<Ort::Value> bound;
+    io_outputs_prebound_ = true;
+
+    for (size_t i = 0; i < output_names_.size(); ++i) {
+        auto info = session_.GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo();
+        auto shape = info.GetShape();
+
+        bool fixed = info.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+        size_t count = 1;
+        for (size_t d = 0; d < shape.size(); ++d) {
+            if (shape[d] <= 0) {
+                if (d == 0) shape[d] = 1;
+                else fixed = false;
+            }
+            count *= static_cast<size_t>(std::max<int64_t>(shape[d], 1));
+        }
+
+        if (!fixed) {
+            // shape only known after Run: let ORT allocate it (costs an allocation per frame)
+            io_binding_.BindOutput(output_name_ptrs_[i], mem_info_);
+            io_outputs_prebound_ = false;
+            continue;
+        }
+
+        io_output_bufs_.emplace_back(count);
+        bound.push_back(Ort::Value::CreateTensor<float>(
+            mem_info_,
+            io_output_bufs_.back().data(),
+            count,
+            shape.data(),
+            shape.size()
+        ));
+        io_binding_.BindOutput(output_name_ptrs_[i], bound.back());
+    }
+
+    if (io_outputs_prebound_) {
+        io_result_.outputs = std::move(bound);
+    }
+    else {
+        // keep the pre-allocated ones alive for the binding; results come from GetOutputValues()
+        io_bound_outputs_ = std::move(bound);
+    }
+}
+
+Ort::Value InferEngine::MakeInputTensor(float* f32, std::vector<uint8_t>& typed, size_t count,
+    const int64_t* shape, size_t rank) const {
+    metrics::ScopedTimer timer(g_tensor_time);
+    if (input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+        return Ort::Value::CreateTensor<float>(mem_info_, f32, count, shape, rank);
+    }
+
+    if (input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16) {
+        typed.resize(count * sizeof(uint16_t));
+        Float01ToHalf(f32, reinterpret_cast<uint16_t*>(typed.data()), count);
+    }
+    else {
+        typed.resize(count);
+        Float01ToU8(f32, typed.data(), count);
+    }
+    return Ort::Value::CreateTensor(mem_info_, typed.data(), typed.size(), shape, rank, input_type_);
 }
 
 void InferEngine::PrintModelInfo() const {
     std::cout << "Inputs:\n";
     for (size_t i = 0; i < input_names_.size(); ++i) {
-        std::cout << "  [" << i << "] " << input_names_[i] << "\n";
+        std::cout << "  [" << i << "] " << input_names_[i];
+        if (i == 0) {
+            std::cout << (input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16 ? " (float16)"
+                : input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 ? " (uint8)" : " (float32)");
+        }
+        std::cout << "\n";
     }
     std::cout << "Outputs:\n";
     for (size_t i = 0; i < output_names_.size(); ++i) {
@@ -156,53 +428,328 @@ void InferEngine::PrintModelInfo() const {
     }
 }
 
-std::vector<float> InferEngine::PreprocessToCHW(const cv::Mat& bgr, LetterBoxInfo& lb) const {
-    cv::Mat lb_bgr = LetterboxBGR(bgr, input_w_, input_h_, lb);
-    std::vector<float> input_chw(3 * input_h_ * input_w_);
-    BGRToCHWFloat01_RGB(lb_bgr, input_chw);
-    
-    return input_chw;
+void InferEngine::PreprocessToCHW(const cv::Mat& bgr, LetterBoxInfo& lb, std::vector<float>& chw) const {
+    // resize() keeps the capacity, so a reused buffer is not reallocated
+    chw.resize(static_cast<size_t>(3) * input_h_ * input_w_);
+    metrics::ScopedTimer timer(g_letterbox_time);
+    LetterboxToCHWFloat01_RGB(bgr, input_w_, input_h_, chw.data(), lb);
+}
+
+void InferEngine::Preprocess(const cv::Mat& bgr, PreparedInput& in) const {
+    in.orig_w = bgr.cols;
+    in.orig_h = bgr.rows;
+    in.lb = {};
+    in.typed.clear(); // RunPrepared converts chw to the model's input type
+    PreprocessToCHW(bgr, in.lb, in.chw);
 }
 
 InferResult InferEngine::Run(const cv::Mat& bgr) {
-    InferResult r;
-    r.orig_w = bgr.cols;
-    r.orig_h = bgr.rows;
+    // 1) preprocess (per-thread scratch: Run may be called concurrently)
+    thread_local PreparedInput in;
+    Preprocess(bgr, in);
 
-    // 1) preprocess
-    r.lb = {};
-    auto input_chw = PreprocessToCHW(bgr, r.lb);
+    return RunPrepared(in);
+}
+
+void InferEngine::PreprocessPlanarRGB(const cv::Mat& planes, const LetterBoxInfo& lb,
+    int orig_w, int orig_h, PreparedInput& in) const {
+    if (planes.type() != CV_8UC1 || planes.cols != input_w_ || planes.rows != 3 * input_h_) {
+        throw std::runtime_error("PreprocessPlanarRGB: planes must be 3 x InputH() rows of InputW() bytes.");
+    }
+    in.orig_w = orig_w;
+    in.orig_h = orig_h;
+    in.lb = lb;
+
+    const size_t count = static_cast<size_t>(3) * input_h_ * input_w_;
+    if (input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 && planes.isContinuous()) {
+        // the decoder already produced the exact tensor
+        in.typed.assign(planes.data, planes.data + count);
+        return;
+    }
+    in.typed.clear();
+    in.chw.resize(count);
+    metrics::ScopedTimer timer(g_letterbox_time);
+    PlanarU8ToCHWFloat01(planes, in.chw.data());
+}
 
-    // 2) build input tensor
+void InferEngine::PreprocessNV12(const cv::Mat& nv12, const LetterBoxInfo& lb,
+    int orig_w, int orig_h, PreparedInput& in) const {
+    if (nv12.type() != CV_8UC1 || nv12.cols != input_w_ || nv12.rows != input_h_ * 3 / 2) {
+        throw std::runtime_error("PreprocessNV12: nv12 must be InputH() * 3 / 2 rows of InputW() bytes.");
+    }
+    thread_local cv::Mat planes;
+    {
+        metrics::ScopedTimer timer(g_letterbox_time);
+        NV12ToPlanarRGB(nv12, planes);
+    }
+    PreprocessPlanarRGB(planes, lb, orig_w, orig_h, in);
+}
+
+InferResult InferEngine::RunPrepared(const PreparedInput& in) {
+    InferResult r;
+    r.orig_w = in.orig_w;
+    r.orig_h = in.orig_h;
+    r.lb = in.lb;
+
+    const size_t count = static_cast<size_t>(3) * input_h_ * input_w_;
+    const bool u8_ready = input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 && in.typed.size() == count;
+    if (!u8_ready && in.chw.size() != count) {
+        throw std::runtime_error("PreparedInput does not match the model input size.");
+    }
+
+    // 2) build input tensor (ORT only reads from it; the const_casts are for the C API signature)
     std::array<int64_t, 4> input_shape{ 1, 3, input_h_, input_w_ };
-    Ort::MemoryInfo mem_info = Ort::MemoryInfo::CreateCpu(
-        OrtDeviceAllocator, OrtMemTypeCPU);
 
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
-        mem_info,
-        input_chw.data(),
-        input_chw.size(),
-        input_shape.data(),
-        input_shape.size()
-    );
+    thread_local std::vector<uint8_t> typed;
+    Ort::Value input_tensor = u8_ready
+        ? Ort::Value::CreateTensor(mem_info_, const_cast<uint8_t*>(in.typed.data()), count,
+            input_shape.data(), input_shape.size(), input_type_)
+        : MakeInputTensor(const_cast<float*>(in.chw.data()), typed, count,
+            input_shape.data(), input_shape.size());
 
     // 3) run
-    std::vector<const char*> in_names;
-    in_names.reserve(input_names_.size());
-    for (auto& s : input_names_) in_names.push_back(s.c_str());
-
-    std::vector<const char*> out_names;
-    out_names.reserve(output_names_.size());
-    for (auto& s : output_names_) out_names.push_back(s.c_str());
-
-    r.outputs = session_.Run(
-        Ort::RunOptions{ nullptr },
-        in_names.data(),
-        &input_tensor,
-        1,
-        out_names.data(),
-        out_names.size()
-    );
+    {
+        metrics::ScopedTimer timer(g_run_time);
+        r.outputs = session_.Run(
+            Ort::RunOptions{ nullptr },
+            input_name_ptrs_.data(),
+            &input_tensor,
+            1,
+            output_name_ptrs_.data(),
+            output_name_ptrs_.size()
+        );
+    }
+
+    return r;
+}
+
+const InferResult& InferEngine::RunBound(const cv::Mat& bgr) {
+    if (!opt_.persistent_io) {
+        throw std::runtime_error("RunBound requires Options::persistent_io.");
+    }
+
+    io_result_.orig_w = bgr.cols;
+    io_result_.orig_h = bgr.rows;
+
+    // 1) preprocess straight into the bound input tensor
+    {
+        metrics::ScopedTimer timer(g_letterbox_time);
+        LetterboxToCHWFloat01_RGB(bgr, input_w_, input_h_, io_input_.data(), io_result_.lb);
+    }
+    return RunBoundInput(false);
+}
+
+const InferResult& InferEngine::RunBoundPlanarRGB(const cv::Mat& planes, const LetterBoxInfo& lb,
+    int orig_w, int orig_h) {
+    if (!opt_.persistent_io) {
+        throw std::runtime_error("RunBoundPlanarRGB requires Options::persistent_io.");
+    }
+    if (planes.type() != CV_8UC1 || planes.cols != input_w_ || planes.rows != 3 * input_h_) {
+        throw std::runtime_error("RunBoundPlanarRGB: planes must be 3 x InputH() rows of InputW() bytes.");
+    }
+    io_result_.orig_w = orig_w;
+    io_result_.orig_h = orig_h;
+    io_result_.lb = lb;
+
+    if (input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 && planes.isContinuous()) {
+        // the decoder already produced the exact tensor
+        std::memcpy(io_input_typed_.data(), planes.data, io_input_typed_.size());
+        return RunBoundInput(true);
+    }
+    {
+        metrics::ScopedTimer timer(g_letterbox_time);
+        PlanarU8ToCHWFloat01(planes, io_input_.data());
+    }
+    return RunBoundInput(false);
+}
+
+const InferResult& InferEngine::RunBoundNV12(const cv::Mat& nv12, const LetterBoxInfo& lb,
+    int orig_w, int orig_h) {
+    if (nv12.type() != CV_8UC1 || nv12.cols != input_w_ || nv12.rows != input_h_ * 3 / 2) {
+        throw std::runtime_error("RunBoundNV12: nv12 must be InputH() * 3 / 2 rows of InputW() bytes.");
+    }
+    thread_local cv::Mat planes;
+    {
+        metrics::ScopedTimer timer(g_letterbox_time);
+        NV12ToPlanarRGB(nv12, planes);
+    }
+    return RunBoundPlanarRGB(planes, lb, orig_w, orig_h);
+}
+
+// io_input_ holds the frame (or io_input_typed_ already does): convert, run, collect
+const InferResult& InferEngine::RunBoundInput(bool typed_ready) {
+    auto t_tensor = metrics::Clock::now();
+    if (typed_ready) {
+        // nothing to convert
+    }
+    else if (input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16) {
+        Float01ToHalf(io_input_.data(), reinterpret_cast<uint16_t*>(io_input_typed_.data()), io_input_.size());
+    }
+    else if (input_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8) {
+        Float01ToU8(io_input_.data(), io_input_typed_.data(), io_input_.size());
+    }
+    g_tensor_time.RecordSince(t_tensor);
+
+    // 2) run; outputs land in io_output_bufs_
+    {
+        metrics::ScopedTimer timer(g_run_time);
+        session_.Run(run_opt_, io_binding_);
+    }
+
+    if (!io_outputs_prebound_) {
+        io_result_.outputs = io_binding_.GetOutputValues();
+    }
+    return io_result_;
+}
+
+BatchInferResult InferEngine::RunBatch(const cv::Mat* frames, size_t count) {
+    if (count == 0) {
+        throw std::runtime_error("RunBatch called with no frames.");
+    }
+    if (count > 1 && !dynamic_batch_) {
+        throw std::runtime_error("RunBatch with more than one frame needs a model with a dynamic batch axis.");
+    }
+
+    BatchInferResult r;
+    r.items.resize(count);
+
+    // 1) preprocess every frame into its slot of one [N,3,H,W] buffer
+    const size_t per_image = static_cast<size_t>(3) * input_h_ * input_w_;
+    thread_local std::vector<float> input;
+    input.resize(per_image * count);
+    for (size_t i = 0; i < count; ++i) {
+        const cv::Mat& bgr = frames[i];
+        r.items[i].orig_w = bgr.cols;
+        r.items[i].orig_h = bgr.rows;
+        metrics::ScopedTimer timer(g_letterbox_time);
+        LetterboxToCHWFloat01_RGB(bgr, input_w_, input_h_, input.data() + i * per_image, r.items[i].lb);
+    }
+
+    // 2) one session call for the whole batch
+    std::array<int64_t, 4> input_shape{ static_cast<int64_t>(count), 3, input_h_, input_w_ };
+    thread_local std::vector<uint8_t> typed;
+    Ort::Value input_tensor = MakeInputTensor(input.data(), typed, input.size(),
+        input_shape.data(), input_shape.size());
+
+    {
+        metrics::ScopedTimer timer(g_run_time);
+        r.outputs = session_.Run(
+            Ort::RunOptions{ nullptr },
+            input_name_ptrs_.data(),
+            &input_tensor,
+            1,
+            output_name_ptrs_.data(),
+            output_name_ptrs_.size()
+        );
+    }
 
     return r;
 }
+
+InferEngine::AsyncState& InferEngine::Async() {
+    std::call_once(async_once_, [this] {
+        async_ = std::make_unique<AsyncState>();
+        const int n = std::max(1, opt_.max_in_flight);
+        for (int i = 0; i < n; ++i) {
+            async_->slots.push_back(std::make_unique<PreparedInput>());
+            async_->free_slots.push_back(async_->slots.back().get());
+        }
+        async_->worker = std::thread(&InferEngine::AsyncLoop, this);
+    });
+    return *async_;
+}
+
+void InferEngine::RunAsync(const cv::Mat& bgr, DoneFn done) {
+    AsyncState& a = Async();
+
+    PreparedInput* slot = nullptr;
+    {
+        std::unique_lock<std::mutex> lk(a.mu);
+        a.slot_cv.wait(lk, [&] { return !a.free_slots.empty(); });
+        slot = a.free_slots.back();
+        a.free_slots.pop_back();
+        ++a.pending;
+    }
+
+    // on the caller's thread, overlapping the request that is in the session
+    try {
+        Preprocess(bgr, *slot);
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lk(a.mu);
+            a.free_slots.push_back(slot);
+            if (--a.pending == 0) a.idle_cv.notify_all();
+        }
+        a.slot_cv.notify_one();
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(a.mu);
+        a.jobs.push_back({ slot, std::move(done) });
+    }
+    a.job_cv.notify_one();
+}
+
+std::future<InferResult> InferEngine::RunAsync(const cv::Mat& bgr) {
+    auto promise = std::make_shared<std::promise<InferResult>>();
+    std::future<InferResult> fut = promise->get_future();
+    RunAsync(bgr, [promise](InferResult result, std::exception_ptr error) {
+        if (error) promise->set_exception(error);
+        else promise->set_value(std::move(result));
+    });
+    return fut;
+}
+
+void InferEngine::WaitAsync() {
+    AsyncState& a = Async();
+    std::unique_lock<std::mutex> lk(a.mu);
+    a.idle_cv.wait(lk, [&] { return a.pending == 0; });
+}
+
+void InferEngine::AsyncLoop() {
+    AsyncState& a = *async_;
+    while (true) {
+        AsyncState::Job job;
+        {
+            std::unique_lock<std::mutex> lk(a.mu);
+            a.job_cv.wait(lk, [&] { return a.stop || !a.jobs.empty(); });
+            if (a.jobs.empty()) return; // stop, and everything queued has run
+            job = std::move(a.jobs.front());
+            a.jobs.pop_front();
+        }
+
+        InferResult result;
+        std::exception_ptr error;
+        try {
+            result = RunPrepared(*job.slot);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        // the outputs are separate tensors: the input buffer can take the next frame already
+        {
+            std::lock_guard<std::mutex> lk(a.mu);
+            a.free_slots.push_back(job.slot);
+        }
+        a.slot_cv.notify_one();
+
+        if (job.done) {
+            try {
+                job.done(std::move(result), error);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[InferEngine] RunAsync callback failed: " << e.what() << "\n";
+            }
+            catch (...) {
+                // a worker that dies here would take the process down with std::terminate
+                std::cerr << "[InferEngine] RunAsync callback failed: unknown exception\n";
+            }
+        }
+
+        std::lock_guard<std::mutex> lk(a.mu);
+        if (--a.pending == 0) a.idle_cv.notify_all();
+    }
+}
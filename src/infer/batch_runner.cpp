@@ -0,0 +1,95 @@
+#include "infer/batch_runner.h"
+#include <algorithm>
+#include <stdexcept>
+
+BatchRunner::BatchRunner(InferEngine& engine, const BatchPolicy& policy, const PostprocessOptions& pp)
+    : engine_(engine),
+    policy_(policy),
+    pp_(pp) {
+    policy_.max_batch = engine_.DynamicBatch() ? std::max(1, policy_.max_batch) : 1;
+    policy_.max_wait_ms = std::max(0, policy_.max_wait_ms);
+    worker_ = std::thread(&BatchRunner::WorkerLoop, this);
+}
+
+BatchRunner::~BatchRunner() {
+    Stop();
+}
+
+std::future<std::vector<Det>> BatchRunner::Submit(const cv::Mat& bgr) {
+    Request req;
+    req.bgr = bgr;
+    req.enqueued = std::chrono::steady_clock::now();
+    std::future<std::vector<Det>> fut = req.done.get_future();
+
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stop_) {
+            throw std::runtime_error("BatchRunner is stopped.");
+        }
+        pending_.push_back(std::move(req));
+    }
+    cv_.notify_one();
+    return fut;
+}
+
+void BatchRunner::Stop() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+
+    for (auto& req : pending_) {
+        req.done.set_exception(std::make_exception_ptr(std::runtime_error("BatchRunner stopped.")));
+    }
+    pending_.clear();
+}
+
+void BatchRunner::WorkerLoop() {
+    const size_t max_batch = static_cast<size_t>(policy_.max_batch);
+    const auto max_wait = std::chrono::milliseconds(policy_.max_wait_ms);
+
+    std::vector<Request> batch;
+    std::vector<cv::Mat> frames;
+
+    while (true) {
+        batch.clear();
+        frames.clear();
+
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            cv_.wait(lk, [&] { return stop_ || !pending_.empty(); });
+            if (stop_) return;
+
+            // wait until the batch is full or the oldest request hits its deadline
+            const auto deadline = pending_.front().enqueued + max_wait;
+            cv_.wait_until(lk, deadline, [&] { return stop_ || pending_.size() >= max_batch; });
+            if (stop_) return;
+
+            const size_t n = std::min(max_batch, pending_.size());
+            for (size_t i = 0; i < n; ++i) {
+                batch.push_back(std::move(pending_.front()));
+                pending_.pop_front();
+            }
+        }
+
+        for (auto& req : batch) frames.push_back(req.bgr);
+
+        try {
+            BatchInferResult r = engine_.RunBatch(frames);
+            auto dets = PostprocessRTDETRBatch(
+                r.outputs[0],
+                engine_.InputW(), engine_.InputH(),
+                r.items,
+                pp_
+            );
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i].done.set_value(std::move(dets[i]));
+            }
+        }
+        catch (...) {
+            for (auto& req : batch) req.done.set_exception(std::current_exception());
+        }
+    }
+}
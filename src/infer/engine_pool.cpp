@@ -0,0 +1,153 @@
+#include "infer/engine_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+    // Restricts the calling thread to `cores` (logical CPU indices)
+    bool PinThread(const std::vector<int>& cores) {
+        if (cores.empty()) return false;
+#ifdef _WIN32
+        DWORD_PTR mask = 0;
+        for (int c : cores) {
+            if (c >= 0 && c < static_cast<int>(sizeof(DWORD_PTR) * 8)) mask |= DWORD_PTR(1) << c;
+        }
+        return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c : cores) {
+            if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+    }
+
+    std::vector<int> NumaNodeCores(int node) {
+        std::vector<int> cores;
+#ifdef _WIN32
+        GROUP_AFFINITY aff{};
+        if (GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &aff) && aff.Group == 0) {
+            for (int c = 0; c < static_cast<int>(sizeof(aff.Mask) * 8); ++c) {
+                if (aff.Mask & (KAFFINITY(1) << c)) cores.push_back(c);
+            }
+        }
+#else
+        // e.g. "0-7,16-23"
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string list;
+        std::getline(f, list);
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty()) continue;
+            const size_t dash = range.find('-');
+            const int lo = std::stoi(range.substr(0, dash));
+            const int hi = dash == std::string::npos ? lo : std::stoi(range.substr(dash + 1));
+            for (int c = lo; c <= hi; ++c) cores.push_back(c);
+        }
+#endif
+        return cores;
+    }
+
+    // Custom thread creation for the global pools: each ORT thread is pinned to one core
+    struct ThreadHooks {
+        std::vector<int> cores;
+        std::atomic<size_t> next{ 0 };
+    };
+
+    OrtCustomThreadHandle CreatePinnedThread(void* options, OrtThreadWorkerFn fn, void* param) {
+        auto* hooks = static_cast<ThreadHooks*>(options);
+        const int core = hooks->cores[hooks->next++ % hooks->cores.size()];
+        auto* t = new std::thread([core, fn, param] {
+            PinThread({ core });
+            fn(param);
+        });
+        return reinterpret_cast<OrtCustomThreadHandle>(t);
+    }
+
+    void JoinPinnedThread(OrtCustomThreadHandle handle) {
+        auto* t = reinterpret_cast<std::thread*>(const_cast<OrtCustomHandleType*>(handle));
+        t->join();
+        delete t;
+    }
+}
+
+EnginePool::EnginePool()
+    : EnginePool(Options()) { }
+
+EnginePool::EnginePool(const Options& opt)
+    : opt_(opt) {
+    cores_ = opt_.cpu_cores;
+    if (cores_.empty() && opt_.numa_node >= 0) {
+        cores_ = NumaNodeCores(opt_.numa_node);
+        if (cores_.empty()) {
+            throw std::runtime_error("EnginePool: no cores found for NUMA node " + std::to_string(opt_.numa_node));
+        }
+    }
+
+    shared_ = std::make_shared<OrtSharedState>();
+
+    Ort::ThreadingOptions topt;
+    int intra = opt_.intra_op_threads;
+    if (intra <= 0 && !cores_.empty()) intra = static_cast<int>(cores_.size());
+    topt.SetGlobalIntraOpNumThreads(intra);
+    topt.SetGlobalInterOpNumThreads(std::max(1, opt_.inter_op_threads));
+    topt.SetGlobalSpinControl(opt_.allow_spinning ? 1 : 0);
+
+    if (!cores_.empty()) {
+        auto hooks = std::make_shared<ThreadHooks>();
+        hooks->cores = cores_;
+        topt.SetGlobalCustomThreadCreationOptions(hooks.get());
+        topt.SetGlobalCustomCreateThreadFn(&CreatePinnedThread);
+        topt.SetGlobalCustomJoinThreadFn(&JoinPinnedThread);
+        shared_->thread_hooks = hooks;
+    }
+
+    shared_->env = Ort::Env(topt, ORT_LOGGING_LEVEL_WARNING, "CppInferDemo");
+
+    // one arena for all sessions (used through session.use_env_allocators)
+    Ort::MemoryInfo mem = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    shared_->env.CreateAndRegisterAllocator(mem, nullptr);
+
+    const int n = std::max(1, opt_.sessions);
+    for (int i = 0; i < n; ++i) {
+        engines_.push_back(std::make_unique<InferEngine>(opt_.engine, shared_));
+    }
+}
+
+void EnginePool::LoadModel(const InferEngine::Path& model_path) {
+    // sessions after the first one find the prepacked weights in the shared container
+    for (auto& e : engines_) e->LoadModel(model_path);
+}
+
+std::vector<InferEngine*> EnginePool::Engines(size_t workers) {
+    if (workers == 0) workers = engines_.size();
+    // RunBound keeps its result in the engine, so a persistent-IO engine serves one worker
+    if (opt_.engine.persistent_io) workers = std::min(workers, engines_.size());
+    std::vector<InferEngine*> out;
+    out.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) out.push_back(engines_[i % engines_.size()].get());
+    return out;
+}
+
+void EnginePool::PinCurrentThread() const {
+    PinThread(cores_);
+}
@@ -0,0 +1,547 @@
+#include "infer/letterbox_chw.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LB_HAVE_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define LB_TARGET_AVX2 __attribute__((target("avx2")))
+#define LB_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define LB_TARGET_F16C __attribute__((target("avx,f16c")))
+#else
+#define LB_TARGET_AVX2
+#define LB_TARGET_SSE41
+#define LB_TARGET_F16C
+#endif
+#else
+#define LB_HAVE_X86 0
+#endif
+
+cv::Mat LetterboxBGR(const cv::Mat& src_bgr, int dst_w, int dst_h, LetterBoxInfo& info) {
+    int src_w = src_bgr.cols;
+    int src_h = src_bgr.rows;
+
+    float r = std::min(
+        dst_w / static_cast<float>(src_w),
+        dst_h / static_cast<float>(src_h)
+    );
+    int new_w = static_cast<int>(std::round(src_w * r));
+    int new_h = static_cast<int>(std::round(src_h * r));
+
+    cv::Mat resized;
+    cv::resize(src_bgr, resized, cv::Size(new_w, new_h), 0, 0, cv::INTER_LINEAR);
+
+    int pad_w = dst_w - new_w;
+    int pad_h = dst_h - new_h;
+
+    int pad_left = pad_w / 2;
+    int pad_right = pad_w - pad_left;
+    int pad_top = pad_h / 2;
+    int pad_bottom = pad_h - pad_top;
+
+    cv::Mat out;
+    cv::copyMakeBorder(
+        resized, out,
+        pad_top, pad_bottom, pad_left, pad_right,
+        cv::BORDER_CONSTANT, cv::Scalar(114, 114, 114)
+    );
+
+    info.scale = r;
+    info.pad_x = pad_left;
+    info.pad_y = pad_top;
+    info.dst_w = dst_w;
+    info.dst_h = dst_h;
+    return out;
+}
+
+void BGRToCHWFloat01_RGB(const cv::Mat& bgr, std::vector<float>& chw) {
+    CV_Assert(bgr.type() == CV_8UC3);
+
+    // output: [3,H,W], float, RGB, normalized to 0..1
+    int H = bgr.rows;
+    int W = bgr.cols;
+    int HW = H * W;
+
+    if ((int)chw.size() != 3 * HW) {
+        throw std::runtime_error("chw must be preallocated to 3*H*W");
+    }
+
+    float* dstR = chw.data();
+    float* dstG = chw.data() + HW;
+    float* dstB = chw.data() + 2 * HW;
+
+    for (int y = 0; y < H; ++y) {
+        const cv::Vec3b* row = bgr.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < W; ++x) {
+            const int idx = y * W + x;
+            const float inv255 = 1.0f / 255.0f;
+
+            const float B = row[x][0] * inv255;
+            const float G = row[x][1] * inv255;
+            const float R = row[x][2] * inv255;
+
+            dstR[idx] = R;
+            dstG[idx] = G;
+            dstB[idx] = B;
+        }
+    }
+}
+
+namespace {
+
+    // cv::resize fixed-point constants for 8-bit INTER_LINEAR (INTER_RESIZE_COEF_BITS = 11)
+    constexpr int kCoefScale = 1 << 11;
+    constexpr float kInv255 = 1.0f / 255.0f;
+
+    // How two horizontally-resized source rows are combined into one output row
+    enum class VMode {
+        Linear,  // ((b0*(S0>>4))>>16) + ((b1*(S1>>4))>>16) + 2) >> 2   (cv::VResizeLinear, 8u)
+        Area2x,  // (S0 + S1 + 2) >> 2, S = sum of 2 horizontal pixels    (cv::resizeAreaFast, 2x2)
+        Copy,    // S0, no resize
+    };
+
+    inline short CoefToFixed(float c) {
+        // saturate_cast<short>(float) rounds to nearest even, like lrintf in the default FP mode
+        return static_cast<short>(std::lrintf(c * kCoefScale));
+    }
+
+    // Tables depend only on the geometry, so they are built once per thread and size.
+    struct Scratch {
+        int src_w = -1, src_h = -1, new_w = -1, new_h = -1;
+        VMode mode = VMode::Copy;
+
+        std::vector<int> xofs0, xofs1;   // byte offsets of the two source pixels (x*3)
+        std::vector<short> alpha0, alpha1;
+        std::vector<int> yofs0, yofs1;
+        std::vector<short> beta0, beta1;
+
+        // Two cached horizontally-resized rows, planar per channel: [c * new_w + x]
+        std::vector<int> rows[2];
+        int row_src[2] = { -1, -1 };
+    };
+
+    void BuildTables(Scratch& s, int src_w, int src_h, int new_w, int new_h) {
+        s.src_w = src_w; s.src_h = src_h; s.new_w = new_w; s.new_h = new_h;
+
+        // same scale derivation as cv::resize with an explicit dsize
+        const double scale_x = 1.0 / (static_cast<double>(new_w) / src_w);
+        const double scale_y = 1.0 / (static_cast<double>(new_h) / src_h);
+
+        if (new_w == src_w && new_h == src_h) {
+            s.mode = VMode::Copy;
+        }
+        else if (std::abs(scale_x - 2.0) < DBL_EPSILON && std::abs(scale_y - 2.0) < DBL_EPSILON) {
+            s.mode = VMode::Area2x;
+        }
+        else {
+            s.mode = VMode::Linear;
+        }
+
+        s.xofs0.resize(new_w); s.xofs1.resize(new_w);
+        s.alpha0.resize(new_w); s.alpha1.resize(new_w);
+        s.yofs0.resize(new_h); s.yofs1.resize(new_h);
+        s.beta0.resize(new_h); s.beta1.resize(new_h);
+
+        for (int dx = 0; dx < new_w; ++dx) {
+            int sx0 = dx, sx1 = dx;
+            float fx = 0.0f;
+            if (s.mode == VMode::Area2x) {
+                sx0 = dx * 2; sx1 = dx * 2 + 1;
+            }
+            else if (s.mode == VMode::Linear) {
+                fx = static_cast<float>((dx + 0.5) * scale_x - 0.5);
+                int sx = static_cast<int>(std::floor(fx));
+                fx -= sx;
+                if (sx < 0) { fx = 0.0f; sx = 0; }
+                if (sx >= src_w - 1) { fx = 0.0f; sx = src_w - 1; }
+                sx0 = sx;
+                sx1 = std::min(sx + 1, src_w - 1);
+            }
+            s.xofs0[dx] = sx0 * 3;
+            s.xofs1[dx] = sx1 * 3;
+            s.alpha0[dx] = CoefToFixed(1.0f - fx);
+            s.alpha1[dx] = CoefToFixed(fx);
+        }
+
+        for (int dy = 0; dy < new_h; ++dy) {
+            int sy0 = dy, sy1 = dy;
+            float fy = 0.0f;
+            if (s.mode == VMode::Area2x) {
+                sy0 = dy * 2; sy1 = dy * 2 + 1;
+            }
+            else if (s.mode == VMode::Linear) {
+                // unlike x, OpenCV keeps the fraction at the borders and only clamps the row index
+                fy = static_cast<float>((dy + 0.5) * scale_y - 0.5);
+                int sy = static_cast<int>(std::floor(fy));
+                fy -= sy;
+                sy0 = std::min(std::max(sy, 0), src_h - 1);
+                sy1 = std::min(std::max(sy + 1, 0), src_h - 1);
+            }
+            s.yofs0[dy] = sy0;
+            s.yofs1[dy] = sy1;
+            s.beta0[dy] = CoefToFixed(1.0f - fy);
+            s.beta1[dy] = CoefToFixed(fy);
+        }
+
+        for (auto& r : s.rows) r.assign(static_cast<size_t>(3) * new_w, 0);
+        s.row_src[0] = s.row_src[1] = -1;
+    }
+
+    // Horizontal pass of one source row into planar int channels (B, G, R order kept).
+    void HResizeRow(const Scratch& s, const uint8_t* src, int* dst) {
+        const int n = s.new_w;
+        int* d0 = dst;
+        int* d1 = dst + n;
+        int* d2 = dst + 2 * n;
+
+        switch (s.mode) {
+        case VMode::Linear:
+            for (int dx = 0; dx < n; ++dx) {
+                const uint8_t* p0 = src + s.xofs0[dx];
+                const uint8_t* p1 = src + s.xofs1[dx];
+                const int a0 = s.alpha0[dx], a1 = s.alpha1[dx];
+                d0[dx] = p0[0] * a0 + p1[0] * a1;
+                d1[dx] = p0[1] * a0 + p1[1] * a1;
+                d2[dx] = p0[2] * a0 + p1[2] * a1;
+            }
+            break;
+        case VMode::Area2x:
+            for (int dx = 0; dx < n; ++dx) {
+                const uint8_t* p = src + dx * 6;
+                d0[dx] = p[0] + p[3];
+                d1[dx] = p[1] + p[4];
+                d2[dx] = p[2] + p[5];
+            }
+            break;
+        case VMode::Copy:
+            for (int dx = 0; dx < n; ++dx) {
+                const uint8_t* p = src + dx * 3;
+                d0[dx] = p[0];
+                d1[dx] = p[1];
+                d2[dx] = p[2];
+            }
+            break;
+        }
+    }
+
+    inline int VCombineOne(int s0, int s1, int b0, int b1, VMode mode) {
+        switch (mode) {
+        case VMode::Linear: return (((b0 * (s0 >> 4)) >> 16) + ((b1 * (s1 >> 4)) >> 16) + 2) >> 2;
+        case VMode::Area2x: return (s0 + s1 + 2) >> 2;
+        default:            return s0;
+        }
+    }
+
+    void VCombineScalar(const int* s0, const int* s1, int b0, int b1, VMode mode,
+        float* dst, int x, int n) {
+        for (; x < n; ++x) {
+            dst[x] = VCombineOne(s0[x], s1[x], b0, b1, mode) * kInv255;
+        }
+    }
+
+#if LB_HAVE_X86
+    LB_TARGET_AVX2
+    void VCombineAVX2(const int* s0, const int* s1, int b0, int b1, VMode mode, float* dst, int n) {
+        const __m256 inv = _mm256_set1_ps(kInv255);
+        const __m256i two = _mm256_set1_epi32(2);
+        const __m256i vb0 = _mm256_set1_epi32(b0);
+        const __m256i vb1 = _mm256_set1_epi32(b1);
+
+        int x = 0;
+        for (; x + 8 <= n; x += 8) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s0 + x));
+            __m256i v;
+            if (mode == VMode::Linear) {
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s1 + x));
+                __m256i t0 = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(a, 4), vb0), 16);
+                __m256i t1 = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(b, 4), vb1), 16);
+                v = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(t0, t1), two), 2);
+            }
+            else if (mode == VMode::Area2x) {
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s1 + x));
+                v = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(a, b), two), 2);
+            }
+            else {
+                v = a;
+            }
+            _mm256_storeu_ps(dst + x, _mm256_mul_ps(_mm256_cvtepi32_ps(v), inv));
+        }
+        VCombineScalar(s0, s1, b0, b1, mode, dst, x, n);
+    }
+
+    LB_TARGET_SSE41
+    void VCombineSSE41(const int* s0, const int* s1, int b0, int b1, VMode mode, float* dst, int n) {
+        const __m128 inv = _mm_set1_ps(kInv255);
+        const __m128i two = _mm_set1_epi32(2);
+        const __m128i vb0 = _mm_set1_epi32(b0);
+        const __m128i vb1 = _mm_set1_epi32(b1);
+
+        int x = 0;
+        for (; x + 4 <= n; x += 4) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s0 + x));
+            __m128i v;
+            if (mode == VMode::Linear) {
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1 + x));
+                __m128i t0 = _mm_srai_epi32(_mm_mullo_epi32(_mm_srai_epi32(a, 4), vb0), 16);
+                __m128i t1 = _mm_srai_epi32(_mm_mullo_epi32(_mm_srai_epi32(b, 4), vb1), 16);
+                v = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(t0, t1), two), 2);
+            }
+            else if (mode == VMode::Area2x) {
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1 + x));
+                v = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(a, b), two), 2);
+            }
+            else {
+                v = a;
+            }
+            _mm_storeu_ps(dst + x, _mm_mul_ps(_mm_cvtepi32_ps(v), inv));
+        }
+        VCombineScalar(s0, s1, b0, b1, mode, dst, x, n);
+    }
+#endif
+
+    using VCombineFn = void (*)(const int*, const int*, int, int, VMode, float*, int);
+
+    void VCombineFallback(const int* s0, const int* s1, int b0, int b1, VMode mode, float* dst, int n) {
+        VCombineScalar(s0, s1, b0, b1, mode, dst, 0, n);
+    }
+
+    void U8ToFloatScalar(const uint8_t* src, float* dst, size_t i, size_t n) {
+        for (; i < n; ++i) dst[i] = src[i] * kInv255;
+    }
+
+#if LB_HAVE_X86
+    LB_TARGET_AVX2
+    void U8ToFloatAVX2(const uint8_t* src, float* dst, size_t n) {
+        const __m256 inv = _mm256_set1_ps(kInv255);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+            __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(f, inv));
+        }
+        U8ToFloatScalar(src, dst, i, n);
+    }
+
+    LB_TARGET_SSE41
+    void U8ToFloatSSE41(const uint8_t* src, float* dst, size_t n) {
+        const __m128 inv = _mm_set1_ps(kInv255);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            int32_t w;
+            std::memcpy(&w, src + i, 4);
+            __m128 f = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(w)));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(f, inv));
+        }
+        U8ToFloatScalar(src, dst, i, n);
+    }
+#endif
+
+    void U8ToFloatFallback(const uint8_t* src, float* dst, size_t n) {
+        U8ToFloatScalar(src, dst, 0, n);
+    }
+
+    // IEEE binary16 bits, round to nearest even
+    uint16_t FloatToHalfBits(float f) {
+        uint32_t x;
+        std::memcpy(&x, &f, 4);
+        const uint32_t sign = (x >> 16) & 0x8000u;
+        const uint32_t e8 = (x >> 23) & 0xffu;
+        uint32_t mant = x & 0x007fffffu;
+
+        if (e8 == 0xffu) return static_cast<uint16_t>(sign | 0x7c00u | (mant ? 0x200u : 0u)); // inf / nan
+        const int exp = static_cast<int>(e8) - 127 + 15;
+        if (exp >= 31) return static_cast<uint16_t>(sign | 0x7c00u);                          // overflow
+        if (exp <= 0) {
+            // subnormal half
+            if (exp < -10) return static_cast<uint16_t>(sign);
+            mant |= 0x00800000u;
+            const int shift = 14 - exp;
+            uint32_t h = mant >> shift;
+            const uint32_t rem = mant & ((1u << shift) - 1u);
+            const uint32_t mid = 1u << (shift - 1);
+            if (rem > mid || (rem == mid && (h & 1u))) ++h;
+            return static_cast<uint16_t>(sign | h);
+        }
+        uint32_t h = sign | (static_cast<uint32_t>(exp) << 10) | (mant >> 13);
+        const uint32_t rem = mant & 0x1fffu;
+        if (rem > 0x1000u || (rem == 0x1000u && (h & 1u))) ++h; // a carry into the exponent is correct
+        return static_cast<uint16_t>(h);
+    }
+
+    void FloatToHalfScalar(const float* src, uint16_t* dst, size_t i, size_t n) {
+        for (; i < n; ++i) dst[i] = FloatToHalfBits(src[i]);
+    }
+
+#if LB_HAVE_X86
+    LB_TARGET_F16C
+    void FloatToHalfF16C(const float* src, uint16_t* dst, size_t n) {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+        }
+        FloatToHalfScalar(src, dst, i, n);
+    }
+#endif
+
+    void FloatToHalfFallback(const float* src, uint16_t* dst, size_t n) {
+        FloatToHalfScalar(src, dst, 0, n);
+    }
+
+    VCombineFn SelectVCombine() {
+#if LB_HAVE_X86
+        if (cv::checkHardwareSupport(CV_CPU_AVX2)) return &VCombineAVX2;
+        if (cv::checkHardwareSupport(CV_CPU_SSE4_1)) return &VCombineSSE41;
+#endif
+        return &VCombineFallback;
+    }
+
+    void FillRect(float* plane, int stride, int x, int y, int w, int h, float v) {
+        if (w <= 0 || h <= 0) return;
+        for (int r = 0; r < h; ++r) {
+            float* p = plane + static_cast<size_t>(y + r) * stride + x;
+            std::fill(p, p + w, v);
+        }
+    }
+
+    // Returns the cached row buffer holding horizontally-resized source row `sy`.
+    const int* GetHRow(Scratch& s, const cv::Mat& src, int sy, int keep) {
+        for (int i = 0; i < 2; ++i) {
+            if (s.row_src[i] == sy) return s.rows[i].data();
+        }
+        // evict the slot that is not needed by the other row of this output line
+        int slot = (s.row_src[0] == keep) ? 1 : 0;
+        HResizeRow(s, src.ptr<uint8_t>(sy), s.rows[slot].data());
+        s.row_src[slot] = sy;
+        return s.rows[slot].data();
+    }
+}
+
+void LetterboxToCHWFloat01_RGB(const cv::Mat& src_bgr, int dst_w, int dst_h,
+    float* dst_chw, LetterBoxInfo& info) {
+    CV_Assert(src_bgr.type() == CV_8UC3);
+    if (!dst_chw) {
+        throw std::runtime_error("LetterboxToCHWFloat01_RGB: dst_chw is null.");
+    }
+
+    const int src_w = src_bgr.cols;
+    const int src_h = src_bgr.rows;
+
+    // same geometry as LetterboxBGR
+    float r = std::min(
+        dst_w / static_cast<float>(src_w),
+        dst_h / static_cast<float>(src_h)
+    );
+    int new_w = static_cast<int>(std::round(src_w * r));
+    int new_h = static_cast<int>(std::round(src_h * r));
+    if (new_w <= 0 || new_h <= 0 || new_w > dst_w || new_h > dst_h) {
+        throw std::runtime_error("LetterboxToCHWFloat01_RGB: invalid letterbox geometry.");
+    }
+
+    const int pad_left = (dst_w - new_w) / 2;
+    const int pad_top = (dst_h - new_h) / 2;
+
+    info.scale = r;
+    info.pad_x = pad_left;
+    info.pad_y = pad_top;
+    info.dst_w = dst_w;
+    info.dst_h = dst_h;
+
+    const size_t plane = static_cast<size_t>(dst_w) * dst_h;
+    float* dst_r = dst_chw;
+    float* dst_g = dst_chw + plane;
+    float* dst_b = dst_chw + 2 * plane;
+
+    // 1) pad border only
+    const float pad_v = 114 * kInv255;
+    for (float* p : { dst_r, dst_g, dst_b }) {
+        FillRect(p, dst_w, 0, 0, dst_w, pad_top, pad_v);
+        FillRect(p, dst_w, 0, pad_top + new_h, dst_w, dst_h - pad_top - new_h, pad_v);
+        FillRect(p, dst_w, 0, pad_top, pad_left, new_h, pad_v);
+        FillRect(p, dst_w, pad_left + new_w, pad_top, dst_w - pad_left - new_w, new_h, pad_v);
+    }
+
+    // 2) content: resize + swap + normalize + transpose, one output row at a time
+    thread_local Scratch s;
+    if (s.src_w != src_w || s.src_h != src_h || s.new_w != new_w || s.new_h != new_h) {
+        BuildTables(s, src_w, src_h, new_w, new_h);
+    }
+    s.row_src[0] = s.row_src[1] = -1; // new frame, cached rows are stale
+
+    static const VCombineFn vcombine = SelectVCombine();
+
+    for (int dy = 0; dy < new_h; ++dy) {
+        const int sy0 = s.yofs0[dy];
+        const int sy1 = s.yofs1[dy];
+        const int* h0 = GetHRow(s, src_bgr, sy0, sy1);
+        const int* h1 = (sy1 == sy0) ? h0 : GetHRow(s, src_bgr, sy1, sy0);
+
+        const size_t out_off = static_cast<size_t>(pad_top + dy) * dst_w + pad_left;
+        const int b0 = s.beta0[dy], b1 = s.beta1[dy];
+
+        // cached rows are planar B, G, R; the tensor is R, G, B
+        vcombine(h0 + 2 * new_w, h1 + 2 * new_w, b0, b1, s.mode, dst_r + out_off, new_w);
+        vcombine(h0 + new_w, h1 + new_w, b0, b1, s.mode, dst_g + out_off, new_w);
+        vcombine(h0, h1, b0, b1, s.mode, dst_b + out_off, new_w);
+    }
+}
+
+void NV12ToPlanarRGB(const cv::Mat& nv12, cv::Mat& planes) {
+    CV_Assert(nv12.type() == CV_8UC1 && nv12.rows % 3 == 0 && nv12.cols % 2 == 0);
+    const int h = nv12.rows * 2 / 3;
+    const int w = nv12.cols;
+
+    thread_local cv::Mat rgb;
+    cv::cvtColor(nv12, rgb, cv::COLOR_YUV2RGB_NV12);
+
+    planes.create(3 * h, w, CV_8UC1);
+    cv::Mat dst[3] = { planes.rowRange(0, h), planes.rowRange(h, 2 * h), planes.rowRange(2 * h, 3 * h) };
+    cv::split(rgb, dst);  // writes into the views: they already have the right size and type
+}
+
+void PlanarU8ToCHWFloat01(const cv::Mat& planes, float* dst_chw) {
+    CV_Assert(planes.type() == CV_8UC1);
+
+    using Fn = void (*)(const uint8_t*, float*, size_t);
+    static const Fn fn = [] {
+#if LB_HAVE_X86
+        if (cv::checkHardwareSupport(CV_CPU_AVX2)) return static_cast<Fn>(&U8ToFloatAVX2);
+        if (cv::checkHardwareSupport(CV_CPU_SSE4_1)) return static_cast<Fn>(&U8ToFloatSSE41);
+#endif
+        return static_cast<Fn>(&U8ToFloatFallback);
+    }();
+
+    if (planes.isContinuous()) {
+        fn(planes.data, dst_chw, planes.total());
+        return;
+    }
+    for (int y = 0; y < planes.rows; ++y) {
+        fn(planes.ptr<uint8_t>(y), dst_chw + static_cast<size_t>(y) * planes.cols, planes.cols);
+    }
+}
+
+void Float01ToHalf(const float* src, uint16_t* dst, size_t n) {
+    using Fn = void (*)(const float*, uint16_t*, size_t);
+    static const Fn fn = [] {
+#if LB_HAVE_X86
+        if (cv::checkHardwareSupport(CV_CPU_AVX) && cv::checkHardwareSupport(CV_CPU_FP16)) {
+            return static_cast<Fn>(&FloatToHalfF16C);
+        }
+#endif
+        return static_cast<Fn>(&FloatToHalfFallback);
+    }();
+    fn(src, dst, n);
+}
+
+void Float01ToU8(const float* src, uint8_t* dst, size_t n) {
+    // inputs are k/255 values from the kernels above, so this recovers k exactly
+    for (size_t i = 0; i < n; ++i) {
+        const int v = static_cast<int>(src[i] * 255.0f + 0.5f);
+        dst[i] = static_cast<uint8_t>(std::min(255, std::max(0, v)));
+    }
+}
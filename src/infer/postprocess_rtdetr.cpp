@@ -1,20 +1,30 @@
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
+#include <opencv2/opencv.hpp>
 
 #include "infer/postprocess_rtdetr.h"
+#include "common/metrics.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PP_HAVE_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define PP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PP_TARGET_AVX2
+#endif
+#else
+#define PP_HAVE_X86 0
+#endif
 
 static inline float Sigmoid(float x) {
     return 1.0f / (1.0f + std::exp(-x));
 }
 
-std::vector<Det> PostprocessRTDETR(
-    const Ort::Value& out0,
-    int input_w, int input_h,
-    const LetterBoxInfo& lb,
-    int orig_w, int orig_h,
-    const PostprocessOptions& opt
-) {
+// Checks the [N,Q,4+C] float layout and returns N, Q, dim
+static void CheckOutputShape(const Ort::Value& out0, int64_t& batch, int64_t& num_queries, int64_t& dim) {
     if (!out0.IsTensor()) {
         throw std::runtime_error("RT-DETR output is not a tensor.");
     }
@@ -26,67 +36,207 @@ std::vector<Det> PostprocessRTDETR(
         throw std::runtime_error("Unexpected output rank (expect 3).");
     }
 
-    int64_t num_queries = shape[1];
-    int64_t dim = shape[2];
+    batch = shape[0];
+    num_queries = shape[1];
+    dim = shape[2];
     if (dim < 6) {
         throw std::runtime_error("Unexpected output dim (<6).");
     }
 
-    int class_count = (int)(dim - 4);
-
     if (info.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
         throw std::runtime_error("Output tensor is not float.");
     }
+}
 
-    const float* out_data = out0.GetTensorData<float>();
+// Max over n floats. Queries whose max is below the threshold are rejected on this value
+// alone; the class index is only looked up for the survivors.
+static float MaxScalar(const float* v, int n) {
+    float m = v[0];
+    for (int i = 1; i < n; ++i) m = v[i] > m ? v[i] : m;
+    return m;
+}
 
-    std::vector<Det> dets;
-    dets.reserve((size_t)num_queries);
+#if PP_HAVE_X86
+PP_TARGET_AVX2
+static float MaxAVX2(const float* v, int n) {
+    if (n < 8) return MaxScalar(v, n);
+    __m256 m = _mm256_loadu_ps(v);
+    int i = 8;
+    for (; i + 8 <= n; i += 8) m = _mm256_max_ps(m, _mm256_loadu_ps(v + i));
+    if (i < n) m = _mm256_max_ps(m, _mm256_loadu_ps(v + n - 8)); // overlapping tail
+    __m128 h = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+    h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+    h = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+    return _mm_cvtss_f32(h);
+}
+#endif
 
-    // W/H  input_w/input_hletterbox Ŀߴ磩
-    const float W = (float)input_w;
-    const float H = (float)input_h;
+using MaxFn = float (*)(const float*, int);
 
-    for (int64_t q = 0; q < num_queries; ++q) {
-        const float* row = out_data + q * dim; // batch=1
-
-        float cx = row[0];
-        float cy = row[1];
-        float bw = row[2];
-        float bh = row[3];
-
-        int best_id = -1;
-        float best_logit = -1e9f;
-        for (int c = 0; c < class_count; ++c) {
-            float v = row[4 + c];
-            if (v > best_logit) { best_logit = v; best_id = c; }
+static MaxFn SelectMax() {
+#if PP_HAVE_X86
+    if (cv::checkHardwareSupport(CV_CPU_AVX2)) return &MaxAVX2;
+#endif
+    return &MaxScalar;
+}
+
+namespace {
+    // Per-thread scratch, grows to the largest query count seen
+    struct Candidates {
+        std::vector<int> query;
+        std::vector<int> cls;
+        std::vector<float> score;
+        std::vector<float> x1, y1, x2, y2;
+
+        void Resize(size_t n) {
+            query.resize(n); cls.resize(n); score.resize(n);
+            x1.resize(n); y1.resize(n); x2.resize(n); y2.resize(n);
         }
+    };
+}
 
-        float score = opt.apply_sigmoid ? Sigmoid(best_logit) : best_logit;
+// Decodes the Q query rows of one image
+static void DecodeImage(
+    const float* out_data,
+    int64_t num_queries, int64_t dim,
+    int input_w, int input_h,
+    const LetterBoxInfo& lb,
+    int orig_w, int orig_h,
+    const PostprocessOptions& opt,
+    std::vector<Det>& dets
+) {
+    static const MaxFn row_max = SelectMax();
+    static metrics::Histogram& time = metrics::Stage("postprocess");
+    metrics::ScopedTimer timer(time);
+    thread_local Candidates cand;
+
+    dets.clear();
+    const int class_count = (int)(dim - 4);
+
+    // threshold in logit space: sigmoid is monotonic, so sigmoid(x) < t <=> x < log(t / (1 - t)).
+    // The pre-filter is a hair loose; survivors get the exact sigmoid check below.
+    float pre_thresh = opt.score_thresh;
+    if (opt.apply_sigmoid) {
+        const float t = opt.score_thresh;
+        if (t <= 0.0f) pre_thresh = -std::numeric_limits<float>::infinity();
+        else if (t >= 1.0f) pre_thresh = std::numeric_limits<float>::infinity();
+        else pre_thresh = std::log(t / (1.0f - t)) - 1e-4f;
+    }
+
+    // 1) argmax + threshold: no exp for rejected queries
+    cand.Resize((size_t)num_queries);
+    size_t n = 0;
+    for (int64_t q = 0; q < num_queries; ++q) {
+        const float* logits = out_data + q * dim + 4;
+        const float best_logit = row_max(logits, class_count);
+        if (!(best_logit >= pre_thresh)) continue;
+
+        const float score = opt.apply_sigmoid ? Sigmoid(best_logit) : best_logit;
         if (score < opt.score_thresh) continue;
 
-        // normalized cxcywh -> letterbox pixel coords
-        float x1 = (cx - bw * 0.5f) * W;
-        float y1 = (cy - bh * 0.5f) * H;
-        float x2 = (cx + bw * 0.5f) * W;
-        float y2 = (cy + bh * 0.5f) * H;
+        // first class holding the max (same tie-breaking as a scalar argmax)
+        int best_id = 0;
+        while (logits[best_id] != best_logit) ++best_id;
 
-        // undo letterbox
-        x1 = (x1 - (float)lb.pad_x) / lb.scale;
-        y1 = (y1 - (float)lb.pad_y) / lb.scale;
-        x2 = (x2 - (float)lb.pad_x) / lb.scale;
-        y2 = (y2 - (float)lb.pad_y) / lb.scale;
+        cand.query[n] = (int)q;
+        cand.cls[n] = best_id;
+        cand.score[n] = score;
+        ++n;
+    }
+    if (n == 0) return;
 
-        // clamp to original image
-        x1 = std::max(0.0f, std::min(x1, (float)(orig_w - 1)));
-        y1 = std::max(0.0f, std::min(y1, (float)(orig_h - 1)));
-        x2 = std::max(0.0f, std::min(x2, (float)(orig_w - 1)));
-        y2 = std::max(0.0f, std::min(y2, (float)(orig_h - 1)));
+    // 2) boxes of the survivors, branch-free over SoA arrays (vectorized by the compiler):
+    // normalized cxcywh -> letterbox pixels -> undo letterbox -> clamp to the original image.
+    // Same operations in the same order as the scalar per-query version, so the boxes are
+    // bit-identical to it (folding W / scale into one factor is not: tests/postprocess_test.cpp).
+    const float W = (float)input_w;
+    const float H = (float)input_h;
+    const float pad_x = (float)lb.pad_x;
+    const float pad_y = (float)lb.pad_y;
+    const float scale = lb.scale;
+    const float max_x = (float)(orig_w - 1);
+    const float max_y = (float)(orig_h - 1);
+
+    for (size_t i = 0; i < n; ++i) {
+        const float* row = out_data + (int64_t)cand.query[i] * dim;
+        cand.x1[i] = row[0] - row[2] * 0.5f;
+        cand.y1[i] = row[1] - row[3] * 0.5f;
+        cand.x2[i] = row[0] + row[2] * 0.5f;
+        cand.y2[i] = row[1] + row[3] * 0.5f;
+    }
+    float* X1 = cand.x1.data();
+    float* Y1 = cand.y1.data();
+    float* X2 = cand.x2.data();
+    float* Y2 = cand.y2.data();
+    for (size_t i = 0; i < n; ++i) {
+        X1[i] = std::max(0.0f, std::min((X1[i] * W - pad_x) / scale, max_x));
+        Y1[i] = std::max(0.0f, std::min((Y1[i] * H - pad_y) / scale, max_y));
+        X2[i] = std::max(0.0f, std::min((X2[i] * W - pad_x) / scale, max_x));
+        Y2[i] = std::max(0.0f, std::min((Y2[i] * H - pad_y) / scale, max_y));
+    }
 
-        if (x2 <= x1 || y2 <= y1) continue;
+    // 3) compact into the caller's buffer
+    if (dets.capacity() < n) dets.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (X2[i] <= X1[i] || Y2[i] <= Y1[i]) continue;
+        dets.push_back({ X1[i], Y1[i], X2[i], Y2[i], cand.cls[i], cand.score[i] });
+    }
 
-        dets.push_back({ x1, y1, x2, y2, best_id, score });
+    // 4) optional top-K, best scores first
+    if (opt.top_k > 0 && dets.size() > (size_t)opt.top_k) {
+        auto by_score = [](const Det& a, const Det& b) { return a.score > b.score; };
+        std::partial_sort(dets.begin(), dets.begin() + opt.top_k, dets.end(), by_score);
+        dets.resize((size_t)opt.top_k);
     }
+}
+
+void PostprocessRTDETR(
+    const Ort::Value& out0,
+    int input_w, int input_h,
+    const LetterBoxInfo& lb,
+    int orig_w, int orig_h,
+    const PostprocessOptions& opt,
+    std::vector<Det>& dets
+) {
+    int64_t batch = 0, num_queries = 0, dim = 0;
+    CheckOutputShape(out0, batch, num_queries, dim);
+
+    DecodeImage(out0.GetTensorData<float>(), num_queries, dim, // batch=1
+        input_w, input_h, lb, orig_w, orig_h, opt, dets);
+}
 
+std::vector<Det> PostprocessRTDETR(
+    const Ort::Value& out0,
+    int input_w, int input_h,
+    const LetterBoxInfo& lb,
+    int orig_w, int orig_h,
+    const PostprocessOptions& opt
+) {
+    std::vector<Det> dets;
+    PostprocessRTDETR(out0, input_w, input_h, lb, orig_w, orig_h, opt, dets);
     return dets;
 }
+
+std::vector<std::vector<Det>> PostprocessRTDETRBatch(
+    const Ort::Value& out0,
+    int input_w, int input_h,
+    const std::vector<BatchItemInfo>& items,
+    const PostprocessOptions& opt
+) {
+    int64_t batch = 0, num_queries = 0, dim = 0;
+    CheckOutputShape(out0, batch, num_queries, dim);
+
+    if (batch < (int64_t)items.size()) {
+        throw std::runtime_error("RT-DETR output batch is smaller than the number of frames.");
+    }
+
+    const float* out_data = out0.GetTensorData<float>();
+
+    std::vector<std::vector<Det>> all(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        const BatchItemInfo& it = items[i];
+        DecodeImage(out_data + (int64_t)i * num_queries * dim, num_queries, dim,
+            input_w, input_h, it.lb, it.orig_w, it.orig_h, opt, all[i]);
+    }
+    return all;
+}
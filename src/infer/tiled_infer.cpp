@@ -0,0 +1,200 @@
+#include "infer/tiled_infer.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+TiledInfer::TiledInfer(InferEngine& engine)
+    : TiledInfer(engine, Options()) { }
+
+TiledInfer::TiledInfer(InferEngine& engine, const Options& opt)
+    : engine_(engine),
+    opt_(opt) {
+    if (!opt_.static_mask.empty() && opt_.static_mask.type() != CV_8UC1) {
+        throw std::runtime_error("TiledInfer: static_mask must be CV_8UC1.");
+    }
+}
+
+std::vector<cv::Rect> TiledInfer::GridTiles(int w, int h, int tile_w, int tile_h, float overlap) {
+    // start positions along one axis: first at 0, last at size - tile, evenly in between
+    auto starts = [&](int size, int tile) {
+        std::vector<int> s;
+        if (tile <= 0 || size <= tile) {
+            s.push_back(0);
+            return s;
+        }
+        const double stride = tile * (1.0 - std::clamp(static_cast<double>(overlap), 0.0, 0.95));
+        const int n = static_cast<int>(std::ceil((size - tile) / stride)) + 1;
+        for (int i = 0; i < n; ++i) {
+            s.push_back(static_cast<int>(std::lround(static_cast<double>(size - tile) * i / (n - 1))));
+        }
+        return s;
+    };
+
+    std::vector<cv::Rect> tiles;
+    const cv::Rect frame(0, 0, w, h);
+    for (int y : starts(h, tile_h)) {
+        for (int x : starts(w, tile_w)) {
+            tiles.push_back(cv::Rect(x, y, tile_w, tile_h) & frame);
+        }
+    }
+    return tiles;
+}
+
+void TiledInfer::Layout(int w, int h) {
+    layout_size_ = cv::Size(w, h);
+    tiles_.clear();
+    skipped_ = 0;
+
+    const cv::Rect frame(0, 0, w, h);
+    std::vector<cv::Rect> cand;
+    if (!opt_.rois.empty()) {
+        for (const cv::Rect2f& r : opt_.rois) {
+            cv::Rect px(cv::Point(static_cast<int>(std::floor(r.x * w)), static_cast<int>(std::floor(r.y * h))),
+                cv::Point(static_cast<int>(std::ceil((r.x + r.width) * w)), static_cast<int>(std::ceil((r.y + r.height) * h))));
+            px &= frame;
+            if (px.area() > 0) cand.push_back(px);
+        }
+    }
+    else {
+        const int tw = opt_.tile_w > 0 ? opt_.tile_w : engine_.InputW();
+        const int th = opt_.tile_h > 0 ? opt_.tile_h : engine_.InputH();
+        cand = GridTiles(w, h, tw, th, opt_.overlap);
+    }
+    if (opt_.full_frame && std::find(cand.begin(), cand.end(), frame) == cand.end()) {
+        cand.push_back(frame);
+    }
+
+    cv::Mat mask;
+    if (!opt_.static_mask.empty()) {
+        cv::resize(opt_.static_mask, mask, layout_size_, 0, 0, cv::INTER_NEAREST);
+    }
+    for (const cv::Rect& t : cand) {
+        if (!mask.empty()) {
+            const double masked = static_cast<double>(cv::countNonZero(mask(t))) / t.area();
+            if (masked > opt_.mask_skip_fraction) {
+                ++skipped_;
+                continue;
+            }
+        }
+        tiles_.push_back(t);
+    }
+}
+
+void TiledInfer::Run(const cv::Mat& bgr, std::vector<Det>& dets) {
+    if (bgr.empty() || bgr.type() != CV_8UC3) {
+        throw std::runtime_error("TiledInfer: expected a CV_8UC3 frame.");
+    }
+    if (bgr.size() != layout_size_) Layout(bgr.cols, bgr.rows);
+
+    dets.clear();
+    if (tiles_.empty()) return;
+
+    views_.clear();
+    for (const cv::Rect& t : tiles_) views_.push_back(bgr(t));  // header only, shares the pixels
+
+    raw_.clear();
+    cut_.clear();
+    size_t batch = 1;
+    if (engine_.DynamicBatch()) {
+        batch = opt_.max_batch > 0 ? static_cast<size_t>(opt_.max_batch) : views_.size();
+    }
+    const int m = opt_.edge_margin;
+
+    for (size_t i0 = 0; i0 < views_.size(); i0 += batch) {
+        const size_t count = std::min(batch, views_.size() - i0);
+        BatchInferResult r = engine_.RunBatch(views_.data() + i0, count);
+        const auto per_tile = PostprocessRTDETRBatch(r.outputs[0], engine_.InputW(), engine_.InputH(), r.items, opt_.pp);
+
+        for (size_t k = 0; k < count; ++k) {
+            const cv::Rect& t = tiles_[i0 + k];
+            // inner edges only: a box at the frame border is not cut off by the tiling
+            const bool inner_l = t.x > 0, inner_t = t.y > 0;
+            const bool inner_r = t.x + t.width < bgr.cols, inner_b = t.y + t.height < bgr.rows;
+
+            for (Det d : per_tile[k]) {
+                const bool cut = (inner_l && d.x1 <= m) || (inner_t && d.y1 <= m)
+                    || (inner_r && d.x2 >= t.width - m) || (inner_b && d.y2 >= t.height - m);
+                d.x1 += t.x; d.x2 += t.x;
+                d.y1 += t.y; d.y2 += t.y;
+                raw_.push_back(d);
+                cut_.push_back(cut ? 1 : 0);
+            }
+        }
+    }
+
+    MergeDetections(raw_, cut_, opt_.merge, opt_.merge_thresh);
+    dets.swap(raw_);
+}
+
+std::vector<Det> TiledInfer::Run(const cv::Mat& bgr) {
+    std::vector<Det> dets;
+    Run(bgr, dets);
+    return dets;
+}
+
+void TiledInfer::MergeDetections(std::vector<Det>& dets, const std::vector<char>& cut,
+    Merge merge, float thresh) {
+    const size_t n = dets.size();
+    if (n < 2) return;
+
+    auto area = [](const Det& d) { return std::max(0.f, d.x2 - d.x1) * std::max(0.f, d.y2 - d.y1); };
+    auto overlap = [&](size_t a, size_t b) {
+        const Det& p = dets[a];
+        const Det& q = dets[b];
+        const float iw = std::min(p.x2, q.x2) - std::max(p.x1, q.x1);
+        const float ih = std::min(p.y2, q.y2) - std::max(p.y1, q.y1);
+        if (iw <= 0.f || ih <= 0.f) return 0.f;
+        const float inter = iw * ih;
+        const bool partial = !cut.empty() && (cut[a] || cut[b]);
+        const float denom = partial ? std::min(area(p), area(q)) : area(p) + area(q) - inter;
+        return denom > 0.f ? inter / denom : 0.f;
+    };
+
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return dets[a].score > dets[b].score; });
+
+    std::vector<char> used(n, 0);
+    std::vector<Det> out;
+    out.reserve(n);
+    for (size_t oi = 0; oi < n; ++oi) {
+        const size_t i = order[oi];
+        if (used[i]) continue;
+        used[i] = 1;
+
+        // boxes cut off by a tile edge only represent the group when it has nothing else:
+        // NMS keeps the best complete box, WBF averages the complete ones
+        auto is_cut = [&](size_t k) { return !cut.empty() && cut[k] != 0; };
+        size_t keep = is_cut(i) ? n : i;
+        float sum[2][5] = {};  // [cut][w, x1, y1, x2, y2]
+        auto add = [&](size_t k) {
+            const Det& d = dets[k];
+            float* a = sum[is_cut(k) ? 1 : 0];
+            a[0] += d.score;
+            a[1] += d.x1 * d.score; a[2] += d.y1 * d.score;
+            a[3] += d.x2 * d.score; a[4] += d.y2 * d.score;
+        };
+        add(i);
+
+        for (size_t oj = oi + 1; oj < n; ++oj) {
+            const size_t j = order[oj];
+            if (used[j] || dets[j].class_id != dets[i].class_id) continue;
+            if (overlap(i, j) < thresh) continue;
+            used[j] = 1;
+            add(j);
+            if (keep == n && !is_cut(j)) keep = j;
+        }
+
+        Det best = dets[keep == n ? i : keep];
+        if (merge == Merge::WBF) {
+            const float* a = sum[0][0] > 0.f ? sum[0] : sum[1];
+            if (a[0] > 0.f) {
+                best.x1 = a[1] / a[0]; best.y1 = a[2] / a[0];
+                best.x2 = a[3] / a[0]; best.y2 = a[4] / a[0];
+            }
+        }
+        out.push_back(best);
+    }
+    dets.swap(out);
+}
@@ -0,0 +1,235 @@
+#include "pipeline/adaptive_profile.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "common/metrics.h"
+
+namespace pipeline {
+
+    static metrics::Gauge& ProfileLevelGauge() {
+        static metrics::Gauge& g = metrics::Registry::Global().GetGauge("cppinfer_profile_level", "",
+            "Current level of the adaptive stream profile (0 = best quality)");
+        return g;
+    }
+
+    static int64_t SteadyNowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    ProfileController::ProfileController(std::vector<StreamProfile> ladder)
+        : ProfileController(std::move(ladder), Options()) { }
+
+    ProfileController::ProfileController(std::vector<StreamProfile> ladder, const Options& opt)
+        : ladder_(std::move(ladder)),
+        opt_(opt) {
+        if (ladder_.empty()) {
+            throw std::runtime_error("ProfileController needs at least one profile.");
+        }
+        const int start = std::clamp(opt_.start_level, 0, static_cast<int>(ladder_.size()) - 1);
+        level_ = start;
+        switched_at_ = Clock::now();
+        upgrade_after_ms_.assign(ladder_.size(), opt_.upgrade_after_ms);
+        degrade_latency_.assign(ladder_.size(), 0.0);
+        ProfileLevelGauge().Set(start);
+    }
+
+    void ProfileController::Observe(const video::Frame& f) {
+        int64_t capture_us = 0;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            pts_clock_.Observe(f);
+            capture_us = pts_clock_.CaptureUs(f);
+        }
+        ObserveLatency(std::max<int64_t>(0, SteadyNowUs() - capture_us) / 1000.0);
+    }
+
+    void ProfileController::ObserveLatency(double latency_ms) {
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> lk(mu_);
+
+        ewma_ = ewma_ < 0.0 ? latency_ms : ewma_ + opt_.smoothing * (latency_ms - ewma_);
+
+        const int level = level_.load(std::memory_order_relaxed);
+        const bool dwelled = now - switched_at_ >= std::chrono::milliseconds(opt_.min_dwell_ms);
+        const bool in_window = now - switched_at_ < std::chrono::milliseconds(
+            static_cast<int64_t>(opt_.min_dwell_ms) * std::max(1, opt_.revert_window));
+
+        // the last upgrade held: it was not a failed probe, the level may be tried right away again
+        if (last_was_upgrade_ && !in_window) {
+            upgrade_after_ms_[level] = opt_.upgrade_after_ms;
+            last_was_upgrade_ = false;
+        }
+
+        // over the target: step down to a cheaper profile once it lasted degrade_after_ms
+        if (ewma_ > opt_.target_ms * opt_.degrade_above) {
+            below_since_ = {};
+            if (above_since_ == Clock::time_point{}) above_since_ = now;
+            if (dwelled && level + 1 < static_cast<int>(ladder_.size())
+                && now - above_since_ >= std::chrono::milliseconds(opt_.degrade_after_ms)) {
+                std::cerr << "[Adaptive] latency " << ewma_ << " ms > " << opt_.target_ms << " ms: "
+                    << ladder_[level].name << " -> " << ladder_[level + 1].name << "\n";
+                Degrade(level, now);
+            }
+            return;
+        }
+        above_since_ = {};
+
+        // well under the target: step up again once it lasted upgrade_after_ms
+        if (ewma_ < opt_.target_ms * opt_.upgrade_below) {
+            if (below_since_ == Clock::time_point{}) below_since_ = now;
+            if (dwelled && level > 0
+                && now - below_since_ >= std::chrono::milliseconds(upgrade_after_ms_[level - 1])) {
+                std::cerr << "[Adaptive] latency " << ewma_ << " ms, headroom: "
+                    << ladder_[level].name << " -> " << ladder_[level - 1].name;
+                if (degrade_latency_[level - 1] > 0.0) {
+                    std::cerr << " (left it at " << degrade_latency_[level - 1] << " ms)";
+                }
+                std::cerr << "\n";
+                ++upgrades_;
+                SwitchLocked(level - 1, now);
+                last_was_upgrade_ = true;
+            }
+            return;
+        }
+        below_since_ = {};  // in the band between the thresholds: stay
+    }
+
+    void ProfileController::Degrade(int level, Clock::time_point now) {
+        degrade_latency_[level] = ewma_;
+        if (last_was_upgrade_) {
+            // reverted within the window: the probe failed, wait longer before the next one
+            int& wait = upgrade_after_ms_[level];
+            wait = static_cast<int>(std::min<int64_t>(static_cast<int64_t>(wait) * 2,
+                std::max(opt_.max_upgrade_after_ms, opt_.upgrade_after_ms)));
+            ++failed_upgrades_;
+            std::cerr << "[Adaptive] upgrade to " << ladder_[level].name << " failed, next attempt after "
+                << wait << " ms of headroom\n";
+        }
+        ++degrades_;
+        SwitchLocked(level + 1, now);
+    }
+
+    void ProfileController::SetLevel(int level) {
+        std::lock_guard<std::mutex> lk(mu_);
+        SwitchLocked(std::clamp(level, 0, static_cast<int>(ladder_.size()) - 1), Clock::now());
+    }
+
+    void ProfileController::SwitchLocked(int level, Clock::time_point now) {
+        level_.store(level, std::memory_order_release);
+        switched_at_ = now;
+        last_was_upgrade_ = false;
+        above_since_ = {};
+        below_since_ = {};
+        ewma_ = -1.0;  // samples of the old profile say nothing about the new one
+        ProfileLevelGauge().Set(level);
+    }
+
+    ProfileController::Stats ProfileController::GetStats() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        Stats s;
+        s.level = level_.load(std::memory_order_relaxed);
+        s.latency_ms = std::max(0.0, ewma_);
+        s.degrades = degrades_;
+        s.upgrades = upgrades_;
+        s.failed_upgrades = failed_upgrades_;
+        s.upgrade_after_ms = s.level > 0 ? upgrade_after_ms_[s.level - 1] : 0;
+        s.degrade_latency_ms = s.level > 0 ? degrade_latency_[s.level - 1] : 0.0;
+        return s;
+    }
+
+    AdaptiveSource::AdaptiveSource(ProfileController& ctl, const video::FFmpegVideoSource::Options& opt)
+        : ctl_(ctl),
+        opt_(opt) { }
+
+    std::string AdaptiveSource::UrlOf(int level) const {
+        const std::string& url = ctl_.Profile(level).url;
+        return url.empty() ? base_url_ : url;
+    }
+
+    std::unique_ptr<video::FFmpegVideoSource> AdaptiveSource::Connect(int level) {
+        video::FFmpegVideoSource::Options o = opt_;
+        o.out_w = ctl_.Profile(level).input_w;
+        o.out_h = ctl_.Profile(level).input_h;
+        auto src = std::make_unique<video::FFmpegVideoSource>(o);
+        {
+            // registered before Open() so that Interrupt() can abort the connect
+            std::lock_guard<std::mutex> lk(live_mu_);
+            if (interrupted_) throw std::runtime_error("AdaptiveSource: interrupted.");
+            connecting_ = src.get();
+        }
+        try {
+            src->Open(UrlOf(level));
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lk(live_mu_);
+            connecting_ = nullptr;
+            throw;
+        }
+        std::lock_guard<std::mutex> lk(live_mu_);
+        connecting_ = nullptr;
+        return src;
+    }
+
+    void AdaptiveSource::Open(const std::string& url) {
+        Close();
+        base_url_ = url;
+        const int level = ctl_.Level();
+        auto src = Connect(level);
+        {
+            std::lock_guard<std::mutex> lk(live_mu_);
+            src_ = std::move(src);
+        }
+        open_level_ = level;
+    }
+
+    void AdaptiveSource::Apply(int level) {
+        const StreamProfile& p = ctl_.Profile(level);
+        if (UrlOf(level) == UrlOf(open_level_)) {
+            // same stream: only the scaler changes, frames already decoded keep their size
+            src_->SetOutputSize(p.input_w, p.input_h);
+            open_level_ = level;
+            return;
+        }
+
+        // make before break: the old stream keeps its connection until the new one is up
+        try {
+            auto next = Connect(level);
+            src_->Close();
+            {
+                std::lock_guard<std::mutex> lk(live_mu_);
+                src_ = std::move(next);
+            }
+            open_level_ = level;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[Adaptive] cannot switch to " << p.name << ": " << e.what() << "\n";
+            ctl_.SetLevel(open_level_);
+        }
+    }
+
+    bool AdaptiveSource::Read(video::Frame& out) {
+        if (!src_) return false;
+        const int level = ctl_.Level();
+        if (level != open_level_) Apply(level);
+        return src_->Read(out);
+    }
+
+    void AdaptiveSource::Close() {
+        if (src_) src_->Close();
+        {
+            std::lock_guard<std::mutex> lk(live_mu_);
+            src_.reset();
+        }
+        open_level_ = -1;
+    }
+
+    void AdaptiveSource::Interrupt() {
+        std::lock_guard<std::mutex> lk(live_mu_);
+        interrupted_ = true;  // a later Connect() fails right away
+        if (src_) src_->Interrupt();
+        if (connecting_) connecting_->Interrupt();
+    }
+
+} // namespace pipeline
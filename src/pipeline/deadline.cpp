@@ -0,0 +1,114 @@
+#include "pipeline/deadline.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "common/metrics.h"
+
+namespace pipeline {
+
+    static constexpr int64_t kDiscontinuityUs = 10 * 1000000;
+    static constexpr double kMaxDriftPpm = 200.0;  // cheap camera clocks stay well under this
+
+    static metrics::Counter& g_deadline_dropped = metrics::Dropped("deadline");
+
+    static metrics::Counter& DeadlineCounter(const char* result) {
+        return metrics::Registry::Global().GetCounter("cppinfer_deadline_frames_total",
+            std::string("result=\"") + result + "\"", "Frames whose result came out within / after the deadline");
+    }
+
+    static int64_t SteadyNowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void PtsClock::Observe(const video::Frame& f) {
+        if (f.src_width != src_w_ || f.src_height != src_h_) {
+            Reset();
+            src_w_ = f.src_width;
+            src_h_ = f.src_height;
+        }
+
+        // missing (0) or repeated pts: no capture time to learn from, and none to estimate
+        pts_known_ = !seen_ || f.pts_us > last_pts_us_;
+        seen_ = true;
+        last_pts_us_ = f.pts_us;
+        if (!pts_known_) return;
+
+        const int64_t wall_us = f.wall_us;
+        const int64_t offset = wall_us - f.pts_us;
+        if (has_ && std::abs(offset - last_offset_us_) > kDiscontinuityUs) has_ = false;
+
+        if (!has_) {
+            min_offset_us_ = static_cast<double>(offset);
+        }
+        else {
+            const double drift = std::max<int64_t>(0, wall_us - last_wall_us_) * kMaxDriftPpm * 1e-6;
+            min_offset_us_ = std::min(static_cast<double>(offset), min_offset_us_ + drift);
+        }
+        has_ = true;
+        last_offset_us_ = offset;
+        last_wall_us_ = wall_us;
+    }
+
+    int64_t PtsClock::CaptureUs(const video::Frame& f) const {
+        if (!has_ || !pts_known_) return f.wall_us;
+        return f.pts_us + static_cast<int64_t>(min_offset_us_);
+    }
+
+    void PtsClock::Reset() {
+        has_ = false;
+        seen_ = false;
+        pts_known_ = false;
+        min_offset_us_ = 0.0;
+    }
+
+    DeadlineGate::DeadlineGate()
+        : DeadlineGate(Options()) { }
+
+    DeadlineGate::DeadlineGate(const Options& opt)
+        : opt_(opt) { }
+
+    double DeadlineGate::AgeMsLocked(const video::Frame& f) const {
+        return (SteadyNowUs() - clock_.CaptureUs(f)) / 1000.0 + opt_.base_latency_ms;
+    }
+
+    bool DeadlineGate::Admit(const video::Frame& f) {
+        if (!Enabled()) return true;
+
+        std::lock_guard<std::mutex> lk(mu_);
+        clock_.Observe(f);
+        if (AgeMsLocked(f) > opt_.deadline_ms) {
+            ++stats_.dropped;
+            g_deadline_dropped.Add();
+            return false;
+        }
+        ++stats_.admitted;
+        return true;
+    }
+
+    void DeadlineGate::Done(const video::Frame& f) {
+        if (!Enabled()) return;
+        static metrics::Counter& on_time = DeadlineCounter("on_time");
+        static metrics::Counter& late = DeadlineCounter("late");
+
+        std::lock_guard<std::mutex> lk(mu_);
+        const double age = AgeMsLocked(f);
+        stats_.age_ms = stats_.age_ms == 0.0 ? age : 0.9 * stats_.age_ms + 0.1 * age;
+        if (age > opt_.deadline_ms) {
+            ++stats_.late;
+            late.Add();
+        }
+        else {
+            ++stats_.on_time;
+            on_time.Add();
+        }
+    }
+
+    DeadlineGate::Stats DeadlineGate::GetStats() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return stats_;
+    }
+
+} // namespace pipeline
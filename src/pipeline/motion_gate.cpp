@@ -0,0 +1,198 @@
+#include "pipeline/motion_gate.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "video/ffmpeg_video_source.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MG_HAVE_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define MG_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define MG_TARGET_SSE2 __attribute__((target("sse2,popcnt")))
+#else
+#define MG_TARGET_AVX2
+#define MG_TARGET_SSE2
+#endif
+#else
+#define MG_HAVE_X86 0
+#endif
+
+namespace pipeline {
+
+    // Number of i in [0, n) with |a[i] - b[i]| > t
+    static size_t CountChangedScalar(const uint8_t* a, const uint8_t* b, int n, uint8_t t) {
+        size_t c = 0;
+        for (int i = 0; i < n; ++i) {
+            const int d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+            c += d > t;
+        }
+        return c;
+    }
+
+#if MG_HAVE_X86
+    // |a - b| via two saturating subtractions; (|a - b| -sat t) != 0  <=>  |a - b| > t
+    MG_TARGET_SSE2
+    static size_t CountChangedSSE2(const uint8_t* a, const uint8_t* b, int n, uint8_t t) {
+        const __m128i vt = _mm_set1_epi8(static_cast<char>(t));
+        const __m128i zero = _mm_setzero_si128();
+        size_t c = 0;
+        int i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            const __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            const __m128i same = _mm_cmpeq_epi8(_mm_subs_epu8(d, vt), zero);
+            c += 16 - _mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_epi8(same)));
+        }
+        return c + CountChangedScalar(a + i, b + i, n - i, t);
+    }
+
+    MG_TARGET_AVX2
+    static size_t CountChangedAVX2(const uint8_t* a, const uint8_t* b, int n, uint8_t t) {
+        const __m256i vt = _mm256_set1_epi8(static_cast<char>(t));
+        const __m256i zero = _mm256_setzero_si256();
+        size_t c = 0;
+        int i = 0;
+        for (; i + 32 <= n; i += 32) {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            const __m256i d = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+            const __m256i same = _mm256_cmpeq_epi8(_mm256_subs_epu8(d, vt), zero);
+            c += 32 - _mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_epi8(same)));
+        }
+        return c + CountChangedScalar(a + i, b + i, n - i, t);
+    }
+#endif
+
+    using CountFn = size_t (*)(const uint8_t*, const uint8_t*, int, uint8_t);
+
+    static CountFn SelectCount() {
+#if MG_HAVE_X86
+        if (cv::checkHardwareSupport(CV_CPU_AVX2) && cv::checkHardwareSupport(CV_CPU_POPCNT)) return &CountChangedAVX2;
+        if (cv::checkHardwareSupport(CV_CPU_SSE2) && cv::checkHardwareSupport(CV_CPU_POPCNT)) return &CountChangedSSE2;
+#endif
+        return &CountChangedScalar;
+    }
+
+    MotionGate::MotionGate()
+        : MotionGate(Options()) { }
+
+    MotionGate::MotionGate(const Options& opt)
+        : opt_(opt) { }
+
+    void MotionGate::Thumbnail(const video::Frame& frame, int luma_w, cv::Mat& out) {
+        if (!frame.luma.empty()) {
+            out = frame.luma;
+            return;
+        }
+
+        // full-size single-channel view of the frame to shrink
+        cv::Mat gray;
+        if (frame.format == video::PixelFormat::BGR24) {
+            cv::cvtColor(frame.bgr, gray, cv::COLOR_BGR2GRAY);
+        }
+        else if (frame.format == video::PixelFormat::RGB_PLANAR) {
+            gray = frame.planes.rowRange(frame.height, 2 * frame.height);  // G: close enough to luma
+        }
+        else if (frame.format == video::PixelFormat::NV12) {
+            gray = frame.planes.rowRange(0, frame.height);                 // Y plane
+        }
+        else {
+            cv::Mat bgr;
+            if (!video::ToBGR(frame, bgr)) throw std::runtime_error("MotionGate: frame has no pixels.");
+            cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+        }
+
+        const int w = std::max(8, std::min(luma_w, gray.cols));
+        const int h = std::max(8, static_cast<int>(std::lround(static_cast<double>(gray.rows) * w / gray.cols)));
+        cv::resize(gray, out, cv::Size(w, h), 0, 0, cv::INTER_AREA);
+    }
+
+    void MotionGate::BuildSpans(int w, int h) {
+        spans_.clear();
+        watched_ = 0;
+        spans_size_ = cv::Size(w, h);
+
+        if (opt_.regions.empty()) {
+            for (int y = 0; y < h; ++y) spans_.push_back({ y, 0, w });
+            watched_ = static_cast<size_t>(w) * h;
+            return;
+        }
+
+        // union of the regions, row by row
+        cv::Mat mask = cv::Mat::zeros(h, w, CV_8UC1);
+        for (const cv::Rect2f& r : opt_.regions) {
+            cv::Rect px(cv::Point(static_cast<int>(std::floor(r.x * w)), static_cast<int>(std::floor(r.y * h))),
+                cv::Point(static_cast<int>(std::ceil((r.x + r.width) * w)), static_cast<int>(std::ceil((r.y + r.height) * h))));
+            px &= cv::Rect(0, 0, w, h);
+            if (px.area() > 0) mask(px).setTo(255);
+        }
+        for (int y = 0; y < h; ++y) {
+            const uint8_t* m = mask.ptr<uint8_t>(y);
+            for (int x = 0; x < w;) {
+                if (!m[x]) { ++x; continue; }
+                const int x0 = x;
+                while (x < w && m[x]) ++x;
+                spans_.push_back({ y, x0, x });
+                watched_ += static_cast<size_t>(x - x0);
+            }
+        }
+    }
+
+    bool MotionGate::Check(const video::Frame& frame) {
+        static const CountFn count_changed = SelectCount();
+
+        ++frames_;
+
+        // decoder thumbnail as is; otherwise our own buffer (never write into a shared luma)
+        const cv::Mat* cur = &frame.luma;
+        if (frame.luma.empty()) {
+            Thumbnail(frame, opt_.luma_w, cur_);
+            cur = &cur_;
+        }
+
+        bool infer = ref_.empty() || ref_.size() != cur->size()
+            || (opt_.refresh_interval > 0 && since_infer_ + 1 >= opt_.refresh_interval);
+
+        if (!infer) {
+            if (spans_size_ != cur->size()) BuildSpans(cur->cols, cur->rows);
+
+            const uint8_t t = static_cast<uint8_t>(std::clamp(opt_.pixel_thresh, 0, 255));
+            const size_t limit = static_cast<size_t>(opt_.changed_fraction * static_cast<double>(watched_));
+            size_t changed = 0;
+            for (const Span& s : spans_) {
+                changed += count_changed(cur->ptr<uint8_t>(s.y) + s.x0, ref_.ptr<uint8_t>(s.y) + s.x0, s.x1 - s.x0, t);
+                if (changed > limit) break;
+            }
+            infer = changed > limit;
+        }
+
+        if (infer) {
+            cur->copyTo(ref_);
+            since_infer_ = 0;
+            return true;
+        }
+
+        ++since_infer_;
+        ++skipped_;
+        saved_ms_ = saved_ms_.load() + avg_infer_ms_.load();
+        return false;
+    }
+
+    void MotionGate::OnInferred(double ms) {
+        const double avg = avg_infer_ms_.load();
+        avg_infer_ms_ = avg == 0.0 ? ms : 0.9 * avg + 0.1 * ms;
+    }
+
+    MotionGate::Stats MotionGate::GetStats() const {
+        Stats s;
+        s.frames = frames_.load();
+        s.skipped = skipped_.load();
+        s.skip_ratio = s.frames ? static_cast<double>(s.skipped) / static_cast<double>(s.frames) : 0.0;
+        s.saved_ms = saved_ms_.load();
+        return s;
+    }
+
+} // namespace pipeline
@@ -0,0 +1,261 @@
+#include "pipeline/offline_runner.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace pipeline {
+
+    using Clock = std::chrono::steady_clock;
+
+    OfflineRunner::OfflineRunner(std::vector<InferEngine*> engines, ResultFn on_result)
+        : OfflineRunner(std::move(engines), std::move(on_result), Options()) { }
+
+    OfflineRunner::OfflineRunner(std::vector<InferEngine*> engines, ResultFn on_result, const Options& opt)
+        : engines_(std::move(engines)),
+        on_result_(std::move(on_result)),
+        opt_(opt) {
+        if (engines_.empty()) {
+            throw std::runtime_error("OfflineRunner needs at least one InferEngine.");
+        }
+        for (size_t i = 0; i < engines_.size(); ++i) {
+            // RunBound results live in the engine: one worker per persistent-IO engine
+            if (engines_[i]->PersistentIO()
+                && std::count(engines_.begin(), engines_.end(), engines_[i]) > 1) {
+                throw std::runtime_error("OfflineRunner: a persistent_io engine may only be passed once.");
+            }
+        }
+    }
+
+    OfflineRunner::Stats OfflineRunner::Run(const std::string& path) {
+        return RunInput(path, nullptr, 0);
+    }
+
+    OfflineRunner::Stats OfflineRunner::RunMemory(const uint8_t* data, size_t size) {
+        if (!data || size == 0) throw std::runtime_error("OfflineRunner::RunMemory: empty buffer.");
+        return RunInput("", data, size);
+    }
+
+    std::vector<OfflineRunner::Segment> OfflineRunner::Segments(const std::vector<int64_t>& keyframes,
+        int64_t end_us, double segment_s) {
+        const int64_t min_len = std::max<int64_t>(1, static_cast<int64_t>(segment_s * 1000000.0));
+
+        std::vector<Segment> out;
+        Segment cur;  // the first segment starts at the beginning of the file
+        int64_t cur_start = keyframes.empty() ? 0 : keyframes.front();
+        for (int64_t k : keyframes) {
+            if (k - cur_start < min_len) continue;
+            if (end_us > 0 && k >= end_us) break;
+            cur.end_us = k;
+            out.push_back(cur);
+            cur.start_us = k;
+            cur_start = k;
+        }
+        cur.end_us = 0;  // the last one runs to the end
+        out.push_back(cur);
+        return out;
+    }
+
+    void OfflineRunner::OpenSource(video::FFmpegVideoSource& src, const std::string& path,
+        const uint8_t* data, size_t size) const {
+        if (data) src.OpenMemory(data, size);
+        else src.Open(path);
+    }
+
+    OfflineRunner::Stats OfflineRunner::RunInput(const std::string& path, const uint8_t* data, size_t size) {
+        const auto t0 = Clock::now();
+
+        // 1) keyframe scan: demux only, cheap next to decoding
+        int64_t end_us = 0;
+        std::vector<int64_t> keys;
+        {
+            video::FFmpegVideoSource::Options o = opt_.source;
+            o.async = false;
+            o.start_us = 0;
+            o.end_us = 0;
+            video::FFmpegVideoSource probe(o);
+            OpenSource(probe, path, data, size);
+            keys = probe.ScanKeyframes(&end_us);
+        }
+
+        // 2) per-run state
+        segments_ = Segments(keys, end_us, opt_.segment_s);
+        next_segment_ = 0;
+        stop_ = false;
+        pending_.clear();
+        seg_frames_.assign(segments_.size(), -1);
+        emit_seg_ = 0;
+        emit_idx_ = 0;
+        emitted_ = 0;
+
+        QueueOptions qo;
+        qo.depth = opt_.queue_depth;
+        qo.drop = DropPolicy::Block;  // archive: never lose a frame
+        queue_ = std::make_unique<BoundedQueue<Item>>(qo);
+
+        int decoders = opt_.decode_workers;
+        if (decoders <= 0) decoders = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+        decoders = std::min(decoders, static_cast<int>(segments_.size()));
+
+        // 3) decode workers -> queue -> inference workers -> reorder
+        std::vector<std::thread> decode_threads;
+        std::vector<std::thread> workers;
+        for (int i = 0; i < decoders; ++i) {
+            decode_threads.emplace_back([this, &path, data, size] { DecodeLoop(path, data, size); });
+        }
+        for (InferEngine* e : engines_) {
+            workers.emplace_back([this, e] { WorkerLoop(*e); });
+        }
+
+        for (auto& t : decode_threads) t.join();
+        queue_->Close();  // workers drain what is left, then return
+        for (auto& t : workers) t.join();
+
+        Stats st;
+        st.frames = emitted_;
+        st.segments = static_cast<int>(segments_.size());
+        st.media_s = std::max<int64_t>(0, end_us - (keys.empty() ? 0 : keys.front())) / 1e6;
+        st.wall_s = std::chrono::duration<double>(Clock::now() - t0).count();
+        if (st.wall_s > 0.0) {
+            st.fps = st.frames / st.wall_s;
+            st.speed = st.media_s / st.wall_s;
+        }
+
+        pending_.clear();
+        queue_.reset();
+        return st;
+    }
+
+    void OfflineRunner::DecodeLoop(const std::string& path, const uint8_t* data, size_t size) {
+        while (!stop_) {
+            const int s = next_segment_++;
+            if (s >= static_cast<int>(segments_.size())) break;
+
+            video::FFmpegVideoSource::Options o = opt_.source;
+            o.async = false;  // every frame, in order
+            o.start_us = segments_[s].start_us;
+            o.end_us = segments_[s].end_us;
+            if (o.decode_threads == 0) o.decode_threads = 1;
+
+            uint64_t n = 0;
+            try {
+                video::FFmpegVideoSource src(o);
+                OpenSource(src, path, data, size);
+
+                video::Frame f;
+                while (!stop_ && src.Read(f)) {
+                    Item it;
+                    it.seg = s;
+                    it.idx = n;
+                    it.frame = std::move(f);
+                    if (!queue_->Push(std::move(it))) break;
+                    ++n;
+                    f = video::Frame();
+                }
+            }
+            catch (const std::exception& e) {
+                // the segment ends early; its frames so far still come out
+                std::cerr << "[Offline] segment " << s << ": " << e.what() << "\n";
+            }
+
+            std::lock_guard<std::mutex> lk(emit_mu_);
+            seg_frames_[s] = static_cast<int64_t>(n);
+            EmitLocked();  // this may have been the last frame the reorder was waiting for
+        }
+    }
+
+    void OfflineRunner::WorkerLoop(InferEngine& engine) {
+        Item it;
+        while (queue_->Pop(it)) {
+            if (stop_) continue;  // drain
+
+            try {
+                InferResult owned;
+                const InferResult* result = &owned;
+                if (it.frame.format == video::PixelFormat::RGB_PLANAR) {
+                    // decoder already scaled + letterboxed to the model input
+                    if (engine.PersistentIO()) {
+                        result = &engine.RunBoundPlanarRGB(it.frame.planes, it.frame.lb, it.frame.src_width, it.frame.src_height);
+                    }
+                    else {
+                        thread_local InferEngine::PreparedInput in;
+                        engine.PreprocessPlanarRGB(it.frame.planes, it.frame.lb, it.frame.src_width, it.frame.src_height, in);
+                        owned = engine.RunPrepared(in);
+                    }
+                }
+                else if (it.frame.format == video::PixelFormat::NV12) {
+                    if (engine.PersistentIO()) {
+                        result = &engine.RunBoundNV12(it.frame.planes, it.frame.lb, it.frame.src_width, it.frame.src_height);
+                    }
+                    else {
+                        thread_local InferEngine::PreparedInput in;
+                        engine.PreprocessNV12(it.frame.planes, it.frame.lb, it.frame.src_width, it.frame.src_height, in);
+                        owned = engine.RunPrepared(in);
+                    }
+                }
+                else if (engine.PersistentIO()) {
+                    result = &engine.RunBound(it.frame.bgr);
+                }
+                else {
+                    owned = engine.Run(it.frame.bgr);
+                }
+                it.dets = PostprocessRTDETR(
+                    result->outputs[0],
+                    engine.InputW(), engine.InputH(),
+                    result->lb,
+                    result->orig_w, result->orig_h,
+                    opt_.pp
+                );
+            }
+            catch (const std::exception& e) {
+                // reported without boxes, so the frames after it are not held up
+                std::cerr << "[Offline] inference failed: " << e.what() << "\n";
+                it.dets.clear();
+            }
+
+            if (!opt_.keep_frames) {
+                // back to the decoder's pool now instead of after the reorder
+                it.frame.bgr.release();
+                it.frame.planes.release();
+                it.frame.luma.release();
+                it.frame.source.reset();
+            }
+
+            std::lock_guard<std::mutex> lk(emit_mu_);
+            if (stop_) continue;
+            const auto key = std::make_pair(it.seg, it.idx);
+            pending_.emplace(key, std::move(it));
+            EmitLocked();
+        }
+    }
+
+    void OfflineRunner::EmitLocked() {
+        while (!stop_ && emit_seg_ < static_cast<int>(segments_.size())) {
+            auto it = pending_.begin();
+            if (it != pending_.end() && it->first == std::make_pair(emit_seg_, emit_idx_)) {
+                const bool go = !on_result_ || on_result_(it->second.frame, it->second.dets);
+                pending_.erase(it);
+                ++emitted_;
+                ++emit_idx_;
+                if (!go) {
+                    // stop early: decoders see the flag or a closed queue, workers drain it
+                    stop_ = true;
+                    queue_->Close();
+                    pending_.clear();  // lets decoders waiting for a pool buffer go on
+                }
+                continue;
+            }
+
+            // the current segment is complete: continue with the next one
+            const int64_t frames = seg_frames_[emit_seg_];
+            if (frames >= 0 && emit_idx_ >= static_cast<uint64_t>(frames)) {
+                ++emit_seg_;
+                emit_idx_ = 0;
+                continue;
+            }
+            break;
+        }
+    }
+
+} // namespace pipeline
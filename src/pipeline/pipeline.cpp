@@ -0,0 +1,304 @@
+#include "pipeline/pipeline.h"
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "common/metrics.h"
+#include "video/ffmpeg_video_source.h"
+
+namespace pipeline {
+
+    static std::atomic<int> g_pipeline_ids{ 0 };
+
+    Pipeline::Pipeline(video::IVideoSource& src, InferEngine& engine, RenderFn render)
+        : Pipeline(src, engine, std::move(render), Options()) { }
+
+    Pipeline::Pipeline(video::IVideoSource& src, InferEngine& engine, RenderFn render, const Options& opt)
+        : src_(src),
+        engine_(engine),
+        render_(std::move(render)),
+        opt_(opt),
+        gate_(opt.motion),
+        deadline_(opt.deadline),
+        tracker_(opt.tracker),
+        decoded_q_(opt.decode_queue),
+        prepared_q_(opt.preprocess_queue),
+        inferred_q_(opt.infer_queue),
+        detected_q_(opt.postprocess_queue) {
+        if (opt_.tiled) {
+            TiledInfer::Options t = opt_.tiles;
+            t.pp = opt_.pp;  // one set of thresholds for both modes
+            tiler_ = std::make_unique<TiledInfer>(engine_, t);
+        }
+
+        // one set per pipeline: several streams in a process must not overwrite each other's
+        const std::string name = opt_.name.empty() ? std::to_string(g_pipeline_ids++) : opt_.name;
+        const char* queues[4] = { "decoded", "prepared", "inferred", "detected" };
+        for (int i = 0; i < 4; ++i) {
+            const std::string labels = "pipeline=\"" + name + "\",queue=\"" + queues[i] + "\"";
+            gauges_[i].depth = &metrics::Registry::Global().GetGauge("cppinfer_queue_depth", labels,
+                "Frames waiting in a pipeline queue");
+            gauges_[i].dropped = &metrics::Registry::Global().GetGauge("cppinfer_queue_dropped_frames", labels,
+                "Frames dropped by a pipeline queue since the pipeline started");
+        }
+    }
+
+    Pipeline::~Pipeline() {
+        Stop();
+        for (auto& t : threads_) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    void Pipeline::Start() {
+        if (!threads_.empty()) {
+            throw std::runtime_error("Pipeline already started.");
+        }
+        stop_ = false;
+        started_ = std::chrono::steady_clock::now();
+        first_result_ms_ = -1.0;
+
+        threads_.emplace_back(&Pipeline::Guard, this, &Pipeline::DecodeLoop);
+        threads_.emplace_back(&Pipeline::Guard, this, &Pipeline::PreprocessLoop);
+        threads_.emplace_back(&Pipeline::Guard, this, &Pipeline::InferLoop);
+        threads_.emplace_back(&Pipeline::Guard, this, &Pipeline::PostprocessLoop);
+        threads_.emplace_back(&Pipeline::Guard, this, &Pipeline::RenderLoop);
+    }
+
+    void Pipeline::Stop() {
+        stop_ = true;
+        CloseQueues();
+    }
+
+    void Pipeline::Wait() {
+        for (auto& t : threads_) {
+            if (t.joinable()) t.join();
+        }
+        threads_.clear();
+
+        std::lock_guard<std::mutex> lk(err_mu_);
+        if (error_) {
+            std::exception_ptr e = error_;
+            error_ = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    Pipeline::Stats Pipeline::GetStats() const {
+        Stats s;
+        s.decoded = decoded_.load();
+        s.rendered = rendered_.load();
+        s.first_result_ms = first_result_ms_.load();
+        s.motion = gate_.GetStats();
+        s.deadline = deadline_.GetStats();
+        s.dropped = decoded_q_.Dropped() + prepared_q_.Dropped()
+            + inferred_q_.Dropped() + detected_q_.Dropped();
+        return s;
+    }
+
+    void Pipeline::Guard(void (Pipeline::*body)()) {
+        try {
+            (this->*body)();
+        }
+        catch (...) {
+            {
+                std::lock_guard<std::mutex> lk(err_mu_);
+                if (!error_) error_ = std::current_exception();
+            }
+            Stop();
+        }
+    }
+
+    void Pipeline::CloseQueues() {
+        decoded_q_.Close();
+        prepared_q_.Close();
+        inferred_q_.Close();
+        detected_q_.Close();
+    }
+
+    void Pipeline::PublishQueueGauges() const {
+        const BoundedQueue<FramePacket>* q[4] = { &decoded_q_, &prepared_q_, &inferred_q_, &detected_q_ };
+        for (int i = 0; i < 4; ++i) {
+            gauges_[i].depth->Set(static_cast<double>(q[i]->Size()));
+            gauges_[i].dropped->Set(static_cast<double>(q[i]->Dropped()));
+        }
+    }
+
+    InferEngine& Pipeline::EngineFor(const video::Frame& f) const {
+        int w = f.width, h = f.height;
+        if (f.format == video::PixelFormat::BGR24) {
+            if (!opt_.adaptive) return engine_;
+            const StreamProfile& p = opt_.adaptive->Profile(opt_.adaptive->Level());
+            w = p.input_w;
+            h = p.input_h;
+        }
+        if (engine_.InputW() == w && engine_.InputH() == h) return engine_;
+        for (InferEngine* e : opt_.engines) {
+            if (e->InputW() == w && e->InputH() == h) return *e;
+        }
+        return engine_;  // no match: the default engine reports the size mismatch
+    }
+
+    void Pipeline::DecodeLoop() {
+        uint64_t seq = 0;
+        while (!stop_) {
+            FramePacket pkt;
+            if (!src_.Read(pkt.frame)) {
+                std::cerr << "[Video] Read failed / EOF / disconnected.\n";
+                break;
+            }
+
+            pkt.seq = seq++;
+            ++decoded_;
+
+            if (!decoded_q_.Push(std::move(pkt))) break;
+        }
+        decoded_q_.Close();
+    }
+
+    void Pipeline::PreprocessLoop() {
+        FramePacket pkt;
+        while (decoded_q_.Pop(pkt)) {
+            // too old already: its result would be a late alert
+            if (!deadline_.Admit(pkt.frame)) continue;
+
+            const video::Frame& f = pkt.frame;
+            const bool skip = (opt_.infer_every > 1 && pkt.seq % static_cast<uint64_t>(opt_.infer_every) != 0)
+                || (opt_.motion_gate && !gate_.Check(f));
+            if (skip) {
+                pkt.gated = true;
+                if (!prepared_q_.Push(std::move(pkt))) break;
+                continue;
+            }
+
+            pkt.engine = &EngineFor(f);
+            if (tiler_) {
+                // tiles are cut from the full-res image (RGB_PLANAR: Frame::source)
+                if (!video::ToBGR(f, pkt.full_bgr)) {
+                    throw std::runtime_error("Pipeline: tiled mode needs a BGR24 frame or Frame::source.");
+                }
+            }
+            else if (f.format == video::PixelFormat::RGB_PLANAR) {
+                // already scaled + letterboxed by the decoder
+                pkt.engine->PreprocessPlanarRGB(f.planes, f.lb, f.src_width, f.src_height, pkt.input);
+            }
+            else if (f.format == video::PixelFormat::NV12) {
+                pkt.engine->PreprocessNV12(f.planes, f.lb, f.src_width, f.src_height, pkt.input);
+            }
+            else if (f.format == video::PixelFormat::BGR24) {
+                pkt.engine->Preprocess(f.bgr, pkt.input);
+            }
+            else {
+                throw std::runtime_error("Pipeline: unsupported frame format (use BGR24, RGB_PLANAR or NV12).");
+            }
+            if (!prepared_q_.Push(std::move(pkt))) break;
+        }
+        prepared_q_.Close();
+    }
+
+    void Pipeline::InferLoop() {
+        FramePacket pkt;
+        while (prepared_q_.Pop(pkt)) {
+            if (pkt.gated) {
+                if (!inferred_q_.Push(std::move(pkt))) break;
+                continue;
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+
+            if (tiler_) {
+                tiler_->Run(pkt.full_bgr, pkt.dets);
+                pkt.full_bgr.release();
+            }
+            else {
+                pkt.result = pkt.engine->RunPrepared(pkt.input);
+                pkt.input = {}; // the tensor data is no longer needed downstream
+            }
+
+            auto t1 = std::chrono::steady_clock::now();
+            pkt.infer_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+            if (!inferred_q_.Push(std::move(pkt))) break;
+        }
+        inferred_q_.Close();
+    }
+
+    void Pipeline::PostprocessLoop() {
+        static metrics::Histogram& track_time = metrics::Stage("track");
+
+        FramePacket pkt;
+        std::vector<Det> last_dets;
+        while (inferred_q_.Pop(pkt)) {
+            if (pkt.gated) {
+                if (opt_.track) {
+                    metrics::ScopedTimer timer(track_time);
+                    tracker_.Predict(pkt.frame.pts_us, pkt.dets);
+                }
+                else {
+                    pkt.dets = last_dets;
+                }
+                if (!detected_q_.Push(std::move(pkt))) break;
+                continue;
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+
+            if (!tiler_) {  // tiled: dets come from the infer stage
+                pkt.dets = PostprocessRTDETR(
+                    pkt.result.outputs[0],
+                    pkt.engine->InputW(), pkt.engine->InputH(),
+                    pkt.result.lb,
+                    pkt.result.orig_w, pkt.result.orig_h,
+                    opt_.pp
+                );
+                pkt.result.outputs.clear();
+            }
+
+            auto t1 = std::chrono::steady_clock::now();
+            pkt.infer_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+            if (opt_.motion_gate) gate_.OnInferred(pkt.infer_ms);
+
+            if (opt_.track) {
+                metrics::ScopedTimer timer(track_time);
+                const std::vector<Det> raw = std::move(pkt.dets);
+                tracker_.Update(raw, pkt.frame.pts_us, pkt.dets);
+            }
+            else {
+                last_dets = pkt.dets;
+            }
+
+            if (!detected_q_.Push(std::move(pkt))) break;
+        }
+        detected_q_.Close();
+    }
+
+    void Pipeline::RenderLoop() {
+        static metrics::Histogram& render_time = metrics::Stage("render");
+
+        FramePacket pkt;
+        while (detected_q_.Pop(pkt)) {
+            PublishQueueGauges();
+
+            if (rendered_++ == 0) {
+                // time to first detection, the startup cost a user actually waits for
+                const double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - started_).count();
+                first_result_ms_ = ms;
+                std::cout << "[Pipeline] first result after " << ms << " ms\n";
+            }
+            // gated frames skipped the model: their latency says nothing about the profile's cost
+            if (opt_.adaptive && !pkt.gated) opt_.adaptive->Observe(pkt.frame);
+            deadline_.Done(pkt.frame);
+
+            auto t0 = metrics::Clock::now();
+            const bool go_on = render_(pkt);
+            render_time.RecordSince(t0);
+            if (!go_on) {
+                Stop();
+                break;
+            }
+        }
+    }
+
+} // namespace pipeline
@@ -0,0 +1,330 @@
+#include "pipeline/stream_manager.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include "common/metrics.h"
+
+namespace pipeline {
+
+    static metrics::Counter& g_stream_dropped = metrics::Dropped("stream");
+
+    StreamManager::StreamManager(std::vector<InferEngine*> engines, ResultFn on_result)
+        : StreamManager(std::move(engines), std::move(on_result), Options()) { }
+
+    StreamManager::StreamManager(std::vector<InferEngine*> engines, ResultFn on_result, const Options& opt)
+        : engines_(std::move(engines)),
+        on_result_(std::move(on_result)),
+        opt_(opt) {
+        if (engines_.empty()) {
+            throw std::runtime_error("StreamManager needs at least one InferEngine.");
+        }
+        for (size_t i = 0; i < engines_.size(); ++i) {
+            // RunBound results live in the engine: one worker per persistent-IO engine
+            if (engines_[i]->PersistentIO()
+                && std::count(engines_.begin(), engines_.end(), engines_[i]) > 1) {
+                throw std::runtime_error("StreamManager: a persistent_io engine may only be passed once.");
+            }
+        }
+    }
+
+    StreamManager::~StreamManager() {
+        Stop();
+    }
+
+    int StreamManager::AddStream(std::unique_ptr<video::IVideoSource> src, const StreamConfig& cfg) {
+        if (started_) {
+            throw std::runtime_error("StreamManager::AddStream must be called before Start.");
+        }
+        if (!src) {
+            throw std::runtime_error("StreamManager::AddStream: null source.");
+        }
+
+        auto s = std::make_unique<Stream>();
+        s->id = static_cast<int>(streams_.size());
+        s->cfg = cfg;
+        s->cfg.priority = std::max(1, cfg.priority);
+        s->src = std::move(src);
+        if (cfg.motion_gate) s->gate = std::make_unique<MotionGate>(cfg.motion);
+        s->deadline = std::make_unique<DeadlineGate>(cfg.deadline);
+        if (cfg.track) s->tracker = std::make_unique<Tracker>(cfg.tracker);
+        streams_.push_back(std::move(s));
+        return streams_.back()->id;
+    }
+
+    void StreamManager::Start() {
+        if (started_) return;
+        started_ = true;
+        stop_ = false;
+        start_time_ = Clock::now();
+
+        for (auto& s : streams_) {
+            Stream* sp = s.get();
+            s->decode_thread = std::thread([this, sp] { DecodeLoop(*sp); });
+        }
+        for (InferEngine* e : engines_) {
+            workers_.emplace_back([this, e] { WorkerLoop(*e); });
+        }
+    }
+
+    void StreamManager::Stop() {
+        stop_ = true;
+        {
+            // taking the lock orders the flag with waiters that already checked it
+            std::lock_guard<std::mutex> lk(mu_);
+        }
+        cv_.notify_all();
+        stop_cv_.notify_all();
+        // decode threads waiting in Open() / Read() (a camera that does not answer) return now;
+        // each one closes its own source
+        for (auto& s : streams_) s->src->Interrupt();
+
+        for (auto& t : workers_) {
+            if (t.joinable()) t.join();
+        }
+        workers_.clear();
+
+        for (auto& s : streams_) {
+            if (s->decode_thread.joinable()) s->decode_thread.join();
+        }
+    }
+
+    std::vector<StreamStats> StreamManager::GetStats() const {
+        std::vector<StreamStats> out;
+        out.reserve(streams_.size());
+
+        std::lock_guard<std::mutex> lk(mu_);
+        for (const auto& s : streams_) {
+            StreamStats st;
+            st.id = s->id;
+            st.url = s->cfg.url;
+            st.decoded = s->decoded.load();
+            st.inferred = s->inferred.load();
+            st.dropped = s->dropped.load();
+            st.reconnects = s->reconnects.load();
+            st.infer_fps = s->infer_fps;
+            st.first_result_ms = s->first_result_ms;
+            if (s->gate) st.motion = s->gate->GetStats();
+            st.deadline = s->deadline->GetStats();
+            st.connected = s->connected.load();
+            st.finished = s->finished.load();
+            out.push_back(st);
+        }
+        return out;
+    }
+
+    bool StreamManager::IsLive(const std::string& url) {
+        const size_t scheme = url.find("://");
+        return scheme != std::string::npos && url.compare(0, scheme, "file") != 0;
+    }
+
+    void StreamManager::DecodeLoop(Stream& s) {
+        const bool live = IsLive(s.cfg.url);
+        while (!stop_) {
+            try {
+                s.src->Open(s.cfg.url);
+                s.connected = true;
+
+                video::Frame f;
+                while (!stop_ && s.src->Read(f)) {
+                    ++s.decoded;
+
+                    {
+                        std::lock_guard<std::mutex> lk(mu_);
+                        if (s.has_frame) {
+                            // the scheduler never got to the previous one
+                            ++s.dropped;
+                            g_stream_dropped.Add();
+                        }
+                        s.latest = std::move(f);
+                        s.has_frame = true;
+                    }
+                    cv_.notify_one();
+                    f = video::Frame();
+                }
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[Stream " << s.id << "] " << e.what() << "\n";
+            }
+
+            s.connected = false;
+            s.src->Close();
+
+            if (stop_ || opt_.reconnect_delay_ms < 0) break;
+            if (!live) {
+                // end of the file (or a file that cannot be read): nothing to reconnect to
+                s.finished = true;
+                std::cerr << "[Stream " << s.id << "] end of input\n";
+                break;
+            }
+
+            std::cerr << "[Stream " << s.id << "] disconnected, reconnecting in "
+                << opt_.reconnect_delay_ms << " ms\n";
+            ++s.reconnects;
+
+            std::unique_lock<std::mutex> lk(mu_);
+            stop_cv_.wait_for(lk, std::chrono::milliseconds(opt_.reconnect_delay_ms),
+                [&] { return stop_.load(); });
+        }
+    }
+
+    StreamManager::Stream* StreamManager::PickLocked(Clock::time_point now, Clock::time_point& next_wakeup) {
+        Stream* best = nullptr;
+        double best_start = 0.0;
+
+        for (auto& sp : streams_) {
+            Stream& s = *sp;
+            if (!s.has_frame || s.busy) continue;
+
+            if (now < s.next_allowed) {
+                // FPS cap: come back when this stream may run again
+                next_wakeup = std::min(next_wakeup, s.next_allowed);
+                continue;
+            }
+
+            // an idle stream starts at the current virtual clock, so it gets no burst credit
+            const double start = std::max(s.vtime, vclock_);
+            const bool better = !best
+                || (s.cfg.critical != best->cfg.critical ? s.cfg.critical
+                    : start < best_start || (start == best_start && s.cfg.priority > best->cfg.priority));
+            if (better) {
+                best = &s;
+                best_start = start;
+            }
+        }
+
+        if (best) {
+            vclock_ = best_start;
+            best->vtime = best_start + 1.0 / best->cfg.priority;
+            if (best->cfg.max_fps > 0.0) {
+                best->next_allowed = now + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(1.0 / best->cfg.max_fps));
+            }
+        }
+        return best;
+    }
+
+    void StreamManager::WorkerLoop(InferEngine& engine) {
+        while (true) {
+            Stream* s = nullptr;
+            video::Frame frame;
+
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                while (true) {
+                    if (stop_) return;
+
+                    Clock::time_point wake = Clock::time_point::max();
+                    s = PickLocked(Clock::now(), wake);
+                    if (s) break;
+
+                    if (wake == Clock::time_point::max()) cv_.wait(lk);
+                    else cv_.wait_until(lk, wake);
+                }
+
+                frame = std::move(s->latest);
+                s->has_frame = false;
+                s->busy = true; // keeps the frames of one stream in order
+            }
+
+            // too old already (the workers were busy): drop it instead of raising a late alert
+            if (!s->deadline->Admit(frame)) {
+                {
+                    std::lock_guard<std::mutex> lk(mu_);
+                    s->busy = false;
+                }
+                cv_.notify_all();
+                continue;
+            }
+
+            // nothing changed since the last inference of this stream: report its result again
+            // (or the tracker's prediction)
+            const bool gated = s->gate && !s->gate->Check(frame);
+
+            bool ok = false;
+            try {
+                std::vector<Det> dets;
+                if (gated) {
+                    if (s->tracker) s->tracker->Predict(frame.pts_us, dets);
+                    else dets = s->last_dets;
+                }
+                else {
+                    auto t0 = Clock::now();
+                    InferResult owned;
+                    const InferResult* result = &owned;
+                    if (frame.format == video::PixelFormat::RGB_PLANAR) {
+                        // decoder already scaled + letterboxed to the model input
+                        if (engine.PersistentIO()) {
+                            result = &engine.RunBoundPlanarRGB(frame.planes, frame.lb, frame.src_width, frame.src_height);
+                        }
+                        else {
+                            thread_local InferEngine::PreparedInput in;
+                            engine.PreprocessPlanarRGB(frame.planes, frame.lb, frame.src_width, frame.src_height, in);
+                            owned = engine.RunPrepared(in);
+                        }
+                    }
+                    else if (frame.format == video::PixelFormat::NV12) {
+                        if (engine.PersistentIO()) {
+                            result = &engine.RunBoundNV12(frame.planes, frame.lb, frame.src_width, frame.src_height);
+                        }
+                        else {
+                            thread_local InferEngine::PreparedInput in;
+                            engine.PreprocessNV12(frame.planes, frame.lb, frame.src_width, frame.src_height, in);
+                            owned = engine.RunPrepared(in);
+                        }
+                    }
+                    else if (engine.PersistentIO()) {
+                        // this worker owns the engine and is done with the result before its next run
+                        result = &engine.RunBound(frame.bgr);
+                    }
+                    else {
+                        owned = engine.Run(frame.bgr);
+                    }
+                    auto raw = PostprocessRTDETR(
+                        result->outputs[0],
+                        engine.InputW(), engine.InputH(),
+                        result->lb,
+                        result->orig_w, result->orig_h,
+                        opt_.pp
+                    );
+                    if (s->gate) s->gate->OnInferred(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+
+                    if (s->tracker) s->tracker->Update(raw, frame.pts_us, dets);
+                    else dets = std::move(raw);
+                    if (s->gate && !s->tracker) s->last_dets = dets;
+                }
+                if (on_result_) on_result_(s->id, frame, dets);
+                s->deadline->Done(frame);
+                ok = true;
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[Stream " << s->id << "] inference failed: " << e.what() << "\n";
+            }
+
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                s->busy = false;
+                if (ok && !gated) ++s->inferred;  // failed runs are not inferences
+
+                auto now = Clock::now();
+                if (ok && s->first_result_ms < 0.0) {
+                    s->first_result_ms = std::chrono::duration<double, std::milli>(now - start_time_).count();
+                    std::cout << "[Stream " << s->id << "] first result after " << s->first_result_ms << " ms\n";
+                }
+                if (ok && !gated) {  // infer_fps counts successful inferences only
+                    if (s->last_infer != Clock::time_point{}) {
+                        double dt = std::chrono::duration<double>(now - s->last_infer).count();
+                        if (dt > 0.0) {
+                            const double inst = 1.0 / dt;
+                            s->infer_fps = s->infer_fps == 0.0 ? inst : 0.9 * s->infer_fps + 0.1 * inst;
+                        }
+                    }
+                    s->last_infer = now;
+                }
+            }
+            cv_.notify_all(); // the stream may have a new frame waiting
+        }
+    }
+
+} // namespace pipeline
@@ -0,0 +1,478 @@
+// Micro-benchmarks of the per-frame hot path, on synthetic input:
+//   - preprocess: LetterboxBGR + BGRToCHWFloat01_RGB (reference), LetterboxToCHWFloat01_RGB
+//     (fused), PlanarU8ToCHWFloat01 (decoder-scaled frames)
+//   - PostprocessRTDETR on a random [1,Q,4+C] logit tensor
+//   - Tracker::Update with N moving objects
+//   - DetLogWriter::Append, N detections per frame
+//   - InferEngine::Run / RunAsync (only with --model=<file.onnx>)
+//   - FFmpegVideoSource::Read on a generated H.264 file, several decoder configurations
+//
+//   cppinfer_bench [--model=<file.onnx>] [--video_dir=<dir>] [google benchmark flags]
+//
+// JSON for comparing commits: --benchmark_out=<file>.json --benchmark_out_format=json, then
+// compare two runs with tools/compare.py from the Google Benchmark sources.
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <onnxruntime_cxx_api.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+}
+
+#include "common/det_log.h"
+#include "common/tracker.h"
+#include "infer/InferEngine.h"
+#include "infer/letterbox_chw.h"
+#include "infer/postprocess_rtdetr.h"
+#include "video/ffmpeg_video_source.h"
+
+namespace fs = std::filesystem;
+
+static std::string g_model;
+static fs::path g_video_dir = fs::temp_directory_path();
+
+static constexpr int kInputW = 640;
+static constexpr int kInputH = 640;
+
+// Source resolutions (height; width is 16:9) used by the per-frame benchmarks
+static void SourceSizes(benchmark::internal::Benchmark* b) {
+    b->ArgName("h");
+    for (int h : { 480, 720, 1080, 2160 }) b->Arg(h);
+}
+
+// Noise + gradient, so neither the resize nor the encoder sees flat input
+static cv::Mat SyntheticBGR(int w, int h) {
+    cv::Mat img(h, w, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    for (int y = 0; y < h; ++y) {
+        auto* row = img.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < w; ++x) row[x][1] = static_cast<uint8_t>((x + y) & 255);
+    }
+    return img;
+}
+
+// ---------------- preprocess ----------------
+
+static void BM_LetterboxReference(benchmark::State& state) {
+    const int h = static_cast<int>(state.range(0));
+    const cv::Mat src = SyntheticBGR(h * 16 / 9, h);
+    std::vector<float> chw;
+    LetterBoxInfo lb;
+    for (auto _ : state) {
+        cv::Mat boxed = LetterboxBGR(src, kInputW, kInputH, lb);
+        BGRToCHWFloat01_RGB(boxed, chw);
+        benchmark::DoNotOptimize(chw.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LetterboxReference)->Apply(SourceSizes)->Unit(benchmark::kMicrosecond);
+
+static void BM_LetterboxFused(benchmark::State& state) {
+    const int h = static_cast<int>(state.range(0));
+    const cv::Mat src = SyntheticBGR(h * 16 / 9, h);
+    std::vector<float> chw(3 * kInputW * kInputH);
+    LetterBoxInfo lb;
+    for (auto _ : state) {
+        LetterboxToCHWFloat01_RGB(src, kInputW, kInputH, chw.data(), lb);
+        benchmark::DoNotOptimize(chw.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LetterboxFused)->Apply(SourceSizes)->Unit(benchmark::kMicrosecond);
+
+static void BM_PlanarU8ToCHWFloat01(benchmark::State& state) {
+    cv::Mat planes(3 * kInputH, kInputW, CV_8UC1);
+    cv::randu(planes, cv::Scalar::all(0), cv::Scalar::all(255));
+    std::vector<float> chw(3 * kInputW * kInputH);
+    for (auto _ : state) {
+        PlanarU8ToCHWFloat01(planes, chw.data());
+        benchmark::DoNotOptimize(chw.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PlanarU8ToCHWFloat01)->Unit(benchmark::kMicrosecond);
+
+// ---------------- postprocess ----------------
+
+// [1, Q, 4 + C]: normalized cxcywh and class logits, about 1% of the queries above 0.5
+static void BM_PostprocessRTDETR(benchmark::State& state) {
+    const int queries = static_cast<int>(state.range(0));
+    const int classes = static_cast<int>(state.range(1));
+    const int dim = 4 + classes;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> box(0.05f, 0.95f);
+    std::normal_distribution<float> logit(-6.0f, 2.0f);
+
+    std::vector<float> data(static_cast<size_t>(queries) * dim);
+    for (int q = 0; q < queries; ++q) {
+        float* row = data.data() + static_cast<size_t>(q) * dim;
+        row[0] = box(rng); row[1] = box(rng);
+        row[2] = box(rng) * 0.3f; row[3] = box(rng) * 0.3f;
+        for (int c = 0; c < classes; ++c) row[4 + c] = logit(rng);
+        if (q % 100 == 0) row[4 + q % classes] = 2.0f;
+    }
+
+    const std::array<int64_t, 3> shape{ 1, queries, dim };
+    Ort::MemoryInfo mem = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    Ort::Value out0 = Ort::Value::CreateTensor<float>(mem, data.data(), data.size(), shape.data(), shape.size());
+
+    LetterBoxInfo lb;
+    lb.scale = kInputW / 1920.0f;
+    lb.pad_y = (kInputH - static_cast<int>(1080 * lb.scale)) / 2;
+    lb.dst_w = kInputW;
+    lb.dst_h = kInputH;
+
+    PostprocessOptions pp;
+    pp.score_thresh = 0.5f;
+    std::vector<Det> dets;
+    for (auto _ : state) {
+        PostprocessRTDETR(out0, kInputW, kInputH, lb, 1920, 1080, pp, dets);
+        benchmark::DoNotOptimize(dets.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PostprocessRTDETR)
+    ->ArgNames({ "queries", "classes" })
+    ->Args({ 300, 80 })
+    ->Args({ 1200, 80 })
+    ->Args({ 4800, 80 })
+    ->Args({ 300, 365 })
+    ->Unit(benchmark::kMicrosecond);
+
+// ---------------- tracker ----------------
+
+// N objects on a 1080p frame moving at constant speed, jittered detections every frame
+static void BM_TrackerUpdate(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::normal_distribution<float> jitter(0.0f, 1.5f);
+
+    struct Obj { float x, y, vx, vy, w, h; };
+    std::vector<Obj> objs(n);
+    for (Obj& o : objs) {
+        o = { u(rng) * 1800.0f, u(rng) * 950.0f, (u(rng) - 0.5f) * 100.0f, (u(rng) - 0.5f) * 100.0f,
+            20.0f + u(rng) * 60.0f, 40.0f + u(rng) * 90.0f };
+    }
+
+    // a few hundred frames of detections, replayed with increasing timestamps
+    constexpr int kFrames = 256;
+    std::vector<std::vector<Det>> frames(kFrames);
+    for (int f = 0; f < kFrames; ++f) {
+        const float t = f * 0.04f;
+        for (const Obj& o : objs) {
+            const float x = o.x + o.vx * t, y = o.y + o.vy * t;
+            frames[f].push_back({ x + jitter(rng), y + jitter(rng), x + o.w + jitter(rng), y + o.h + jitter(rng), 0, 0.8f });
+        }
+    }
+
+    Tracker tracker;
+    std::vector<Det> out;
+    int64_t t_us = 0;
+    int f = 0;
+    for (auto _ : state) {
+        if (f == kFrames) {  // objects jump back: start over
+            state.PauseTiming();
+            tracker.Reset();
+            f = 0;
+            state.ResumeTiming();
+        }
+        tracker.Update(frames[f++], t_us, out);
+        t_us += 40000;
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrackerUpdate)->ArgName("objects")->Arg(10)->Arg(100)->Arg(300)->Unit(benchmark::kMicrosecond);
+
+// ---------------- detection log ----------------
+
+// Cost on the calling thread; encoding and writing happen on the log's own thread
+static void BM_DetLogAppend(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    std::mt19937 rng(42);
+    std::vector<Det> dets(n);
+    for (Det& d : dets) {
+        const float x = static_cast<float>(rng() % 1800), y = static_cast<float>(rng() % 1000);
+        d = { x, y, x + 40.0f, y + 90.0f, static_cast<int>(rng() % 80), 0.8f, static_cast<int>(rng() % 1000) };
+    }
+
+    const fs::path path = fs::temp_directory_path() / "cppinfer_bench_detlog.bin";
+    std::error_code ec;
+    fs::remove(path, ec);
+    {
+        DetLogWriter log(path.string());
+        int64_t pts = 0;
+        for (auto _ : state) {
+            log.Append(0, pts, dets);
+            pts += 40000;
+        }
+        state.SetItemsProcessed(state.iterations() * n);
+        log.Flush();
+        if (log.Rows() > 0) state.counters["bytes_per_det"] = static_cast<double>(log.BytesWritten()) / log.Rows();
+    }
+    fs::remove(path, ec);
+}
+BENCHMARK(BM_DetLogAppend)->ArgName("dets")->Arg(10)->Arg(100)->Unit(benchmark::kNanosecond);
+
+// ---------------- inference ----------------
+
+// Shared by the inference benchmarks; loaded on first use
+static InferEngine* BenchEngine() {
+    static std::unique_ptr<InferEngine> engine;
+    if (!engine) {
+        InferEngine::Options opt;
+        opt.input_w = kInputW;
+        opt.input_h = kInputH;
+        opt.warmup_runs = 3;
+        engine = std::make_unique<InferEngine>(opt);
+        engine->LoadModel(fs::path(g_model).native());
+    }
+    return engine.get();
+}
+
+static void BM_InferEngineRun(benchmark::State& state) {
+    if (g_model.empty()) {
+        state.SkipWithError("no --model given");
+        return;
+    }
+    InferEngine* engine = BenchEngine();
+
+    const int h = static_cast<int>(state.range(0));
+    const cv::Mat src = SyntheticBGR(h * 16 / 9, h);
+    for (auto _ : state) {
+        InferResult r = engine->Run(src);
+        benchmark::DoNotOptimize(r.outputs.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InferEngineRun)->Apply(SourceSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Same frames through RunAsync with up to max_in_flight requests queued: the letterbox of the
+// next frame overlaps the session call of the current one (compare items/s with the above)
+static void BM_InferEngineRunAsync(benchmark::State& state) {
+    if (g_model.empty()) {
+        state.SkipWithError("no --model given");
+        return;
+    }
+    InferEngine* engine = BenchEngine();
+
+    const int h = static_cast<int>(state.range(0));
+    const cv::Mat src = SyntheticBGR(h * 16 / 9, h);
+    std::deque<std::future<InferResult>> in_flight;
+    for (auto _ : state) {
+        in_flight.push_back(engine->RunAsync(src));
+        if (in_flight.size() >= 2) {
+            InferResult r = in_flight.front().get();
+            in_flight.pop_front();
+            benchmark::DoNotOptimize(r.outputs.data());
+        }
+    }
+    while (!in_flight.empty()) {
+        in_flight.front().get();
+        in_flight.pop_front();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InferEngineRunAsync)->Apply(SourceSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// ---------------- decode ----------------
+
+// Encodes `frames` synthetic frames to <video_dir>/cppinfer_bench_<w>x<h>.mp4 (GOP 30, B-frames
+// when the encoder supports them). Generated once and reused by later runs.
+static std::string TestVideo(int w, int h) {
+    const fs::path path = g_video_dir / ("cppinfer_bench_" + std::to_string(w) + "x" + std::to_string(h) + ".mp4");
+    if (fs::exists(path)) return path.string();
+
+    const std::string part = path.string() + ".part";
+    const int frames = 150;
+
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    if (!codec) throw std::runtime_error("This FFmpeg build has no H.264 encoder.");
+
+    AVFormatContext* fmt = nullptr;
+    if (avformat_alloc_output_context2(&fmt, nullptr, "mp4", part.c_str()) < 0 || !fmt) {
+        throw std::runtime_error("avformat_alloc_output_context2 failed.");
+    }
+    AVStream* st = avformat_new_stream(fmt, nullptr);
+    AVCodecContext* enc = avcodec_alloc_context3(codec);
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+
+    auto cleanup = [&] {
+        av_packet_free(&pkt);
+        av_frame_free(&frame);
+        avcodec_free_context(&enc);
+        if (fmt && fmt->pb) avio_closep(&fmt->pb);
+        avformat_free_context(fmt);
+    };
+
+    try {
+        enc->width = w;
+        enc->height = h;
+        enc->pix_fmt = AV_PIX_FMT_YUV420P;
+        enc->time_base = AVRational{ 1, 30 };
+        enc->framerate = AVRational{ 30, 1 };
+        enc->gop_size = 30;
+        enc->max_b_frames = 2;
+        enc->bit_rate = static_cast<int64_t>(w) * h * 4;  // ~8 Mbit/s at 1080p
+        if (fmt->oformat->flags & AVFMT_GLOBALHEADER) enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        if (avcodec_open2(enc, codec, nullptr) < 0) throw std::runtime_error("avcodec_open2 (H.264 encoder) failed.");
+        if (avcodec_parameters_from_context(st->codecpar, enc) < 0) throw std::runtime_error("avcodec_parameters_from_context failed.");
+        st->time_base = enc->time_base;
+
+        if (avio_open(&fmt->pb, part.c_str(), AVIO_FLAG_WRITE) < 0) throw std::runtime_error("Cannot write " + part);
+        if (avformat_write_header(fmt, nullptr) < 0) throw std::runtime_error("avformat_write_header failed.");
+
+        frame->format = enc->pix_fmt;
+        frame->width = w;
+        frame->height = h;
+        if (av_frame_get_buffer(frame, 0) < 0) throw std::runtime_error("av_frame_get_buffer failed.");
+
+        auto encode = [&](AVFrame* in) {
+            if (avcodec_send_frame(enc, in) < 0) throw std::runtime_error("avcodec_send_frame failed.");
+            while (avcodec_receive_packet(enc, pkt) == 0) {
+                av_packet_rescale_ts(pkt, enc->time_base, st->time_base);
+                pkt->stream_index = st->index;
+                if (av_interleaved_write_frame(fmt, pkt) < 0) throw std::runtime_error("av_interleaved_write_frame failed.");
+            }
+        };
+
+        // moving gradient with some noise: motion and texture the decoder has to work for
+        std::mt19937 rng(7);
+        for (int i = 0; i < frames; ++i) {
+            if (av_frame_make_writable(frame) < 0) throw std::runtime_error("av_frame_make_writable failed.");
+            for (int y = 0; y < h; ++y) {
+                uint8_t* row = frame->data[0] + static_cast<size_t>(y) * frame->linesize[0];
+                for (int x = 0; x < w; ++x) row[x] = static_cast<uint8_t>(((x + 4 * i) ^ y) + (rng() & 15));
+            }
+            for (int p = 1; p <= 2; ++p) {
+                for (int y = 0; y < h / 2; ++y) {
+                    uint8_t* row = frame->data[p] + static_cast<size_t>(y) * frame->linesize[p];
+                    for (int x = 0; x < w / 2; ++x) row[x] = static_cast<uint8_t>(128 + ((x + y * p + 2 * i) & 63) - 32);
+                }
+            }
+            frame->pts = i;
+            encode(frame);
+        }
+        encode(nullptr);
+
+        if (av_write_trailer(fmt) < 0) throw std::runtime_error("av_write_trailer failed.");
+    }
+    catch (...) {
+        cleanup();
+        std::error_code ec;
+        fs::remove(part, ec);
+        throw;
+    }
+    cleanup();
+
+    fs::rename(part, path);
+    return path.string();
+}
+
+// Args: source height, decode_threads (0 = auto), SkipFrames, output (0 = BGR24 full size,
+// 1 = RGB_PLANAR at model size), ScaleFilter
+static void BM_FFmpegRead(benchmark::State& state) {
+    const int h = static_cast<int>(state.range(0));
+    std::string path;
+    try {
+        path = TestVideo(h * 16 / 9, h);
+    }
+    catch (const std::exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    video::FFmpegVideoSource::Options opt;
+    opt.decode_threads = static_cast<int>(state.range(1));
+    opt.skip_frames = static_cast<video::FFmpegVideoSource::SkipFrames>(state.range(2));
+    if (state.range(3) == 1) {
+        opt.out_format = video::PixelFormat::RGB_PLANAR;
+        opt.out_w = kInputW;
+        opt.out_h = kInputH;
+        opt.keep_source_frame = false;
+    }
+    opt.scale_filter = static_cast<video::FFmpegVideoSource::ScaleFilter>(state.range(4));
+
+    auto src = std::make_unique<video::FFmpegVideoSource>(opt);
+    src->Open(path);
+
+    video::Frame frame;
+    for (auto _ : state) {
+        if (!src->Read(frame)) {
+            // end of file: start over outside the timed region
+            state.PauseTiming();
+            src = std::make_unique<video::FFmpegVideoSource>(opt);
+            src->Open(path);
+            state.ResumeTiming();
+            if (!src->Read(frame)) {
+                state.SkipWithError("no frames decoded");
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(frame.width);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void DecodeConfigs(benchmark::internal::Benchmark* b) {
+    using SF = video::FFmpegVideoSource::SkipFrames;
+    using FL = video::FFmpegVideoSource::ScaleFilter;
+    b->ArgNames({ "h", "threads", "skip", "planar", "filter" });
+    for (int h : { 720, 1080 }) {
+        for (int threads : { 1, 0 }) {
+            b->Args({ h, threads, static_cast<int>(SF::None), 0, static_cast<int>(FL::Bilinear) });
+            b->Args({ h, threads, static_cast<int>(SF::None), 1, static_cast<int>(FL::Bilinear) });
+        }
+        b->Args({ h, 0, static_cast<int>(SF::NonRef), 1, static_cast<int>(FL::Bilinear) });
+        b->Args({ h, 0, static_cast<int>(SF::None), 1, static_cast<int>(FL::FastBilinear) });
+        b->Args({ h, 0, static_cast<int>(SF::None), 1, static_cast<int>(FL::Area) });
+    }
+}
+BENCHMARK(BM_FFmpegRead)->Apply(DecodeConfigs)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a.rfind("--model=", 0) == 0) {
+            g_model = a.substr(8);
+        }
+        else if (a.rfind("--video_dir=", 0) == 0) {
+            g_video_dir = a.substr(12);
+        }
+        else {
+            std::cerr << "[INPUT ERROR] unknown argument: " << a << "\n";
+            return 1;
+        }
+    }
+
+    // recorded in the JSON "context" block, so results from different builds can be told apart;
+    // git_commit comes from --benchmark_context=git_commit=<hash> (the bench target passes it)
+    benchmark::AddCustomContext("onnxruntime", Ort::GetVersionString());
+    benchmark::AddCustomContext("opencv", CV_VERSION);
+    benchmark::AddCustomContext("ffmpeg", av_version_info());
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,224 @@
+// Compares a reduced-precision RT-DETR model (FP16 / INT8) against the FP32 reference on a
+// local image set: per-image latency of both engines and how well the detections agree.
+//
+//   precision_compare <fp32.onnx> <candidate.onnx> <image_dir> [fp16|int8] [score_thresh]
+//
+// Agreement treats the FP32 detections as ground truth:
+//   - AP50 per class (all-point interpolation), averaged over the classes FP32 found -> mAP50
+//   - mean IoU of the matched boxes, and recall/precision at IoU 0.5
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <onnxruntime_cxx_api.h>
+
+#include "infer/InferEngine.h"
+#include "infer/postprocess_rtdetr.h"
+
+namespace fs = std::filesystem;
+
+enum class ExitCode : int {
+    Ok = 0,
+    InputError = 1,
+    OrtError = 2,
+    RuntimeError = 3
+};
+
+struct InputError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+static float IoU(const Det& a, const Det& b) {
+    const float ix = std::max(0.0f, std::min(a.x2, b.x2) - std::max(a.x1, b.x1));
+    const float iy = std::max(0.0f, std::min(a.y2, b.y2) - std::max(a.y1, b.y1));
+    const float inter = ix * iy;
+    const float uni = (a.x2 - a.x1) * (a.y2 - a.y1) + (b.x2 - b.x1) * (b.y2 - b.y1) - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+// One candidate detection after matching against the reference of its image
+struct Scored {
+    float score;
+    bool tp;
+};
+
+struct ClassStats {
+    std::vector<Scored> preds;
+    int num_ref = 0;
+};
+
+// Greedy matching (highest score first) of one image, same class, IoU >= 0.5
+static void MatchImage(const std::vector<Det>& ref, std::vector<Det> cand,
+    std::map<int, ClassStats>& per_class, double& iou_sum, int& matched) {
+    for (const Det& r : ref) per_class[r.class_id].num_ref++;
+
+    std::sort(cand.begin(), cand.end(), [](const Det& a, const Det& b) { return a.score > b.score; });
+    std::vector<bool> used(ref.size(), false);
+
+    for (const Det& c : cand) {
+        int best = -1;
+        float best_iou = 0.5f;
+        for (size_t i = 0; i < ref.size(); ++i) {
+            if (used[i] || ref[i].class_id != c.class_id) continue;
+            const float v = IoU(ref[i], c);
+            if (v >= best_iou) { best_iou = v; best = static_cast<int>(i); }
+        }
+        if (best >= 0) {
+            used[best] = true;
+            iou_sum += best_iou;
+            ++matched;
+        }
+        per_class[c.class_id].preds.push_back({ c.score, best >= 0 });
+    }
+}
+
+static double AveragePrecision(ClassStats& cs) {
+    if (cs.num_ref == 0) return 0.0;
+    std::sort(cs.preds.begin(), cs.preds.end(), [](const Scored& a, const Scored& b) { return a.score > b.score; });
+
+    std::vector<double> prec, rec;
+    int tp = 0, fp = 0;
+    for (const Scored& p : cs.preds) {
+        p.tp ? ++tp : ++fp;
+        prec.push_back(static_cast<double>(tp) / (tp + fp));
+        rec.push_back(static_cast<double>(tp) / cs.num_ref);
+    }
+
+    // precision envelope, then area under the step curve
+    for (int i = static_cast<int>(prec.size()) - 2; i >= 0; --i) prec[i] = std::max(prec[i], prec[i + 1]);
+    double ap = 0.0, last_rec = 0.0;
+    for (size_t i = 0; i < prec.size(); ++i) {
+        ap += (rec[i] - last_rec) * prec[i];
+        last_rec = rec[i];
+    }
+    return ap;
+}
+
+static double Percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    const size_t idx = std::min(v.size() - 1, static_cast<size_t>(p * (v.size() - 1) + 0.5));
+    return v[idx];
+}
+
+int main(int argc, char** argv) {
+    try {
+        if (argc < 4) {
+            throw InputError("usage: precision_compare <fp32.onnx> <candidate.onnx> <image_dir> [fp16|int8] [score_thresh]");
+        }
+        const fs::path ref_model = argv[1];
+        const fs::path cand_model = argv[2];
+        const fs::path image_dir = argv[3];
+        const std::string mode = argc > 4 ? argv[4] : "int8";
+        if (mode != "fp16" && mode != "int8") {
+            throw InputError("Unknown mode '" + mode + "' (expected fp16 or int8)");
+        }
+
+        PostprocessOptions pp;
+        pp.score_thresh = argc > 5 ? std::stof(argv[5]) : 0.5f;
+
+        std::vector<fs::path> images;
+        for (const auto& e : fs::directory_iterator(image_dir)) {
+            std::string ext = e.path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp") images.push_back(e.path());
+        }
+        std::sort(images.begin(), images.end());
+        if (images.empty()) {
+            throw InputError("No images found in " + image_dir.string());
+        }
+
+        InferEngine::Options ref_opt;
+        InferEngine::Options cand_opt;
+        cand_opt.precision = mode == "fp16" ? InferEngine::Precision::FP16 : InferEngine::Precision::INT8;
+
+        InferEngine ref(ref_opt);
+        ref.LoadModel(ref_model.native());
+        InferEngine cand(cand_opt);
+        cand.LoadModel(cand_model.native());
+        cand.PrintModelInfo();
+
+        auto detect = [&](InferEngine& e, const cv::Mat& bgr, double& ms) {
+            auto t0 = std::chrono::steady_clock::now();
+            auto r = e.Run(bgr);
+            auto dets = PostprocessRTDETR(r.outputs[0], e.InputW(), e.InputH(), r.lb, r.orig_w, r.orig_h, pp);
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            return dets;
+        };
+
+        // warm up both sessions on the first readable image (first runs pay for allocations / kernel selection)
+        cv::Mat warm;
+        for (const auto& p : images) {
+            warm = cv::imread(p.string(), cv::IMREAD_COLOR);
+            if (!warm.empty()) break;
+            std::cerr << "skip (unreadable): " << p.string() << "\n";
+        }
+        if (warm.empty()) {
+            throw InputError("No readable images in " + image_dir.string());
+        }
+        double dummy = 0.0;
+        for (int i = 0; i < 3; ++i) { detect(ref, warm, dummy); detect(cand, warm, dummy); }
+
+        std::vector<double> ref_ms, cand_ms;
+        std::map<int, ClassStats> per_class;
+        double iou_sum = 0.0;
+        int matched = 0, num_ref = 0, num_cand = 0;
+
+        for (const auto& p : images) {
+            cv::Mat bgr = cv::imread(p.string(), cv::IMREAD_COLOR);
+            if (bgr.empty()) {
+                std::cerr << "skip (unreadable): " << p.string() << "\n";
+                continue;
+            }
+
+            double t_ref = 0.0, t_cand = 0.0;
+            auto d_ref = detect(ref, bgr, t_ref);
+            auto d_cand = detect(cand, bgr, t_cand);
+            ref_ms.push_back(t_ref);
+            cand_ms.push_back(t_cand);
+            num_ref += static_cast<int>(d_ref.size());
+            num_cand += static_cast<int>(d_cand.size());
+
+            MatchImage(d_ref, d_cand, per_class, iou_sum, matched);
+        }
+
+        double ap_sum = 0.0;
+        int ap_classes = 0;
+        for (auto& kv : per_class) {
+            if (kv.second.num_ref == 0) continue;
+            ap_sum += AveragePrecision(kv.second);
+            ++ap_classes;
+        }
+
+        std::cout << std::fixed << std::setprecision(2)
+            << "images:            " << ref_ms.size() << "\n"
+            << "fp32 latency (ms): p50=" << Percentile(ref_ms, 0.5) << " p90=" << Percentile(ref_ms, 0.9) << "\n"
+            << mode << " latency (ms): p50=" << Percentile(cand_ms, 0.5) << " p90=" << Percentile(cand_ms, 0.9) << "\n"
+            << std::setprecision(4)
+            << "mAP50 vs fp32:     " << (ap_classes ? ap_sum / ap_classes : 0.0) << "\n"
+            << "mean IoU matched:  " << (matched ? iou_sum / matched : 0.0) << "\n"
+            << "recall@0.5:        " << (num_ref ? static_cast<double>(matched) / num_ref : 0.0) << "\n"
+            << "precision@0.5:     " << (num_cand ? static_cast<double>(matched) / num_cand : 0.0) << "\n";
+
+        return static_cast<int>(ExitCode::Ok);
+    }
+    catch (const Ort::Exception& e) {
+        std::cerr << "[ORT ERROR] " << e.what() << "\n";
+        return static_cast<int>(ExitCode::OrtError);
+    }
+    catch (const InputError& e) {
+        std::cerr << "[INPUT ERROR] " << e.what() << "\n";
+        return static_cast<int>(ExitCode::InputError);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << "\n";
+        return static_cast<int>(ExitCode::RuntimeError);
+    }
+}
@@ -0,0 +1,211 @@
+// Two-process throughput / latency check of the shared-memory frame ring (video/shm_ring.h).
+//
+//   shm_bench [seconds] [fps] [reader_delay_us]   fork a reader, publish synthetic 640x640
+//                                                 RGB_PLANAR frames + 50 boxes (fps 0 = flat out)
+//   shm_bench read <name>                         attach to a running publisher, e.g.
+//                                                 CppInferDemo --shm=<name>, print stats per second
+//
+// Latency is publish -> reader, on the system-wide steady clock. reader_delay_us makes the reader
+// slow on purpose: the producer's Write() time must not change, the reader just loses frames.
+// Every frame carries its number in its first pixels, so a torn read would be reported.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "video/shm_ring.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+enum class ExitCode : int {
+    Ok = 0,
+    InputError = 1,
+    RuntimeError = 3
+};
+
+struct InputError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+static int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static double Percentile(std::vector<double> v, double q) {
+    if (v.empty()) return 0.0;
+    const size_t k = std::min(v.size() - 1, static_cast<size_t>(q * v.size()));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+struct ReadStats {
+    uint64_t frames = 0;
+    uint64_t torn = 0;
+    uint64_t bytes = 0;
+    std::vector<double> latency_us;
+};
+
+// Reads until the producer closes (or `seconds` pass, 0 = no limit)
+static ReadStats ReadLoop(video::ShmReader& reader, int delay_us, bool check_stamp, double seconds, bool live) {
+    ReadStats st;
+    video::ShmReader::View v;
+    const auto t0 = Clock::now();
+    auto last_print = t0;
+    uint64_t last_frames = 0;
+
+    for (;;) {
+        if (!reader.Next(v)) {
+            if (reader.Closed()) break;
+            if (seconds > 0 && std::chrono::duration<double>(Clock::now() - t0).count() > seconds) break;
+            std::this_thread::yield();
+            continue;
+        }
+        st.latency_us.push_back(static_cast<double>(NowUs() - v.publish_us));
+
+        // touch the pixels in place, then confirm they were not overwritten meanwhile
+        uint64_t stamp = 0;
+        if (!v.image.empty()) {
+            std::memcpy(&stamp, v.image.data, sizeof(stamp));
+            st.bytes += v.image.total() * v.image.elemSize();
+        }
+        if (delay_us > 0) std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+        if (reader.Valid(v)) {
+            if (check_stamp && stamp != v.frame_no) ++st.torn;
+        }
+        ++st.frames;
+
+        if (live && Clock::now() - last_print >= std::chrono::seconds(1)) {
+            std::cout << "frame " << v.frame_no << "  " << (st.frames - last_frames) << " fps  "
+                << v.dets.size() << " dets  latency " << st.latency_us.back() << " us  lost " << reader.Lost() << "\n";
+            last_frames = st.frames;
+            last_print = Clock::now();
+        }
+    }
+    return st;
+}
+
+static void PrintReadStats(const ReadStats& st, const video::ShmReader& reader, double seconds) {
+    std::cout << "[reader] frames=" << st.frames << " lost=" << reader.Lost() << " torn=" << st.torn
+        << "  " << st.frames / seconds << " fps, " << st.bytes / seconds / 1e9 << " GB/s\n"
+        << "[reader] latency us: p50=" << Percentile(st.latency_us, 0.5)
+        << " p99=" << Percentile(st.latency_us, 0.99)
+        << " max=" << Percentile(st.latency_us, 1.0) << "\n";
+}
+
+static int RunAttach(const std::string& name) {
+    video::ShmReader reader(name);
+    const auto t0 = Clock::now();
+    const ReadStats st = ReadLoop(reader, 0, false, 0.0, true);
+    PrintReadStats(st, reader, std::chrono::duration<double>(Clock::now() - t0).count());
+    return static_cast<int>(ExitCode::Ok);
+}
+
+static int RunBench(double seconds, int fps, int delay_us) {
+#ifdef _WIN32
+    (void)seconds; (void)fps; (void)delay_us;
+    throw InputError("The two-process benchmark needs fork(); on Windows run `shm_bench read <name>` "
+        "against CppInferDemo --shm=<name>.");
+#else
+    const std::string name = "cppinfer_shm_bench_" + std::to_string(getpid());
+    video::ShmPublisher pub(name);
+
+    const pid_t child = fork();
+    if (child < 0) throw std::runtime_error("fork failed.");
+    if (child == 0) {
+        try {
+            video::ShmReader reader(name);
+            const auto t0 = Clock::now();
+            const ReadStats st = ReadLoop(reader, delay_us, true, 0.0, false);
+            PrintReadStats(st, reader, std::chrono::duration<double>(Clock::now() - t0).count());
+            std::cout.flush();
+            _exit(st.torn == 0 ? 0 : 1);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[reader] " << e.what() << "\n";
+            _exit(2);
+        }
+    }
+
+    // let the reader attach
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    video::Frame f;
+    f.format = video::PixelFormat::RGB_PLANAR;
+    f.width = 640;
+    f.height = 640;
+    f.src_width = 1920;
+    f.src_height = 1080;
+    f.lb.scale = 640.f / 1920.f;
+    f.lb.pad_y = (640 - 360) / 2;
+    f.planes = cv::Mat(3 * 640, 640, CV_8UC1, cv::Scalar(0));
+
+    std::vector<Det> dets(50);
+    for (size_t i = 0; i < dets.size(); ++i) {
+        const float x = 30.f * i;
+        dets[i] = Det{ x, 100.f, x + 25.f, 180.f, static_cast<int>(i % 3), 0.9f, static_cast<int>(i) };
+    }
+
+    std::vector<double> write_us;
+    const auto t0 = Clock::now();
+    const auto period = fps > 0 ? std::chrono::microseconds(1000000 / fps) : std::chrono::microseconds(0);
+    auto next = t0;
+    for (uint64_t n = 0; std::chrono::duration<double>(Clock::now() - t0).count() < seconds; ++n) {
+        std::memcpy(f.planes.data, &n, sizeof(n));
+        f.pts_us = static_cast<int64_t>(n) * 40000;
+        f.wall_us = NowUs();
+
+        const auto w0 = Clock::now();
+        pub.Write(f, dets, "");
+        write_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - w0).count());
+
+        if (fps > 0) {
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+    pub.Close();
+
+    std::cout << "[writer] frames=" << pub.Published() << "  " << pub.Published() / elapsed << " fps"
+        << "  Write() us: p50=" << Percentile(write_us, 0.5) << " p99=" << Percentile(write_us, 0.99)
+        << " max=" << Percentile(write_us, 1.0) << "\n";
+    std::cout.flush();
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) throw std::runtime_error("reader failed (torn frames or error).");
+    return static_cast<int>(ExitCode::Ok);
+#endif
+}
+
+int main(int argc, char** argv) {
+    try {
+        if (argc >= 2 && std::string(argv[1]) == "read") {
+            if (argc < 3) throw InputError("usage: shm_bench read <name>");
+            return RunAttach(argv[2]);
+        }
+        const double seconds = argc > 1 ? std::stod(argv[1]) : 5.0;
+        const int fps = argc > 2 ? std::stoi(argv[2]) : 0;
+        const int delay_us = argc > 3 ? std::stoi(argv[3]) : 0;
+        return RunBench(seconds, fps, delay_us);
+    }
+    catch (const InputError& e) {
+        std::cerr << "[INPUT ERROR] " << e.what() << "\n";
+        return static_cast<int>(ExitCode::InputError);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << "\n";
+        return static_cast<int>(ExitCode::RuntimeError);
+    }
+}
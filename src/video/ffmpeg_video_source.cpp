@@ -1,17 +1,33 @@
 #include "video/ffmpeg_video_source.h"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
 #include <libswscale/swscale.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libavutil/time.h>
 }
 
+#include "common/metrics.h"
+
 namespace video {
 
+    static metrics::Histogram& g_decode_time = metrics::Stage("decode");
+    static metrics::Histogram& g_sws_time = metrics::Stage("sws");
+    static metrics::Counter& g_dropped = metrics::Dropped("decoder");
+
+    static uint64_t NsSince(metrics::Clock::time_point t0) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(metrics::Clock::now() - t0).count());
+    }
+
     static int64_t ToUs(int64_t pts, AVRational time_base) {
         if (pts == AV_NOPTS_VALUE) return 0;
         // pts * time_base => seconds
@@ -19,7 +35,35 @@ namespace video {
         return static_cast<int64_t>(sec * 1000000.0);
     }
 
-    FFmpegVideoSource::FFmpegVideoSource() {
+    // Fills everything of a w x h byte plane outside the content rect [x, x+cw) x [y, y+ch)
+    static void FillBorder(uint8_t* plane, int stride, int w, int h,
+        int x, int y, int cw, int ch, uint8_t v) {
+        for (int r = 0; r < h; ++r) {
+            uint8_t* row = plane + static_cast<size_t>(r) * stride;
+            if (r < y || r >= y + ch) {
+                std::fill(row, row + w, v);
+            }
+            else {
+                std::fill(row, row + x, v);
+                std::fill(row + x + cw, row + w, v);
+            }
+        }
+    }
+
+    static int64_t SteadyNowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    FFmpegVideoSource::FFmpegVideoSource()
+        : FFmpegVideoSource(Options()) { }
+
+    FFmpegVideoSource::FFmpegVideoSource(const Options& opt)
+        : opt_(opt),
+        pool_(opt.pool_size) {
+        if (opt_.ring_size < 1) opt_.ring_size = 1;
+        SetOutputSize(opt_.out_w, opt_.out_h);
+
         // ° FFmpeg ͨҪʽ av_register_all()
         /*ʼ socket / 
         ע RTSP / RTP / HTTP / TCP / UDP Э
@@ -36,14 +80,82 @@ namespace video {
 
     void FFmpegVideoSource::Open(const std::string& url) {
         Close();
+        OpenInput(url);
+    }
+
+    void FFmpegVideoSource::OpenMemory(const uint8_t* data, size_t size) {
+        Close();
+
+        mem_ = std::make_unique<MemoryInput>();
+        mem_->data = data;
+        mem_->size = size;
+
+        const int buf_size = 64 * 1024;
+        auto* buf = static_cast<unsigned char*>(av_malloc(buf_size));
+        if (!buf) throw std::runtime_error("FFmpeg: av_malloc failed.");
+        avio_ = avio_alloc_context(buf, buf_size, 0, mem_.get(), &FFmpegVideoSource::ReadMemory, nullptr,
+            &FFmpegVideoSource::SeekMemory);
+        if (!avio_) {
+            av_free(buf);
+            throw std::runtime_error("FFmpeg: avio_alloc_context failed.");
+        }
+
+        OpenInput("");
+    }
 
-        // 1) 루RTSP
+    int FFmpegVideoSource::ReadMemory(void* opaque, uint8_t* buf, int size) {
+        auto* m = static_cast<MemoryInput*>(opaque);
+        const size_t n = std::min(static_cast<size_t>(std::max(size, 0)), m->size - m->pos);
+        if (n == 0) return AVERROR_EOF;
+        std::memcpy(buf, m->data + m->pos, n);
+        m->pos += n;
+        return static_cast<int>(n);
+    }
+
+    int64_t FFmpegVideoSource::SeekMemory(void* opaque, int64_t offset, int whence) {
+        auto* m = static_cast<MemoryInput*>(opaque);
+        if (whence & AVSEEK_SIZE) return static_cast<int64_t>(m->size);
+
+        int64_t base = 0;
+        switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = static_cast<int64_t>(m->pos); break;
+        case SEEK_END: base = static_cast<int64_t>(m->size); break;
+        default: return AVERROR(EINVAL);
+        }
+        const int64_t pos = base + offset;
+        if (pos < 0 || pos > static_cast<int64_t>(m->size)) return AVERROR(EINVAL);
+        m->pos = static_cast<size_t>(pos);
+        return pos;
+    }
+
+    void FFmpegVideoSource::OpenInput(const std::string& url) {
+        if (interrupted_) throw std::runtime_error("FFmpeg: source interrupted.");
+
+        // 1) 
         AVDictionary* opts = nullptr;
-        // ӳٳòȸĬϣϵͳΣ
-        av_dict_set(&opts, "rtsp_transport", "tcp", 0);   // tcp ȣudp ӳٵ͵У
-        av_dict_set(&opts, "stimeout", "5000000", 0);     // 5s ʱ΢룩
-        av_dict_set(&opts, "max_delay", "500000", 0);     // 0.5sЩЧ
-        // av_dict_set(&opts, "fflags", "nobuffer", 0);   // ȱ
+        if (url.rfind("rtsp", 0) == 0) {
+            // ӳٳòȸĬϣϵͳΣ
+            av_dict_set(&opts, "rtsp_transport", "tcp", 0);   // tcp ȣudp ӳٵ͵У
+            av_dict_set(&opts, "stimeout", "5000000", 0);     // 5s ʱ΢룩
+            av_dict_set(&opts, "max_delay", "500000", 0);     // 0.5sЩЧ
+            // av_dict_set(&opts, "fflags", "nobuffer", 0);   // ȱ
+        }
+
+        // жϣClose() ʱе av_read_frame ̷
+        stop_ = false;
+        pool_.Reopen();
+        fmt_ = avformat_alloc_context();
+        if (!fmt_) {
+            av_dict_free(&opts);
+            throw std::runtime_error("FFmpeg: avformat_alloc_context failed.");
+        }
+        fmt_->interrupt_callback.callback = &FFmpegVideoSource::InterruptCallback;
+        fmt_->interrupt_callback.opaque = this;
+        if (avio_) {
+            fmt_->pb = avio_;
+            fmt_->flags |= AVFMT_FLAG_CUSTOM_IO;
+        }
 
         if (avformat_open_input(&fmt_, url.c_str(), nullptr, &opts) < 0) {
             av_dict_free(&opts);
@@ -82,8 +194,25 @@ namespace video {
             throw std::runtime_error("FFmpeg: avcodec_parameters_to_context failed.");
         }
 
+        // ߳̽룺HD H.264/H.265 ˽ⲻ
+        dec_->thread_count = std::max(0, opt_.decode_threads);
+        switch (opt_.threading) {
+        case DecodeThreading::Frame: dec_->thread_type = FF_THREAD_FRAME; break;
+        case DecodeThreading::Slice: dec_->thread_type = FF_THREAD_SLICE; break;
+        default: dec_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE; break;
+        }
+
+        // ֻⲿֻ֡Ҫ FPS ʱ
+        switch (opt_.skip_frames) {
+        case SkipFrames::NonRef: dec_->skip_frame = AVDISCARD_NONREF; break;
+        case SkipFrames::NonKey: dec_->skip_frame = AVDISCARD_NONKEY; break;
+        default: dec_->skip_frame = AVDISCARD_DEFAULT; break;
+        }
+
         // ѡӳ٣֤гЧ
-        dec_->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        // LOW_DELAY turns frame threading off, so only set it when frames are decoded serially
+        const bool frame_threads = opt_.decode_threads != 1 && opt_.threading != DecodeThreading::Slice;
+        if (!frame_threads) dec_->flags |= AV_CODEC_FLAG_LOW_DELAY;
 
         if (avcodec_open2(dec_, codec, nullptr) < 0) {
             throw std::runtime_error("FFmpeg: avcodec_open2 failed.");
@@ -93,15 +222,92 @@ namespace video {
         pkt_ = av_packet_alloc();
         frame_ = av_frame_alloc();
         if (!pkt_ || !frame_) throw std::runtime_error("FFmpeg: alloc packet/frame failed.");
+        draining_ = false;
+
+        // segment decoding: start at the keyframe at or before start_us
+        if (opt_.start_us > 0) {
+            const AVRational tb = fmt_->streams[video_stream_index_]->time_base;
+            const int64_t ts = av_rescale_q(opt_.start_us, AVRational{ 1, 1000000 }, tb);
+            if (av_seek_frame(fmt_, video_stream_index_, ts, AVSEEK_FLAG_BACKWARD) < 0) {
+                throw std::runtime_error("FFmpeg: av_seek_frame failed.");
+            }
+        }
+
+        // 6) async: ̨̳߳
+        if (opt_.async) {
+            {
+                std::lock_guard<std::mutex> lk(ring_mu_);
+                ring_.clear();
+                skipped_ = 0;
+                decode_done_ = false;
+                skip_to_keyframe_ = false;
+            }
+            decode_thread_ = std::thread(&FFmpegVideoSource::DecodeThread, this);
+        }
     }
 
     bool FFmpegVideoSource::Read(Frame& out) {
-        if (!fmt_ || !dec_ || video_stream_index_ < 0) return false;
+        if (!fmt_ || !dec_ || video_stream_index_ < 0 || interrupted_) return false;
+
+        if (!opt_.async) {
+            if (!DecodeNext(out)) return false;
+            out.skipped = 0;
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lk(ring_mu_);
+        ring_cv_.wait(lk, [&] { return !ring_.empty() || decode_done_ || interrupted_; });
+        if (ring_.empty() || interrupted_) return false;
+
+        // newest wins; everything older counts as skipped
+        skipped_ += static_cast<uint32_t>(ring_.size() - 1);
+        g_dropped.Add(ring_.size() - 1);
+        while (ring_.size() > 1) ring_.pop_front(); // buffers go back to the pool
+
+        out = std::move(ring_.front());
+        ring_.pop_front();
+        out.skipped = skipped_;
+        skipped_ = 0;
+        return true;
+    }
+
+    bool FFmpegVideoSource::DecodeNext(Frame& out) {
+        // time inside the codec only (not the wait for packets from the network)
+        uint64_t decode_ns = 0;
 
         // ϶ֱһ֡
         while (true) {
-            int ret = av_read_frame(fmt_, pkt_);
+            // ӽ֡һ send Ӧ receive
+            auto t_recv = metrics::Clock::now();
+            int ret = avcodec_receive_frame(dec_, frame_);
+            decode_ns += NsSince(t_recv);
+            if (ret == 0) {
+                if (opt_.start_us <= 0 && opt_.end_us <= 0) break;
+
+                // segment range (frames come out in pts order)
+                const int64_t t = ToUs(frame_->best_effort_timestamp, fmt_->streams[video_stream_index_]->time_base);
+                if (opt_.end_us > 0 && t >= opt_.end_us) {
+                    av_frame_unref(frame_);
+                    return false;
+                }
+                if (t >= opt_.start_us) break;
+                av_frame_unref(frame_);  // before the segment: only needed as a reference
+                continue;
+            }
+            if (ret != AVERROR(EAGAIN)) {
+                // ʧܻ
+                return false;
+            }
+
+            // Ҫ packet
+            ret = av_read_frame(fmt_, pkt_);
             if (ret < 0) {
+                // end of a file: flush the frames still held by the decoder (reordering / frame threads)
+                if (ret == AVERROR_EOF && !draining_) {
+                    draining_ = true;
+                    avcodec_send_packet(dec_, nullptr);
+                    continue;
+                }
                 // ˣ EOF//ʱ
                 return false;
             }
@@ -112,41 +318,152 @@ namespace video {
                 continue;
             }
 
+            if (opt_.async && opt_.drop_packets_before_decode) {
+                std::lock_guard<std::mutex> lk(ring_mu_);
+                const bool key = (pkt_->flags & AV_PKT_FLAG_KEY) != 0;
+                if (!skip_to_keyframe_ && !key && !ring_.empty()) {
+                    // consumer is behind: the rest of this GOP would be dropped after decoding anyway
+                    const bool full = static_cast<int>(ring_.size()) >= opt_.ring_size;
+                    const bool stale = SteadyNowUs() - ring_.back().wall_us
+                        > static_cast<int64_t>(opt_.drop_after_ms) * 1000;
+                    if (full || stale) {
+                        skip_to_keyframe_ = true;
+                        ++skipped_;
+                        g_dropped.Add();
+                    }
+                }
+                if (skip_to_keyframe_) {
+                    if (!key) {
+                        av_packet_unref(pkt_);
+                        continue;
+                    }
+                    // restart the decoder at the keyframe; references of the dropped GOP are gone
+                    skip_to_keyframe_ = false;
+                    avcodec_flush_buffers(dec_);
+                }
+            }
+
             // 
+            auto t_send = metrics::Clock::now();
             ret = avcodec_send_packet(dec_, pkt_);
+            decode_ns += NsSince(t_send);
             av_packet_unref(pkt_);
             if (ret < 0) {
                 // ͰʧܣΪ/ݴ
                 return false;
             }
+        }
 
-            // ӽ֡һ send Ӧ receive
-            ret = avcodec_receive_frame(dec_, frame_);
-            if (ret == AVERROR(EAGAIN)) {
-                // Ҫ packet
-                continue;
+        g_decode_time.Record(decode_ns);
+
+        if (opt_.luma_w > 0) MakeLuma(out);
+        else out.luma.release();
+
+        // õһ֡frame_ ͨ YUV420P / NV12 
+        bool ok = true;
+        if (opt_.out_format == PixelFormat::BGR24) {
+            out.planes.release();
+            out.source.reset();
+            ok = ConvertBGR(out);
+        }
+        else if (opt_.out_format == PixelFormat::NATIVE) {
+            // zero-copy: consumers read the decoder's own planes through Frame::source
+            out.bgr.release();
+            out.planes.release();
+            out.format = PixelFormat::NATIVE;
+            out.width = out.src_width = frame_->width;
+            out.height = out.src_height = frame_->height;
+            out.lb = LetterBoxInfo{ 1.0f, 0, 0, frame_->width, frame_->height };
+            AVFrame* ref = av_frame_clone(frame_);
+            if (!ref) throw std::runtime_error("FFmpeg: av_frame_clone failed.");
+            out.source = std::shared_ptr<AVFrame>(ref, [](AVFrame* f) { av_frame_free(&f); });
+        }
+        else {
+            out.bgr.release();
+            ok = ConvertScaled(out);
+            if (!ok) {
+                out.source.reset();
             }
-            if (ret < 0) {
-                // ʧܻ
-                return false;
+            else if (opt_.keep_source_frame) {
+                AVFrame* ref = av_frame_clone(frame_);
+                if (!ref) throw std::runtime_error("FFmpeg: av_frame_clone failed.");
+                out.source = std::shared_ptr<AVFrame>(ref, [](AVFrame* f) { av_frame_free(&f); });
             }
+            else {
+                out.source.reset();
+            }
+        }
 
-            // õһ֡frame_ ͨ YUV420P / NV12 
-            const int src_w = frame_->width;
-            const int src_h = frame_->height;
-            const int src_fmt = frame_->format;
+        // pts ת΢
+        AVRational tb = fmt_->streams[video_stream_index_]->time_base;
+        out.pts_us = ToUs(frame_->best_effort_timestamp, tb);
+        out.wall_us = SteadyNowUs();
 
-            // ʼ/ swsYUV -> BGR
-            InitScalerIfNeeded(src_w, src_h, src_fmt);
+        av_frame_unref(frame_);
+        return ok;
+    }
 
-            // ׼ MatBGR
-            if (bgr_.empty() || bgr_.cols != src_w || bgr_.rows != src_h) {
-                bgr_ = cv::Mat(src_h, src_w, CV_8UC3);
+    void FFmpegVideoSource::MakeLuma(Frame& out) {
+        out.luma.release(); // may still be shared with a previous frame
+
+        // only formats whose first plane is 8-bit luma, one byte per pixel
+        const AVPixFmtDescriptor* d = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame_->format));
+        if (!d || (d->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL))
+            || d->comp[0].plane != 0 || d->comp[0].depth != 8 || d->comp[0].step != 1) {
+            return; // consumers compute their own thumbnail
+        }
+
+        cv::Mat y(frame_->height, frame_->width, CV_8UC1, frame_->data[0], static_cast<size_t>(frame_->linesize[0]));
+        const int w = std::min(opt_.luma_w, frame_->width);
+        const int h = std::max(1, static_cast<int>(std::lround(static_cast<double>(frame_->height) * w / frame_->width)));
+        cv::resize(y, out.luma, cv::Size(w, h), 0, 0, cv::INTER_AREA);
+    }
+
+    bool FFmpegVideoSource::AcquirePixels(cv::Mat& dst, int rows, int cols, int type) {
+        if (!opt_.async) {
+            if (!pool_.Acquire(rows, cols, type, dst, opt_.pool_timeout_ms)) {
+                throw std::runtime_error("FFmpeg: frame pool exhausted (the caller holds pool_size frames).");
             }
+            return true;
+        }
+
+        while (!stop_) {
+            if (pool_.Acquire(rows, cols, type, dst, 0)) return true;
+
+            // an unread frame in the ring is the cheapest one to give up
+            {
+                std::lock_guard<std::mutex> lk(ring_mu_);
+                if (!ring_.empty()) {
+                    ring_.pop_front();
+                    ++skipped_;
+                    g_dropped.Add();
+                    continue;
+                }
+            }
+
+            // every buffer is held downstream: wait for one to come back (Close() wakes us)
+            if (pool_.Acquire(rows, cols, type, dst, -1)) return true;
+        }
+        return false;
+    }
+
+    bool FFmpegVideoSource::ConvertBGR(Frame& out) {
+        const int src_w = frame_->width;
+        const int src_h = frame_->height;
+        const int src_fmt = frame_->format;
+
+        // ʼ/ swsYUV -> BGR
+        InitScalerIfNeeded(src_w, src_h, src_fmt, src_w, src_h, AV_PIX_FMT_BGR24);
 
-            uint8_t* dst_data[4] = { bgr_.data, nullptr, nullptr, nullptr };
-            int dst_linesize[4] = { static_cast<int>(bgr_.step), 0, 0, 0 };
+        // ׼ MatBGRԻ
+        cv::Mat& dst = out.bgr;
+        if (!AcquirePixels(dst, src_h, src_w, CV_8UC3)) return false;
 
+        uint8_t* dst_data[4] = { dst.data, nullptr, nullptr, nullptr };
+        int dst_linesize[4] = { static_cast<int>(dst.step), 0, 0, 0 };
+
+        {
+            metrics::ScopedTimer timer(g_sws_time);
             sws_scale(
                 sws_,
                 frame_->data,
@@ -156,28 +473,199 @@ namespace video {
                 dst_data,
                 dst_linesize
             );
+        }
 
-            //  Frame
-            out.format = PixelFormat::BGR24;
-            out.width = src_w;
-            out.height = src_h;
+        //  Frame
+        out.format = PixelFormat::BGR24;
+        out.width = src_w;
+        out.height = src_h;
+        out.src_width = src_w;
+        out.src_height = src_h;
+        out.lb = LetterBoxInfo{ 1.0f, 0, 0, src_w, src_h };
+        return true;
+    }
 
-            // pts ת΢
-            AVRational tb = fmt_->streams[video_stream_index_]->time_base;
-            out.pts_us = ToUs(frame_->best_effort_timestamp, tb);
+    bool FFmpegVideoSource::ConvertScaled(Frame& out) {
+        const int src_w = frame_->width;
+        const int src_h = frame_->height;
+        const int src_fmt = frame_->format;
+        const bool nv12 = opt_.out_format == PixelFormat::NV12;
+
+        // one load: width and height always come from the same SetOutputSize call
+        const uint64_t size = out_size_.load(std::memory_order_relaxed);
+        const int out_w = static_cast<int>(size >> 32);
+        const int out_h = static_cast<int>(size & 0xffffffffu);
+        const int W = out_w > 0 ? out_w : src_w;
+        const int H = out_h > 0 ? out_h : src_h;
+        if (nv12 && ((W | H) & 1)) {
+            throw std::runtime_error("FFmpeg: NV12 output needs an even width and height.");
+        }
 
-            out.bgr = bgr_; // ǳcv::Mat
-            av_frame_unref(frame_);
-            return true;
+        // same letterbox geometry as the engine (LetterboxBGR); NV12 snaps to even values
+        // because of its 2x2 chroma, which moves boxes by at most one pixel
+        float r = std::min(W / static_cast<float>(src_w), H / static_cast<float>(src_h));
+        int new_w = std::max(1, static_cast<int>(std::round(src_w * r)));
+        int new_h = std::max(1, static_cast<int>(std::round(src_h * r)));
+        int pad_x = (W - new_w) / 2;
+        int pad_y = (H - new_h) / 2;
+        if (nv12) {
+            new_w = std::max(2, new_w & ~1); new_h = std::max(2, new_h & ~1);
+            pad_x &= ~1; pad_y &= ~1;
+        }
+
+        const int rows = nv12 ? H * 3 / 2 : H * 3;
+        cv::Mat& dst = out.planes;
+        if (!AcquirePixels(dst, rows, W, CV_8UC1)) return false;
+
+        InitScalerIfNeeded(src_w, src_h, src_fmt, new_w, new_h, nv12 ? AV_PIX_FMT_NV12 : AV_PIX_FMT_GBRP);
+
+        uint8_t* dst_data[4] = { nullptr, nullptr, nullptr, nullptr };
+        int dst_linesize[4] = { W, W, W, 0 };
+        const size_t plane = static_cast<size_t>(W) * H;
+
+        if (!nv12) {
+            uint8_t* R = dst.data;
+            uint8_t* G = R + plane;
+            uint8_t* B = G + plane;
+            for (uint8_t* p : { R, G, B }) {
+                FillBorder(p, W, W, H, pad_x, pad_y, new_w, new_h, 114);
+            }
+            const size_t off = static_cast<size_t>(pad_y) * W + pad_x;
+            // GBRP plane order is G, B, R
+            dst_data[0] = G + off;
+            dst_data[1] = B + off;
+            dst_data[2] = R + off;
+        }
+        else {
+            uint8_t* Y = dst.data;
+            uint8_t* UV = Y + plane;
+            FillBorder(Y, W, W, H, pad_x, pad_y, new_w, new_h, 114);
+            FillBorder(UV, W, W, H / 2, pad_x, pad_y / 2, new_w, new_h / 2, 128);
+            dst_data[0] = Y + static_cast<size_t>(pad_y) * W + pad_x;
+            dst_data[1] = UV + static_cast<size_t>(pad_y / 2) * W + pad_x;
+        }
+
+        {
+            metrics::ScopedTimer timer(g_sws_time);
+            sws_scale(
+                sws_,
+                frame_->data,
+                frame_->linesize,
+                0,
+                src_h,
+                dst_data,
+                dst_linesize
+            );
+        }
+
+        out.format = opt_.out_format;
+        out.width = W;
+        out.height = H;
+        out.src_width = src_w;
+        out.src_height = src_h;
+        out.lb = LetterBoxInfo{ r, pad_x, pad_y, W, H };
+        return true;
+    }
+
+    void FFmpegVideoSource::DecodeThread() {
+        while (!stop_) {
+            Frame f;
+
+            bool ok = false;
+            try {
+                ok = DecodeNext(f);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[FFmpeg] decode thread: " << e.what() << "\n";
+            }
+
+            std::lock_guard<std::mutex> lk(ring_mu_);
+            if (!ok) {
+                decode_done_ = true;
+                ring_cv_.notify_all();
+                return;
+            }
+
+            if (static_cast<int>(ring_.size()) >= opt_.ring_size) {
+                ring_.pop_front();
+                ++skipped_;
+                g_dropped.Add();
+            }
+            ring_.push_back(std::move(f));
+            ring_cv_.notify_one();
+        }
+
+        std::lock_guard<std::mutex> lk(ring_mu_);
+        decode_done_ = true;
+        ring_cv_.notify_all();
+    }
+
+    void FFmpegVideoSource::StopDecodeThread() {
+        stop_ = true; // also makes InterruptCallback abort a blocking av_read_frame
+        pool_.Close(); // and wakes a decode thread waiting for a free buffer
+        if (decode_thread_.joinable()) decode_thread_.join();
+
+        std::lock_guard<std::mutex> lk(ring_mu_);
+        ring_.clear();
+        decode_done_ = true;
+    }
+
+    int FFmpegVideoSource::InterruptCallback(void* opaque) {
+        auto* self = static_cast<FFmpegVideoSource*>(opaque);
+        return self->stop_.load() || self->interrupted_.load() ? 1 : 0;
+    }
+
+    void FFmpegVideoSource::Interrupt() {
+        interrupted_ = true;  // InterruptCallback aborts a blocking avformat_open_input / av_read_frame
+        pool_.Close();        // a decode waiting for a free buffer
+        {
+            std::lock_guard<std::mutex> lk(ring_mu_);
+        }
+        ring_cv_.notify_all(); // an async Read() waiting for a frame
+    }
+
+    void FFmpegVideoSource::SetOutputSize(int w, int h) {
+        const uint64_t size = (static_cast<uint64_t>(std::max(0, w)) << 32) | static_cast<uint32_t>(std::max(0, h));
+        out_size_.store(size, std::memory_order_relaxed);
+    }
+
+    std::vector<int64_t> FFmpegVideoSource::ScanKeyframes(int64_t* end_us) {
+        if (!fmt_ || !dec_ || video_stream_index_ < 0) throw std::runtime_error("FFmpegVideoSource: not open.");
+        if (opt_.async) throw std::runtime_error("FFmpegVideoSource: ScanKeyframes needs a synchronous source.");
+
+        const AVStream* st = fmt_->streams[video_stream_index_];
+        std::vector<int64_t> keys;
+        int64_t end = 0;
+        while (av_read_frame(fmt_, pkt_) >= 0) {
+            if (pkt_->stream_index == video_stream_index_) {
+                const int64_t ts = pkt_->pts != AV_NOPTS_VALUE ? pkt_->pts : pkt_->dts;
+                if (ts != AV_NOPTS_VALUE) {
+                    if (pkt_->flags & AV_PKT_FLAG_KEY) keys.push_back(ToUs(ts, st->time_base));
+                    end = std::max(end, ToUs(ts + std::max<int64_t>(pkt_->duration, 0), st->time_base));
+                }
+            }
+            av_packet_unref(pkt_);
+        }
+        std::sort(keys.begin(), keys.end());
+        if (end_us) *end_us = end;
+
+        const int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+        if (av_seek_frame(fmt_, video_stream_index_, start, AVSEEK_FLAG_BACKWARD) < 0) {
+            throw std::runtime_error("FFmpeg: cannot rewind after the keyframe scan.");
         }
+        avcodec_flush_buffers(dec_);
+        draining_ = false;
+        return keys;
     }
 
     void FFmpegVideoSource::Close() {
+        StopDecodeThread();
         Cleanup();
     }
 
     void FFmpegVideoSource::Cleanup() {
         if (sws_) { sws_freeContext(sws_); sws_ = nullptr; }
+        sws_key_ = ScalerKey();
 
         if (frame_) { av_frame_free(&frame_); frame_ = nullptr; }
         if (pkt_) { av_packet_free(&pkt_); pkt_ = nullptr; }
@@ -186,27 +674,92 @@ namespace video {
 
         if (fmt_) { avformat_close_input(&fmt_); fmt_ = nullptr; }
 
+        // custom IO is not freed by avformat_close_input
+        if (avio_) {
+            av_freep(&avio_->buffer);
+            avio_context_free(&avio_);
+        }
+        mem_.reset();
+
         video_stream_index_ = -1;
-        bgr_.release();
     }
 
-    void FFmpegVideoSource::InitScalerIfNeeded(int src_w, int src_h, int src_pix_fmt) {
-        // ̶ BGR24
-        const AVPixelFormat dst_fmt = AV_PIX_FMT_BGR24;
+    void FFmpegVideoSource::InitScalerIfNeeded(int src_w, int src_h, int src_pix_fmt,
+        int dst_w, int dst_h, int dst_pix_fmt) {
+        int flags = SWS_BILINEAR;
+        switch (opt_.scale_filter) {
+        case ScaleFilter::FastBilinear: flags = SWS_FAST_BILINEAR; break;
+        case ScaleFilter::Area: flags = SWS_AREA; break;
+        default: break;
+        }
+
+        ScalerKey key;
+        key.src_w = src_w; key.src_h = src_h; key.src_fmt = src_pix_fmt;
+        key.dst_w = dst_w; key.dst_h = dst_h; key.dst_fmt = dst_pix_fmt;
+        key.flags = flags;
+
+        // /ʽʱãsws ʼҪ˲Զһ sws_scale
+        if (sws_ && key == sws_key_) return;
 
         if (sws_) {
-            // ֱͷؽȫп
             sws_freeContext(sws_);
             sws_ = nullptr;
         }
 
         sws_ = sws_getContext(
             src_w, src_h, static_cast<AVPixelFormat>(src_pix_fmt),
-            src_w, src_h, dst_fmt,
-            SWS_BILINEAR,
+            dst_w, dst_h, static_cast<AVPixelFormat>(dst_pix_fmt),
+            flags,
             nullptr, nullptr, nullptr
         );
-        if (!sws_) throw std::runtime_error("FFmpeg: sws_getContext failed.");
+        if (!sws_) {
+            sws_key_ = ScalerKey();
+            throw std::runtime_error("FFmpeg: sws_getContext failed.");
+        }
+        sws_key_ = key;
+    }
+
+    bool ToBGR(const Frame& f, cv::Mat& bgr) {
+        if (f.format == PixelFormat::BGR24) {
+            if (f.bgr.empty()) return false;
+            bgr = f.bgr;
+            return true;
+        }
+
+        const AVFrame* src = f.source.get();
+        if (src && src->width > 0 && src->height > 0) {
+            // one cached context per thread; sws_getCachedContext reuses it while the geometry holds
+            struct SwsHolder {
+                SwsContext* ctx = nullptr;
+                ~SwsHolder() { if (ctx) sws_freeContext(ctx); }
+            };
+            thread_local SwsHolder sws;
+
+            sws.ctx = sws_getCachedContext(sws.ctx,
+                src->width, src->height, static_cast<AVPixelFormat>(src->format),
+                src->width, src->height, AV_PIX_FMT_BGR24,
+                SWS_BILINEAR, nullptr, nullptr, nullptr);
+            if (!sws.ctx) return false;
+
+            bgr.create(src->height, src->width, CV_8UC3);
+            uint8_t* dst_data[4] = { bgr.data, nullptr, nullptr, nullptr };
+            int dst_linesize[4] = { static_cast<int>(bgr.step), 0, 0, 0 };
+            sws_scale(sws.ctx, src->data, src->linesize, 0, src->height, dst_data, dst_linesize);
+            return true;
+        }
+
+        if (f.format == PixelFormat::RGB_PLANAR && !f.planes.empty()) {
+            // no source kept: model-size image only
+            const int H = f.height;
+            std::vector<cv::Mat> ch = {
+                f.planes.rowRange(2 * H, 3 * H),  // B
+                f.planes.rowRange(H, 2 * H),      // G
+                f.planes.rowRange(0, H),          // R
+            };
+            cv::merge(ch, bgr);
+            return true;
+        }
+        return false;
     }
 
 } // namespace video
@@ -0,0 +1,229 @@
+#include "video/ffmpeg_video_writer.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
+}
+
+#include "common/metrics.h"
+#include "video/ffmpeg_video_source.h"
+
+namespace video {
+
+    static metrics::Histogram& g_encode_time = metrics::Stage("encode");
+    static metrics::Counter& g_dropped = metrics::Dropped("encoder");
+
+    FFmpegVideoWriter::FFmpegVideoWriter(std::string path)
+        : FFmpegVideoWriter(std::move(path), Options()) { }
+
+    FFmpegVideoWriter::FFmpegVideoWriter(std::string path, const Options& opt)
+        : path_(std::move(path)),
+        opt_(opt) {
+        if (!opt_.encoder.empty()) {
+            codec_ = avcodec_find_encoder_by_name(opt_.encoder.c_str());
+            if (!codec_) throw std::runtime_error("FFmpegVideoWriter: encoder not found: " + opt_.encoder);
+        }
+        else {
+            codec_ = avcodec_find_encoder(AV_CODEC_ID_H264);
+            if (!codec_) codec_ = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+            if (!codec_) throw std::runtime_error("FFmpegVideoWriter: this FFmpeg build has no H.264 / MPEG-4 encoder.");
+        }
+        opt_.queue_size = std::max(1, opt_.queue_size);
+        opt_.fps = std::max(1, opt_.fps);
+
+        th_ = std::thread(&FFmpegVideoWriter::Loop, this);
+    }
+
+    FFmpegVideoWriter::~FFmpegVideoWriter() {
+        Close();
+    }
+
+    Frame FFmpegVideoWriter::EncoderFrame(const Frame& frame) {
+        Frame f = frame;
+        f.luma.release();
+        if (f.format == PixelFormat::BGR24) {
+            f.bgr = frame.bgr.clone();
+            f.source.reset();
+        }
+        else if (f.source || f.format != PixelFormat::RGB_PLANAR) {
+            f.planes.release();  // ToBGR reads the source frame (or cannot convert at all)
+        }
+        else {
+            f.planes = frame.planes.clone();  // model-size image only
+        }
+        return f;
+    }
+
+    bool FFmpegVideoWriter::Write(const Frame& frame, const std::vector<Det>& dets, const std::string& label) {
+        if (failed_) return true;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (closing_) return true;
+            if (q_.size() >= static_cast<size_t>(opt_.queue_size)) {
+                ++skipped_;
+                g_dropped.Add();
+                return true;
+            }
+        }
+
+        // copied outside the lock; the queue can only have shrunk meanwhile (one render thread)
+        Item item{ EncoderFrame(frame), dets, label };
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (closing_) return true;
+            q_.push_back(std::move(item));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    void FFmpegVideoWriter::Close() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            closing_ = true;
+        }
+        cv_.notify_all();
+        if (th_.joinable()) th_.join();
+    }
+
+    void FFmpegVideoWriter::Loop() {
+        auto fail = [&](const std::exception& e) {
+            std::cerr << "[FFmpegVideoWriter] " << path_ << ": " << e.what() << " (recording stopped)\n";
+            failed_ = true;
+        };
+
+        for (;;) {
+            Item item;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                cv_.wait(lk, [&] { return closing_ || !q_.empty(); });
+                if (q_.empty()) break;  // closing, everything written
+                item = std::move(q_.front());
+                q_.pop_front();
+            }
+            if (failed_) continue;
+
+            try {
+                metrics::ScopedTimer timer(g_encode_time);
+                const bool ok = opt_.draw ? DrawFrame(item.frame, item.dets, item.label, vis_)
+                    : ToBGR(item.frame, vis_);
+                if (!ok) continue;
+                Encode(vis_, item.frame.pts_us);
+                ++written_;
+            }
+            catch (const std::exception& e) {
+                fail(e);
+            }
+        }
+
+        try {
+            if (header_written_ && !failed_) {
+                Send(nullptr);  // drain the encoder
+                if (av_write_trailer(fmt_) < 0) throw std::runtime_error("av_write_trailer failed.");
+            }
+        }
+        catch (const std::exception& e) {
+            fail(e);
+        }
+        Release();
+    }
+
+    void FFmpegVideoWriter::Open(int w, int h) {
+        // 4:2:0 needs even sizes
+        const int ow = (opt_.width > 0 ? opt_.width : w) & ~1;
+        const int oh = (opt_.height > 0 ? opt_.height : h) & ~1;
+        if (ow <= 0 || oh <= 0) throw std::runtime_error("invalid output size.");
+
+        if (avformat_alloc_output_context2(&fmt_, nullptr, nullptr, path_.c_str()) < 0 || !fmt_) {
+            throw std::runtime_error("cannot pick a container for this file name.");
+        }
+        st_ = avformat_new_stream(fmt_, nullptr);
+        enc_ = avcodec_alloc_context3(codec_);
+        yuv_ = av_frame_alloc();
+        pkt_ = av_packet_alloc();
+        if (!st_ || !enc_ || !yuv_ || !pkt_) throw std::runtime_error("FFmpeg allocation failed.");
+
+        enc_->width = ow;
+        enc_->height = oh;
+        enc_->pix_fmt = AV_PIX_FMT_YUV420P;
+        // ms ticks: frames keep their source timestamps, skipped frames just leave a gap
+        enc_->time_base = AVRational{ 1, 1000 };
+        enc_->framerate = AVRational{ opt_.fps, 1 };
+        enc_->gop_size = opt_.gop;
+        enc_->max_b_frames = 2;
+        enc_->bit_rate = opt_.bit_rate > 0 ? opt_.bit_rate : static_cast<int64_t>(ow) * oh * opt_.fps * 2 / 25;
+        if (fmt_->oformat->flags & AVFMT_GLOBALHEADER) enc_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        if (avcodec_open2(enc_, codec_, nullptr) < 0) throw std::runtime_error("avcodec_open2 (encoder) failed.");
+        if (avcodec_parameters_from_context(st_->codecpar, enc_) < 0) throw std::runtime_error("avcodec_parameters_from_context failed.");
+        st_->time_base = enc_->time_base;
+
+        if (!(fmt_->oformat->flags & AVFMT_NOFILE) && avio_open(&fmt_->pb, path_.c_str(), AVIO_FLAG_WRITE) < 0) {
+            throw std::runtime_error("cannot open the file for writing.");
+        }
+        if (avformat_write_header(fmt_, nullptr) < 0) throw std::runtime_error("avformat_write_header failed.");
+        header_written_ = true;
+
+        yuv_->format = enc_->pix_fmt;
+        yuv_->width = ow;
+        yuv_->height = oh;
+        if (av_frame_get_buffer(yuv_, 0) < 0) throw std::runtime_error("av_frame_get_buffer failed.");
+    }
+
+    void FFmpegVideoWriter::Encode(const cv::Mat& bgr, int64_t pts_us) {
+        if (!enc_) {
+            first_pts_us_ = pts_us;
+            Open(bgr.cols, bgr.rows);
+        }
+
+        // cached: only rebuilt if the source size changes mid-stream
+        sws_ = sws_getCachedContext(sws_, bgr.cols, bgr.rows, AV_PIX_FMT_BGR24,
+            enc_->width, enc_->height, AV_PIX_FMT_YUV420P, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!sws_) throw std::runtime_error("sws_getCachedContext failed.");
+
+        if (av_frame_make_writable(yuv_) < 0) throw std::runtime_error("av_frame_make_writable failed.");
+        const uint8_t* src[1] = { bgr.data };
+        const int src_stride[1] = { static_cast<int>(bgr.step) };
+        sws_scale(sws_, src, src_stride, 0, bgr.rows, yuv_->data, yuv_->linesize);
+
+        // timestamps must increase; sources without (or with restarted) pts advance by one nominal frame
+        int64_t pts = (pts_us - first_pts_us_) / 1000;
+        if (pts <= last_pts_) pts = last_pts_ + std::max(1, 1000 / opt_.fps);
+        last_pts_ = pts;
+        yuv_->pts = pts;
+
+        Send(yuv_);
+    }
+
+    void FFmpegVideoWriter::Send(AVFrame* in) {
+        if (avcodec_send_frame(enc_, in) < 0) throw std::runtime_error("avcodec_send_frame failed.");
+        while (avcodec_receive_packet(enc_, pkt_) == 0) {
+            av_packet_rescale_ts(pkt_, enc_->time_base, st_->time_base);
+            pkt_->stream_index = st_->index;
+            if (av_interleaved_write_frame(fmt_, pkt_) < 0) throw std::runtime_error("av_interleaved_write_frame failed.");
+        }
+    }
+
+    void FFmpegVideoWriter::Release() {
+        sws_freeContext(sws_);
+        sws_ = nullptr;
+        av_packet_free(&pkt_);
+        av_frame_free(&yuv_);
+        avcodec_free_context(&enc_);
+        if (fmt_) {
+            if (fmt_->pb && !(fmt_->oformat->flags & AVFMT_NOFILE)) avio_closep(&fmt_->pb);
+            avformat_free_context(fmt_);
+            fmt_ = nullptr;
+        }
+        st_ = nullptr;
+        header_written_ = false;
+        vis_.release();
+    }
+
+} // namespace video
@@ -0,0 +1,217 @@
+#include "video/frame_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace video {
+
+    // Reservation the calling thread holds for its next pooled allocation (the allocator it was
+    // made on), so an allocation only ever consumes its own Acquire()'s reservation.
+    static thread_local const void* t_reservation = nullptr;
+
+    // Same bookkeeping as OpenCV's StdMatAllocator, but buffers come from / go back to a free
+    // list. Every UMatData keeps a strong reference to the allocator in userdata, so the state
+    // stays valid until the last pooled Mat is gone.
+    class FramePool::Allocator final : public cv::MatAllocator,
+        public std::enable_shared_from_this<FramePool::Allocator> {
+    public:
+        explicit Allocator(int capacity)
+            : capacity_(std::max(1, capacity)) { }
+
+        ~Allocator() override {
+            for (auto& b : free_) cv::fastFree(b.second);
+        }
+
+        cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+            cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usage*/) const override {
+            size_t total = CV_ELEM_SIZE(type);
+            for (int i = dims - 1; i >= 0; --i) {
+                if (step) {
+                    if (data0 && step[i] != CV_AUTOSTEP) {
+                        CV_Assert(total <= step[i]);
+                        total = step[i];
+                    }
+                    else {
+                        step[i] = total;
+                    }
+                }
+                total *= sizes[i];
+            }
+
+            cv::UMatData* u = new cv::UMatData(this);
+            if (data0) {
+                u->data = u->origdata = static_cast<uint8_t*>(data0);
+                u->flags |= cv::UMatData::USER_ALLOCATED;
+            }
+            else {
+                u->data = u->origdata = Take(total);
+                u->userdata = new std::shared_ptr<const Allocator>(shared_from_this());
+            }
+            u->size = total;
+            return u;
+        }
+
+        bool allocate(cv::UMatData* u, cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usage*/) const override {
+            return u != nullptr;
+        }
+
+        void deallocate(cv::UMatData* u) const override {
+            if (!u) return;
+            CV_Assert(u->urefcount == 0);
+            CV_Assert(u->refcount == 0);
+
+            auto* self = static_cast<std::shared_ptr<const Allocator>*>(u->userdata);
+            if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+                Give(u->origdata, u->size);
+                u->origdata = nullptr;
+            }
+            delete u;
+            delete self; // may destroy *this: last statement
+        }
+
+        // Waits for a free slot and reserves it for this thread; its next Mat::create() on this
+        // allocator uses the slot.
+        bool Reserve(int timeout_ms) {
+            std::unique_lock<std::mutex> lk(mu_);
+            auto ready = [&] { return closed_ || in_use_ + reserved_ < capacity_; };
+            if (timeout_ms < 0) {
+                cv_.wait(lk, ready);
+            }
+            else if (!cv_.wait_for(lk, std::chrono::milliseconds(timeout_ms), ready)) {
+                return false;
+            }
+            if (closed_) return false;
+            ++reserved_;
+            t_reservation = this;
+            return true;
+        }
+
+        // Gives back this thread's reservation if the allocation did not use it
+        void Unreserve() {
+            if (t_reservation != this) return;
+            t_reservation = nullptr;
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                --reserved_;
+            }
+            cv_.notify_one();
+        }
+
+        void SetClosed(bool closed) {
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                closed_ = closed;
+            }
+            cv_.notify_all();
+        }
+
+        int Capacity() const { return capacity_; }
+
+        int InUse() const {
+            std::lock_guard<std::mutex> lk(mu_);
+            return in_use_;
+        }
+
+    private:
+        uint8_t* Take(size_t size) const {
+            uint8_t* stale = nullptr;
+            uint8_t* p = nullptr;
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                if (t_reservation == this) {
+                    t_reservation = nullptr;
+                    --reserved_;
+                }
+                ++in_use_;
+
+                auto it = std::find_if(free_.begin(), free_.end(),
+                    [&](const std::pair<size_t, uint8_t*>& b) { return b.first == size; });
+                if (it != free_.end()) {
+                    p = it->second;
+                    free_.erase(it);
+                }
+                else if (!free_.empty()) {
+                    // resolution changed: drop an old-size buffer so the pool does not grow
+                    stale = free_.back().second;
+                    free_.pop_back();
+                }
+            }
+            if (stale) cv::fastFree(stale);
+            return p ? p : static_cast<uint8_t*>(cv::fastMalloc(size));
+        }
+
+        void Give(uint8_t* p, size_t size) const {
+            bool keep = false;
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                --in_use_;
+                if (static_cast<int>(free_.size()) < capacity_) {
+                    free_.emplace_back(size, p);
+                    keep = true;
+                }
+            }
+            if (!keep) cv::fastFree(p);
+            cv_.notify_one();
+        }
+
+    private:
+        const int capacity_;
+
+        mutable std::mutex mu_;
+        mutable std::condition_variable cv_;
+        mutable std::vector<std::pair<size_t, uint8_t*>> free_;
+        mutable int in_use_ = 0;
+        mutable int reserved_ = 0;
+        bool closed_ = false;
+    };
+
+    FramePool::FramePool(int capacity)
+        : alloc_(std::make_shared<Allocator>(capacity)) { }
+
+    FramePool::~FramePool() {
+        alloc_->SetClosed(true);
+    }
+
+    bool FramePool::Acquire(int rows, int cols, int type, cv::Mat& out, int timeout_ms) {
+        // drop the caller's previous buffer first, it may be the one we are waiting for
+        out.release();
+
+        if (!alloc_->Reserve(timeout_ms)) return false;
+        try {
+            cv::Mat m;
+            m.allocator = alloc_.get();
+            m.create(rows, cols, type);
+            // only this buffer is pooled: a later create() on the Mat or a copy of it must not
+            // allocate from the pool behind its back (release still goes through u->currAllocator)
+            m.allocator = nullptr;
+            out = std::move(m);
+        }
+        catch (...) {
+            alloc_->Unreserve();
+            throw;
+        }
+        alloc_->Unreserve();  // in case create() did not allocate
+        return true;
+    }
+
+    void FramePool::Close() {
+        alloc_->SetClosed(true);
+    }
+
+    void FramePool::Reopen() {
+        alloc_->SetClosed(false);
+    }
+
+    int FramePool::Capacity() const {
+        return alloc_->Capacity();
+    }
+
+    int FramePool::InUse() const {
+        return alloc_->InUse();
+    }
+
+} // namespace video
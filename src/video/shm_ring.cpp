@@ -0,0 +1,392 @@
+#include "video/shm_ring.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "common/metrics.h"
+
+namespace video {
+
+    static metrics::Histogram& g_publish_time = metrics::Stage("shm_publish");
+
+    static size_t AlignUp(size_t v, size_t a) {
+        return (v + a - 1) / a * a;
+    }
+
+    // Slot layout: Slot, Det[max_dets], pixels (64-byte aligned)
+    static size_t ImageOffset(size_t max_dets) {
+        return AlignUp(sizeof(shm::Slot) + max_dets * sizeof(shm::Det), 64);
+    }
+
+    // Size of the frame the boxes refer to (scaled frames: the decoded size)
+    static int SourceWidth(const Frame& f) { return f.src_width > 0 ? f.src_width : f.width; }
+    static int SourceHeight(const Frame& f) { return f.src_height > 0 ? f.src_height : f.height; }
+
+    static int64_t NowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    namespace shm {
+
+        Mapping::~Mapping() {
+            Close();
+        }
+
+#ifdef _WIN32
+        void Mapping::Create(const std::string& name, size_t bytes) {
+            Close();
+            name_ = "Local\\" + name;
+            const uint64_t size = bytes;
+            handle_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xffffffffu), name_.c_str());
+            if (!handle_) throw std::runtime_error("CreateFileMapping failed: " + name_);
+            if (GetLastError() == ERROR_ALREADY_EXISTS) {
+                CloseHandle(handle_);
+                handle_ = nullptr;
+                throw std::runtime_error("Shared memory is already in use: " + name_);
+            }
+            data_ = static_cast<uint8_t*>(MapViewOfFile(handle_, FILE_MAP_ALL_ACCESS, 0, 0, bytes));
+            if (!data_) {
+                Close();
+                throw std::runtime_error("MapViewOfFile failed: " + name_);
+            }
+            size_ = bytes;
+            owner_ = true;
+        }
+
+        void Mapping::Open(const std::string& name) {
+            Close();
+            name_ = "Local\\" + name;
+            handle_ = OpenFileMappingA(FILE_MAP_READ, FALSE, name_.c_str());
+            if (!handle_) throw std::runtime_error("No shared memory named " + name_);
+            data_ = static_cast<uint8_t*>(MapViewOfFile(handle_, FILE_MAP_READ, 0, 0, 0));
+            if (!data_) {
+                Close();
+                throw std::runtime_error("MapViewOfFile failed: " + name_);
+            }
+            MEMORY_BASIC_INFORMATION info{};
+            VirtualQuery(data_, &info, sizeof(info));
+            size_ = info.RegionSize;
+        }
+
+        void Mapping::Close() {
+            if (data_) UnmapViewOfFile(data_);
+            if (handle_) CloseHandle(handle_);  // the mapping goes away with its last handle
+            data_ = nullptr;
+            handle_ = nullptr;
+            size_ = 0;
+            owner_ = false;
+        }
+#else
+        void Mapping::Create(const std::string& name, size_t bytes) {
+            Close();
+            name_ = name.empty() || name[0] != '/' ? "/" + name : name;
+
+            // a segment left behind by a crashed producer: readers still attached keep the old one
+            shm_unlink(name_.c_str());
+            const int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            if (fd < 0) throw std::runtime_error("shm_open failed: " + name_);
+            if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+                ::close(fd);
+                shm_unlink(name_.c_str());
+                throw std::runtime_error("ftruncate failed: " + name_);
+            }
+            void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) {
+                shm_unlink(name_.c_str());
+                throw std::runtime_error("mmap failed: " + name_);
+            }
+            data_ = static_cast<uint8_t*>(p);
+            size_ = bytes;
+            owner_ = true;
+        }
+
+        void Mapping::Open(const std::string& name) {
+            Close();
+            name_ = name.empty() || name[0] != '/' ? "/" + name : name;
+
+            const int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+            if (fd < 0) throw std::runtime_error("No shared memory named " + name_);
+            struct stat st {};
+            if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+                ::close(fd);
+                throw std::runtime_error("Shared memory is empty: " + name_);
+            }
+            void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) throw std::runtime_error("mmap failed: " + name_);
+            data_ = static_cast<uint8_t*>(p);
+            size_ = static_cast<size_t>(st.st_size);
+        }
+
+        void Mapping::Close() {
+            if (data_) munmap(data_, size_);
+            if (owner_) shm_unlink(name_.c_str());
+            data_ = nullptr;
+            size_ = 0;
+            owner_ = false;
+        }
+#endif
+
+    } // namespace shm
+
+    // ---------------------------------------------------------------- publisher
+
+    ShmPublisher::ShmPublisher(const std::string& name)
+        : ShmPublisher(name, Options()) { }
+
+    ShmPublisher::ShmPublisher(const std::string& name, const Options& opt)
+        : opt_(opt) {
+        opt_.slots = std::max(2, opt_.slots);
+        opt_.max_dets = std::max(0, opt_.max_dets);
+
+        const size_t slot_bytes = AlignUp(ImageOffset(opt_.max_dets) + opt_.image_capacity, 64);
+        map_.Create(name, sizeof(shm::Header) + slot_bytes * opt_.slots);
+
+        uint8_t* base = map_.Data();
+        for (int i = 0; i < opt_.slots; ++i) {
+            new (base + sizeof(shm::Header) + slot_bytes * i) shm::Slot{};
+        }
+        hdr_ = new (base) shm::Header{};
+        hdr_->version = shm::kVersion;
+        hdr_->slots = static_cast<uint32_t>(opt_.slots);
+        hdr_->max_dets = static_cast<uint32_t>(opt_.max_dets);
+        hdr_->image_capacity = opt_.image_capacity;
+        hdr_->slot_bytes = slot_bytes;
+        std::atomic_thread_fence(std::memory_order_release);
+        hdr_->magic = shm::kMagic;  // written last: readers check it before anything else
+    }
+
+    ShmPublisher::~ShmPublisher() {
+        Close();
+    }
+
+    shm::Slot& ShmPublisher::SlotAt(uint64_t n) const {
+        return *reinterpret_cast<shm::Slot*>(map_.Data() + sizeof(shm::Header) + hdr_->slot_bytes * (n % hdr_->slots));
+    }
+
+    bool ShmPublisher::Write(const Frame& frame, const std::vector<Det>& dets, const std::string&) {
+        if (!hdr_) return true;
+        metrics::ScopedTimer timer(g_publish_time);
+
+        // what goes into the slot
+        const cv::Mat* img = nullptr;
+        shm::Image format = shm::Image::None;
+        LetterBoxInfo lb;
+        if (opt_.pixels == Pixels::Frame) {
+            switch (frame.format) {
+            case PixelFormat::BGR24: img = &frame.bgr; format = shm::Image::BGR; break;
+            case PixelFormat::RGB_PLANAR: img = &frame.planes; format = shm::Image::RGB_PLANAR; lb = frame.lb; break;
+            case PixelFormat::NV12: img = &frame.planes; format = shm::Image::NV12; lb = frame.lb; break;
+            default: break;
+            }
+        }
+        else if (opt_.pixels == Pixels::Luma && !frame.luma.empty()) {
+            img = &frame.luma;
+            format = shm::Image::GRAY;
+            lb.scale = SourceWidth(frame) > 0 ? static_cast<float>(frame.luma.cols) / SourceWidth(frame) : 1.f;
+        }
+        const size_t row_bytes = img && !img->empty() ? img->cols * img->elemSize() : 0;
+        const size_t bytes = img ? row_bytes * img->rows : 0;
+        if (bytes == 0 || bytes > opt_.image_capacity) {
+            img = nullptr;
+            format = shm::Image::None;
+        }
+
+        const uint64_t n = next_;
+        shm::Slot& s = SlotAt(n);
+
+        // seqlock: odd while writing, so readers can tell a torn slot
+        s.seq.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        s.frame_no = n;
+        s.pts_us = frame.pts_us;
+        s.wall_us = frame.wall_us;
+        s.publish_us = NowUs();
+        s.src_width = SourceWidth(frame);
+        s.src_height = SourceHeight(frame);
+        s.image = format;
+        s.rows = img ? img->rows : 0;
+        s.cols = img ? img->cols : 0;
+        s.step = static_cast<int32_t>(img ? row_bytes : 0);
+        s.lb_scale = lb.scale;
+        s.lb_pad_x = lb.pad_x;
+        s.lb_pad_y = lb.pad_y;
+
+        const size_t nd = std::min(dets.size(), static_cast<size_t>(opt_.max_dets));
+        shm::Det* out = reinterpret_cast<shm::Det*>(&s + 1);
+        for (size_t i = 0; i < nd; ++i) {
+            const Det& d = dets[i];
+            out[i] = shm::Det{ d.x1, d.y1, d.x2, d.y2, d.score, d.class_id, d.track_id, 0 };
+        }
+        s.n_dets = static_cast<uint32_t>(nd);
+
+        s.image_bytes = img ? bytes : 0;
+        if (img) {
+            uint8_t* dst = reinterpret_cast<uint8_t*>(&s) + ImageOffset(opt_.max_dets);
+            if (img->isContinuous()) {
+                std::memcpy(dst, img->data, bytes);
+            }
+            else {
+                for (int r = 0; r < img->rows; ++r) std::memcpy(dst + row_bytes * r, img->ptr(r), row_bytes);
+            }
+        }
+
+        s.seq.store(2 * n + 2, std::memory_order_release);
+        hdr_->published.store(n + 1, std::memory_order_release);
+        ++next_;
+        return true;
+    }
+
+    void ShmPublisher::Close() {
+        if (!hdr_) return;
+        hdr_->closed.store(1, std::memory_order_release);
+        hdr_ = nullptr;
+        map_.Close();
+    }
+
+    // ---------------------------------------------------------------- reader
+
+    ShmReader::ShmReader(const std::string& name)
+        : name_(name) {
+        map_.Open(name);
+        if (map_.Size() < sizeof(shm::Header)) throw std::runtime_error("Shared memory too small: " + name);
+
+        hdr_ = reinterpret_cast<const shm::Header*>(map_.Data());
+        if (hdr_->magic != shm::kMagic) throw std::runtime_error("Not a frame ring (or not ready yet): " + name);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (hdr_->version != shm::kVersion) {
+            throw std::runtime_error("Frame ring version " + std::to_string(hdr_->version)
+                + ", this reader speaks " + std::to_string(shm::kVersion));
+        }
+        if (hdr_->slots == 0 || sizeof(shm::Header) + hdr_->slot_bytes * hdr_->slots > map_.Size()
+            || ImageOffset(hdr_->max_dets) + hdr_->image_capacity > hdr_->slot_bytes) {
+            throw std::runtime_error("Frame ring header is inconsistent: " + name);
+        }
+
+        // start with what is still in the ring
+        const uint64_t pub = Published();
+        next_ = pub > hdr_->slots ? pub - hdr_->slots : 0;
+    }
+
+    const shm::Slot& ShmReader::SlotAt(uint64_t n) const {
+        return *reinterpret_cast<const shm::Slot*>(map_.Data() + sizeof(shm::Header) + hdr_->slot_bytes * (n % hdr_->slots));
+    }
+
+    uint64_t ShmReader::Published() const {
+        return hdr_->published.load(std::memory_order_acquire);
+    }
+
+    bool ShmReader::Closed() const {
+        return hdr_->closed.load(std::memory_order_acquire) != 0;
+    }
+
+    bool ShmReader::Get(uint64_t n, View& v) const {
+        const shm::Slot& s = SlotAt(n);
+        const uint64_t want = 2 * n + 2;
+        if (s.seq.load(std::memory_order_acquire) != want) return false;
+
+        v.frame_no = s.frame_no;
+        v.pts_us = s.pts_us;
+        v.wall_us = s.wall_us;
+        v.publish_us = s.publish_us;
+        v.src_width = s.src_width;
+        v.src_height = s.src_height;
+        v.lb.scale = s.lb_scale;
+        v.lb.pad_x = s.lb_pad_x;
+        v.lb.pad_y = s.lb_pad_y;
+
+        const uint32_t nd = std::min(s.n_dets, hdr_->max_dets);
+        const shm::Det* in = reinterpret_cast<const shm::Det*>(&s + 1);
+        v.dets.resize(nd);
+        for (uint32_t i = 0; i < nd; ++i) {
+            Det& d = v.dets[i];
+            d.x1 = in[i].x1; d.y1 = in[i].y1; d.x2 = in[i].x2; d.y2 = in[i].y2;
+            d.score = in[i].score;
+            d.class_id = in[i].class_id;
+            d.track_id = in[i].track_id;
+        }
+
+        const shm::Image format = s.image;
+        const int rows = s.rows, cols = s.cols, step = s.step;
+        const int type = format == shm::Image::BGR ? CV_8UC3 : CV_8UC1;
+        const bool has_image = format != shm::Image::None && rows > 0 && cols > 0
+            && static_cast<uint64_t>(step) * rows <= hdr_->image_capacity
+            && step >= cols * static_cast<int>(CV_ELEM_SIZE(type));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) != want) return false;  // overwritten while copying
+
+        v.image_format = has_image ? format : shm::Image::None;
+        if (has_image) {
+            uint8_t* px = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(&s) + ImageOffset(hdr_->max_dets));
+            v.image = cv::Mat(rows, cols, type, px, static_cast<size_t>(step));
+        }
+        else {
+            v.image.release();
+        }
+        return true;
+    }
+
+    bool ShmReader::Next(View& v) {
+        for (;;) {
+            const uint64_t pub = Published();
+            if (next_ >= pub) return false;
+            if (pub - next_ > hdr_->slots) {
+                lost_ += pub - hdr_->slots - next_;
+                next_ = pub - hdr_->slots;
+            }
+            const uint64_t n = next_++;
+            if (Get(n, v)) return true;
+            ++lost_;  // overwritten before we got to it
+        }
+    }
+
+    bool ShmReader::Latest(View& v) {
+        for (;;) {
+            const uint64_t pub = Published();
+            if (pub == 0 || pub - 1 < next_) return false;
+            const uint64_t n = pub - 1;
+            if (Get(n, v)) {
+                next_ = n + 1;
+                return true;
+            }
+            if (Published() == pub) return false;  // not being rewritten, just inconsistent
+        }
+    }
+
+    bool ShmReader::Valid(const View& v) const {
+        return SlotAt(v.frame_no).seq.load(std::memory_order_acquire) == 2 * v.frame_no + 2;
+    }
+
+    bool ShmReader::Copy(const View& v, cv::Mat& image) const {
+        if (v.image.empty()) {
+            image.release();
+            return Valid(v);
+        }
+        v.image.copyTo(image);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return Valid(v);
+    }
+
+} // namespace video
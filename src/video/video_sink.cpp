@@ -0,0 +1,37 @@
+#include "video/video_sink.h"
+#include <utility>
+
+#include "common/visualize.h"
+#include "video/ffmpeg_video_source.h"
+
+namespace video {
+
+    bool DrawFrame(const Frame& frame, const std::vector<Det>& dets, const std::string& label, cv::Mat& out) {
+        if (!ToBGR(frame, out)) return false;
+
+        // BGR24: ToBGR hands out the frame's own buffer, which other consumers may still read
+        if (frame.format == PixelFormat::BGR24) out = out.clone();
+
+        DrawDetections(out, dets);
+        if (!label.empty()) {
+            cv::putText(out, label, { 10, 30 }, cv::FONT_HERSHEY_SIMPLEX, 0.8, { 0, 255, 0 }, 2);
+        }
+        return true;
+    }
+
+    WindowSink::WindowSink(std::string title)
+        : title_(std::move(title)) { }
+
+    bool WindowSink::Write(const Frame& frame, const std::vector<Det>& dets, const std::string& label) {
+        if (!created_) {
+            cv::namedWindow(title_, cv::WINDOW_NORMAL);
+            created_ = true;
+        }
+
+        if (DrawFrame(frame, dets, label, vis_)) cv::imshow(title_, vis_);
+
+        const int key = cv::waitKey(1);
+        return !(key == 27 || key == 'q' || key == 'Q');
+    }
+
+} // namespace video
@@ -0,0 +1,158 @@
+// InferEngine persistent IO: RunBound / RunBoundPlanarRGB must not allocate on the heap per frame
+// beyond what ORT itself does for a bare session.Run(IoBinding), and must match Run().
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include "infer/InferEngine.h"
+#include "test_util.h"
+
+namespace {
+
+    std::atomic<long> g_news{ 0 };
+
+} // namespace
+
+// every operator new of the process (ours, OpenCV's, and ORT's if it goes through the global one)
+void* operator new(std::size_t size) {
+    ++g_news;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+    constexpr int kModelW = 64;
+    constexpr int kModelH = 48;
+
+    // Fewest operator new calls seen for one call of fn, after a few warm-up calls
+    long MinAllocs(const std::function<void()>& fn) {
+        for (int i = 0; i < 3; ++i) fn();
+        long best = std::numeric_limits<long>::max();
+        for (int i = 0; i < 20; ++i) {
+            const long before = g_news.load();
+            fn();
+            best = std::min(best, g_news.load() - before);
+        }
+        return best;
+    }
+
+    struct Fixture {
+        test::TempFile model{ ".onnx" };
+        InferEngine engine;
+
+        Fixture()
+            : engine(Options()) {
+            test::WriteReshapeModel(model.Path(), kModelW, kModelH);
+            engine.LoadModel(model.Path().native());
+        }
+
+        static InferEngine::Options Options() {
+            InferEngine::Options o;
+            o.input_w = kModelW;
+            o.input_h = kModelH;
+            o.intra_op_num_threads = 1;
+            o.persistent_io = true;
+            return o;
+        }
+    };
+
+    Fixture& Shared() {
+        static Fixture f;
+        return f;
+    }
+
+    // The same model run through a plain Session + IoBinding: what ORT allocates by itself
+    long BareIoBindingAllocs(const Fixture& f) {
+        Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "infer_alloc_test");
+        Ort::SessionOptions so;
+        so.SetIntraOpNumThreads(1);
+        Ort::Session session(env, f.model.Path().c_str(), so);
+        Ort::MemoryInfo mem = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+
+        const size_t count = static_cast<size_t>(3) * kModelW * kModelH;
+        std::vector<float> in(count, 0.5f), out(count);
+        const int64_t in_shape[4] = { 1, 3, kModelH, kModelW };
+        const int64_t out_shape[3] = { 1, static_cast<int64_t>(count) / 6, 6 };
+        Ort::Value in_v = Ort::Value::CreateTensor<float>(mem, in.data(), in.size(), in_shape, 4);
+        Ort::Value out_v = Ort::Value::CreateTensor<float>(mem, out.data(), out.size(), out_shape, 3);
+
+        Ort::IoBinding binding(session);
+        binding.BindInput("images", in_v);
+        binding.BindOutput("out", out_v);
+        Ort::RunOptions run_opt;
+        return MinAllocs([&] { session.Run(run_opt, binding); });
+    }
+
+    bool SameFloats(const Ort::Value& a, const Ort::Value& b) {
+        const size_t n = a.GetTensorTypeAndShapeInfo().GetElementCount();
+        return n == b.GetTensorTypeAndShapeInfo().GetElementCount()
+            && std::memcmp(a.GetTensorData<float>(), b.GetTensorData<float>(), n * sizeof(float)) == 0;
+    }
+
+    cv::Mat Frame() {
+        cv::Mat bgr(720, 1280, CV_8UC3, cv::Scalar(30, 120, 210));
+        cv::rectangle(bgr, cv::Rect(100, 80, 400, 300), cv::Scalar(250, 10, 90), cv::FILLED);
+        return bgr;
+    }
+
+} // namespace
+
+TEST_CASE(RunBoundAddsNoAllocations) {
+    Fixture& f = Shared();
+    const cv::Mat bgr = Frame();
+    const long baseline = BareIoBindingAllocs(f);
+    const long bound = MinAllocs([&] { f.engine.RunBound(bgr); });
+    const long run = MinAllocs([&] { f.engine.Run(bgr); });
+    std::cout << "operator new per frame: bare IoBinding " << baseline << ", RunBound " << bound
+        << ", Run " << run << "\n";
+    CHECK(bound <= baseline);
+    CHECK(run > bound);  // Run returns fresh outputs every call
+}
+
+TEST_CASE(RunBoundPlanarAddsNoAllocations) {
+    Fixture& f = Shared();
+    const cv::Mat planes(3 * kModelH, kModelW, CV_8UC1, cv::Scalar(114));
+    LetterBoxInfo lb;
+    lb.scale = 0.05f;
+    lb.dst_w = kModelW;
+    lb.dst_h = kModelH;
+    const long baseline = BareIoBindingAllocs(f);
+    const long bound = MinAllocs([&] { f.engine.RunBoundPlanarRGB(planes, lb, 1280, 720); });
+    CHECK(bound <= baseline);
+}
+
+TEST_CASE(RunBoundMatchesRun) {
+    Fixture& f = Shared();
+    const cv::Mat bgr = Frame();
+    const InferResult run = f.engine.Run(bgr);
+    const InferResult& bound = f.engine.RunBound(bgr);
+    CHECK_EQ(bound.outputs.size(), run.outputs.size());
+    CHECK(SameFloats(bound.outputs[0], run.outputs[0]));
+    CHECK_EQ(bound.lb.pad_y, run.lb.pad_y);
+    CHECK_EQ(bound.orig_w, 1280);
+
+    cv::Mat planes(3 * kModelH, kModelW, CV_8UC1);
+    for (int y = 0; y < planes.rows; ++y) {
+        for (int x = 0; x < planes.cols; ++x) planes.at<uint8_t>(y, x) = static_cast<uint8_t>(x * 3 + y);
+    }
+    InferEngine::PreparedInput in;
+    f.engine.PreprocessPlanarRGB(planes, run.lb, 1280, 720, in);
+    const InferResult prepared = f.engine.RunPrepared(in);
+    const InferResult& bound_planar = f.engine.RunBoundPlanarRGB(planes, run.lb, 1280, 720);
+    CHECK(SameFloats(bound_planar.outputs[0], prepared.outputs[0]));
+}
+
+int main() {
+    return test::RunAll();
+}
@@ -0,0 +1,126 @@
+// LetterboxToCHWFloat01_RGB must be bit-exact against the reference path
+// LetterboxBGR (cv::resize + copyMakeBorder) + BGRToCHWFloat01_RGB.
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "infer/letterbox_chw.h"
+#include "test_util.h"
+
+namespace {
+
+    cv::Mat RandomBGR(int w, int h, std::mt19937& rng) {
+        cv::Mat m(h, w, CV_8UC3);
+        std::uniform_int_distribution<int> px(0, 255);
+        for (int y = 0; y < h; ++y) {
+            uint8_t* row = m.ptr<uint8_t>(y);
+            for (int x = 0; x < w * 3; ++x) row[x] = static_cast<uint8_t>(px(rng));
+        }
+        // smooth areas next to noise: both the blend and the rounding get exercised
+        cv::rectangle(m, cv::Rect(w / 4, h / 4, std::max(1, w / 3), std::max(1, h / 3)), cv::Scalar(10, 128, 250), cv::FILLED);
+        return m;
+    }
+
+    // Compares both paths on src; returns the number of differing floats (-1: letterbox info differs)
+    long Compare(const cv::Mat& src, int dst_w, int dst_h) {
+        LetterBoxInfo ref_lb;
+        const cv::Mat boxed = LetterboxBGR(src, dst_w, dst_h, ref_lb);
+        std::vector<float> ref(3 * boxed.total());  // the reference wants a preallocated buffer
+        BGRToCHWFloat01_RGB(boxed, ref);
+
+        LetterBoxInfo lb;
+        std::vector<float> got(static_cast<size_t>(3) * dst_w * dst_h, -1.0f);
+        LetterboxToCHWFloat01_RGB(src, dst_w, dst_h, got.data(), lb);
+
+        if (lb.scale != ref_lb.scale || lb.pad_x != ref_lb.pad_x || lb.pad_y != ref_lb.pad_y
+            || lb.dst_w != ref_lb.dst_w || lb.dst_h != ref_lb.dst_h || ref.size() != got.size()) {
+            return -1;
+        }
+        long bad = 0;
+        for (size_t i = 0; i < got.size(); ++i) {
+            if (std::memcmp(&got[i], &ref[i], sizeof(float)) != 0) ++bad;
+        }
+        return bad;
+    }
+
+    void CheckSize(int src_w, int src_h, int dst_w, int dst_h, std::mt19937& rng) {
+        const cv::Mat src = RandomBGR(src_w, src_h, rng);
+        const long bad = Compare(src, dst_w, dst_h);
+        if (bad != 0) {
+            test::Fail(__FILE__, __LINE__, std::to_string(src_w) + "x" + std::to_string(src_h) + " -> "
+                + std::to_string(dst_w) + "x" + std::to_string(dst_h) + ": "
+                + (bad < 0 ? std::string("letterbox info differs") : std::to_string(bad) + " floats differ"));
+        }
+    }
+
+} // namespace
+
+TEST_CASE(CameraResolutions) {
+    std::mt19937 rng(1);
+    const int src[][2] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 }, { 720, 1280 }, { 704, 576 } };
+    const int dst[][2] = { { 640, 640 }, { 640, 384 }, { 320, 320 } };
+    for (const auto& s : src) {
+        for (const auto& d : dst) CheckSize(s[0], s[1], d[0], d[1], rng);
+    }
+}
+
+TEST_CASE(ExactHalfUsesAreaPath) {
+    // exactly 2x down on both axes: cv::resize(INTER_LINEAR) takes its INTER_AREA branch
+    std::mt19937 rng(2);
+    CheckSize(1280, 1280, 640, 640, rng);
+    CheckSize(1280, 768, 640, 384, rng);
+    CheckSize(640, 640, 320, 320, rng);
+}
+
+TEST_CASE(OddSizes) {
+    std::mt19937 rng(3);
+    const int src[][2] = { { 1, 1 }, { 3, 2 }, { 17, 9 }, { 333, 777 }, { 641, 479 }, { 1279, 719 }, { 1921, 1081 } };
+    for (const auto& s : src) {
+        CheckSize(s[0], s[1], 640, 640, rng);
+        CheckSize(s[0], s[1], 319, 241, rng);
+    }
+}
+
+TEST_CASE(Upscale) {
+    std::mt19937 rng(4);
+    CheckSize(320, 240, 640, 640, rng);
+    CheckSize(160, 90, 640, 384, rng);
+    CheckSize(640, 640, 640, 640, rng);  // scale 1: plain copy
+}
+
+TEST_CASE(NonContinuousRoi) {
+    // ROI views (e.g. TiledInfer tiles) have a row stride larger than their width
+    std::mt19937 rng(5);
+    const cv::Mat frame = RandomBGR(3840, 2160, rng);
+    const cv::Rect rois[] = {
+        { 0, 0, 640, 640 }, { 1001, 503, 777, 333 }, { 3840 - 1281, 2160 - 721, 1281, 721 },
+        { 7, 9, 1280, 1280 }, { 100, 100, 1, 1 },
+    };
+    for (const cv::Rect& r : rois) {
+        const cv::Mat view = frame(r);
+        CHECK(!view.isContinuous() || view.rows == 1);
+        const long bad = Compare(view, 640, 640);
+        if (bad != 0) {
+            test::Fail(__FILE__, __LINE__, "ROI " + std::to_string(r.x) + "," + std::to_string(r.y) + " "
+                + std::to_string(r.width) + "x" + std::to_string(r.height) + ": "
+                + (bad < 0 ? std::string("letterbox info differs") : std::to_string(bad) + " floats differ"));
+        }
+    }
+}
+
+TEST_CASE(PadIsGrey) {
+    std::mt19937 rng(6);
+    const cv::Mat src = RandomBGR(1920, 1080, rng);
+    LetterBoxInfo lb;
+    std::vector<float> chw(static_cast<size_t>(3) * 640 * 640, -1.0f);
+    LetterboxToCHWFloat01_RGB(src, 640, 640, chw.data(), lb);
+    CHECK(lb.pad_y > 0);
+    CHECK_EQ(lb.pad_x, 0);
+    // first row is border in every plane
+    for (int c = 0; c < 3; ++c) CHECK_EQ(chw[static_cast<size_t>(c) * 640 * 640], 114 * (1.0f / 255.0f));
+}
+
+int main() {
+    return test::RunAll();
+}
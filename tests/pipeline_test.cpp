@@ -0,0 +1,235 @@
+// Pipeline / BoundedQueue: frame order, drop accounting per DropPolicy, clean Stop().
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pipeline/bounded_queue.h"
+#include "pipeline/pipeline.h"
+#include "test_util.h"
+
+using namespace pipeline;
+
+namespace {
+
+    constexpr int kModelW = 64;
+    constexpr int kModelH = 48;
+
+    // Synthetic BGR24 frames, 40 ms apart in pts. frames < 0: endless. read_us: time per Read().
+    class FakeSource final : public video::IVideoSource {
+    public:
+        FakeSource(int frames, int read_us)
+            : frames_(frames), read_us_(read_us) { }
+
+        void Open(const std::string&) override { n_ = 0; }
+
+        bool Read(video::Frame& out) override {
+            if (frames_ >= 0 && n_ >= frames_) return false;
+            if (read_us_ > 0) std::this_thread::sleep_for(std::chrono::microseconds(read_us_));
+
+            out = video::Frame();
+            out.format = video::PixelFormat::BGR24;
+            out.width = 80;
+            out.height = 60;
+            out.bgr = cv::Mat(out.height, out.width, CV_8UC3, cv::Scalar(n_ % 256, 100, 200));
+            out.pts_us = static_cast<int64_t>(n_) * 40000;
+            out.wall_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            ++n_;
+            return true;
+        }
+
+        void Close() override { }
+
+    private:
+        const int frames_;
+        const int read_us_;
+        int n_ = 0;
+    };
+
+    struct Engine {
+        test::TempFile model{ ".onnx" };
+        InferEngine engine;
+
+        Engine()
+            : engine(Options()) {
+            test::WriteReshapeModel(model.Path(), kModelW, kModelH);
+            engine.LoadModel(model.Path().native());
+        }
+
+        static InferEngine::Options Options() {
+            InferEngine::Options o;
+            o.input_w = kModelW;
+            o.input_h = kModelH;
+            o.intra_op_num_threads = 1;
+            return o;
+        }
+    };
+
+    Engine& SharedEngine() {
+        static Engine e;  // one session for every case
+        return e;
+    }
+
+    Pipeline::Options AllQueues(DropPolicy drop) {
+        Pipeline::Options o;
+        o.decode_queue = { 2, drop };
+        o.preprocess_queue = { 2, DropPolicy::Block };
+        o.infer_queue = { 2, DropPolicy::Block };
+        o.postprocess_queue = { 2, drop };
+        return o;
+    }
+
+    struct Rendered {
+        std::mutex mu;
+        std::vector<uint64_t> seq;
+        std::vector<int64_t> pts;
+    };
+
+    // Runs n frames through a pipeline whose render sleeps render_ms per frame
+    Pipeline::Stats RunFrames(int n, const Pipeline::Options& opt, int render_ms, Rendered& out) {
+        FakeSource src(n, 0);
+        src.Open("");
+        Pipeline pipe(src, SharedEngine().engine, [&](FramePacket& pkt) {
+            {
+                std::lock_guard<std::mutex> lk(out.mu);
+                out.seq.push_back(pkt.seq);
+                out.pts.push_back(pkt.frame.pts_us);
+            }
+            if (render_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(render_ms));
+            return true;
+        }, opt);
+        pipe.Start();
+        pipe.Wait();
+        return pipe.GetStats();
+    }
+
+    bool StrictlyIncreasing(const std::vector<uint64_t>& v) {
+        for (size_t i = 1; i < v.size(); ++i) {
+            if (v[i] <= v[i - 1]) return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+TEST_CASE(QueueDropOldestKeepsNewest) {
+    BoundedQueue<int> q(QueueOptions{ 2, DropPolicy::DropOldest });
+    for (int i = 0; i < 5; ++i) CHECK(q.Push(i));
+    CHECK_EQ(q.Dropped(), 3u);
+    CHECK_EQ(q.Size(), 2u);
+    int v = -1;
+    CHECK(q.Pop(v));
+    CHECK_EQ(v, 3);
+    CHECK(q.Pop(v));
+    CHECK_EQ(v, 4);
+}
+
+TEST_CASE(QueueDropNewestKeepsOldest) {
+    BoundedQueue<int> q(QueueOptions{ 2, DropPolicy::DropNewest });
+    for (int i = 0; i < 5; ++i) CHECK(q.Push(i));  // a dropped item still counts as success
+    CHECK_EQ(q.Dropped(), 3u);
+    int v = -1;
+    CHECK(q.Pop(v));
+    CHECK_EQ(v, 0);
+    CHECK(q.Pop(v));
+    CHECK_EQ(v, 1);
+}
+
+TEST_CASE(QueueBlockWaitsAndCloseWakes) {
+    BoundedQueue<int> q(QueueOptions{ 1, DropPolicy::Block });
+    CHECK(q.Push(0));
+
+    std::atomic<bool> pushed{ false };
+    std::thread producer([&] { pushed = q.Push(1); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!pushed);  // still waiting for room
+
+    int v = -1;
+    CHECK(q.Pop(v));
+    CHECK_EQ(v, 0);
+    producer.join();
+    CHECK(pushed);
+    CHECK_EQ(q.Dropped(), 0u);
+
+    // a producer blocked on a full queue fails once it is closed; the rest drains
+    std::atomic<int> result{ -1 };
+    std::thread blocked([&] { result = q.Push(2) ? 1 : 0; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    q.Close();
+    blocked.join();
+    CHECK_EQ(result.load(), 0);
+    CHECK(q.Pop(v));
+    CHECK_EQ(v, 1);
+    CHECK(!q.Pop(v));
+}
+
+TEST_CASE(PipelineBlockIsLosslessAndOrdered) {
+    Rendered r;
+    const Pipeline::Stats s = RunFrames(50, AllQueues(DropPolicy::Block), 1, r);
+    CHECK_EQ(s.decoded, 50u);
+    CHECK_EQ(s.rendered, 50u);
+    CHECK_EQ(s.dropped, 0u);
+    CHECK_EQ(r.seq.size(), 50u);
+    for (size_t i = 0; i < r.seq.size(); ++i) {
+        CHECK_EQ(r.seq[i], i);
+        CHECK_EQ(r.pts[i], static_cast<int64_t>(i) * 40000);
+    }
+}
+
+TEST_CASE(PipelineDropOldestCountsEveryDrop) {
+    Rendered r;
+    const Pipeline::Stats s = RunFrames(100, AllQueues(DropPolicy::DropOldest), 5, r);
+    CHECK_EQ(s.decoded, 100u);
+    CHECK(s.dropped > 0);
+    CHECK_EQ(s.rendered + s.dropped, s.decoded);  // every frame is either rendered or counted
+    CHECK(StrictlyIncreasing(r.seq));
+    CHECK(!r.seq.empty() && r.seq.back() == 99u);  // the newest frame always gets through
+}
+
+TEST_CASE(PipelineDropNewestCountsEveryDrop) {
+    Rendered r;
+    const Pipeline::Stats s = RunFrames(100, AllQueues(DropPolicy::DropNewest), 5, r);
+    CHECK_EQ(s.decoded, 100u);
+    CHECK(s.dropped > 0);
+    CHECK_EQ(s.rendered + s.dropped, s.decoded);
+    CHECK(StrictlyIncreasing(r.seq));
+    CHECK(!r.seq.empty() && r.seq.front() == 0u);  // the oldest frame is never rejected
+}
+
+TEST_CASE(PipelineStopsCleanly) {
+    FakeSource src(-1, 2000);  // live source that never ends
+    src.Open("");
+    std::atomic<uint64_t> rendered{ 0 };
+    Pipeline pipe(src, SharedEngine().engine, [&](FramePacket&) {
+        ++rendered;
+        return true;
+    });
+    pipe.Start();
+    while (rendered < 10) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    const auto t0 = std::chrono::steady_clock::now();
+    pipe.Stop();
+    pipe.Wait();  // no exception: Stop() is not an error
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    CHECK(ms < 1000.0);
+
+    const Pipeline::Stats s = pipe.GetStats();
+    CHECK(s.rendered >= 10);
+    CHECK(s.rendered + s.dropped <= s.decoded);  // frames in flight at Stop() are neither
+}
+
+TEST_CASE(PipelineRenderFalseStops) {
+    FakeSource src(-1, 1000);
+    src.Open("");
+    int calls = 0;
+    Pipeline pipe(src, SharedEngine().engine, [&](FramePacket&) { return ++calls < 5; });
+    pipe.Start();
+    pipe.Wait();
+    CHECK_EQ(calls, 5);
+}
+
+int main() {
+    return test::RunAll();
+}
@@ -0,0 +1,186 @@
+// PostprocessRTDETR must give bit-identical detections to the plain per-query loop it replaced
+// (argmax, sigmoid, threshold, (x * W - pad) / scale, clamp), for any letterbox.
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "infer/postprocess_rtdetr.h"
+#include "test_util.h"
+
+namespace {
+
+    // The scalar reference, operation for operation
+    std::vector<Det> Reference(const float* out, int64_t num_queries, int64_t dim,
+        int input_w, int input_h, const LetterBoxInfo& lb, int orig_w, int orig_h,
+        const PostprocessOptions& opt) {
+        std::vector<Det> dets;
+        const int class_count = static_cast<int>(dim - 4);
+        const float W = static_cast<float>(input_w);
+        const float H = static_cast<float>(input_h);
+
+        for (int64_t q = 0; q < num_queries; ++q) {
+            const float* row = out + q * dim;
+            const float cx = row[0], cy = row[1], bw = row[2], bh = row[3];
+
+            int best_id = -1;
+            float best_logit = -1e9f;
+            for (int c = 0; c < class_count; ++c) {
+                if (row[4 + c] > best_logit) { best_logit = row[4 + c]; best_id = c; }
+            }
+            const float score = opt.apply_sigmoid ? 1.0f / (1.0f + std::exp(-best_logit)) : best_logit;
+            if (score < opt.score_thresh) continue;
+
+            float x1 = (cx - bw * 0.5f) * W;
+            float y1 = (cy - bh * 0.5f) * H;
+            float x2 = (cx + bw * 0.5f) * W;
+            float y2 = (cy + bh * 0.5f) * H;
+
+            x1 = (x1 - static_cast<float>(lb.pad_x)) / lb.scale;
+            y1 = (y1 - static_cast<float>(lb.pad_y)) / lb.scale;
+            x2 = (x2 - static_cast<float>(lb.pad_x)) / lb.scale;
+            y2 = (y2 - static_cast<float>(lb.pad_y)) / lb.scale;
+
+            x1 = std::max(0.0f, std::min(x1, static_cast<float>(orig_w - 1)));
+            y1 = std::max(0.0f, std::min(y1, static_cast<float>(orig_h - 1)));
+            x2 = std::max(0.0f, std::min(x2, static_cast<float>(orig_w - 1)));
+            y2 = std::max(0.0f, std::min(y2, static_cast<float>(orig_h - 1)));
+            if (x2 <= x1 || y2 <= y1) continue;
+
+            dets.push_back({ x1, y1, x2, y2, best_id, score });
+        }
+        return dets;
+    }
+
+    // Letterbox of an orig_w x orig_h frame into input_w x input_h, as LetterboxBGR computes it
+    LetterBoxInfo Letterbox(int orig_w, int orig_h, int input_w, int input_h) {
+        LetterBoxInfo lb;
+        lb.scale = std::min(static_cast<float>(input_w) / orig_w, static_cast<float>(input_h) / orig_h);
+        const int new_w = static_cast<int>(std::round(orig_w * lb.scale));
+        const int new_h = static_cast<int>(std::round(orig_h * lb.scale));
+        lb.pad_x = (input_w - new_w) / 2;
+        lb.pad_y = (input_h - new_h) / 2;
+        lb.dst_w = input_w;
+        lb.dst_h = input_h;
+        return lb;
+    }
+
+    bool SameBits(float a, float b) { return std::memcmp(&a, &b, sizeof(float)) == 0; }
+
+    // Counts the detections that differ from the reference in any bit
+    int Mismatches(const std::vector<Det>& got, const std::vector<Det>& want) {
+        if (got.size() != want.size()) return static_cast<int>(std::max(got.size(), want.size()));
+        int bad = 0;
+        for (size_t i = 0; i < got.size(); ++i) {
+            const Det& a = got[i];
+            const Det& b = want[i];
+            if (!SameBits(a.x1, b.x1) || !SameBits(a.y1, b.y1) || !SameBits(a.x2, b.x2) || !SameBits(a.y2, b.y2)
+                || a.class_id != b.class_id || !SameBits(a.score, b.score)) {
+                ++bad;
+            }
+        }
+        return bad;
+    }
+
+    std::vector<float> RandomRows(std::mt19937& rng, int64_t queries, int64_t dim) {
+        std::uniform_real_distribution<float> box(0.0f, 1.0f);
+        std::uniform_real_distribution<float> logit(-6.0f, 4.0f);
+        std::vector<float> out(static_cast<size_t>(queries * dim));
+        for (int64_t q = 0; q < queries; ++q) {
+            float* row = out.data() + q * dim;
+            row[0] = box(rng);
+            row[1] = box(rng);
+            row[2] = box(rng) * 0.5f;
+            row[3] = box(rng) * 0.5f;
+            for (int64_t c = 4; c < dim; ++c) row[c] = logit(rng);
+        }
+        return out;
+    }
+
+    const Ort::MemoryInfo& Cpu() {
+        static Ort::MemoryInfo mem = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        return mem;
+    }
+
+} // namespace
+
+TEST_CASE(BoxesMatchScalarReference) {
+    std::mt19937 rng(20240611);
+    const int sizes[][2] = { { 640, 640 }, { 640, 384 }, { 320, 320 } };
+    const int frames[][2] = { { 1920, 1080 }, { 1280, 720 }, { 3840, 2160 }, { 704, 576 }, { 333, 777 }, { 640, 640 } };
+    const int64_t queries = 300;
+
+    int checked = 0;
+    for (const auto& in : sizes) {
+        for (const auto& fr : frames) {
+            for (int64_t dim : { 6, 84 }) {  // 2 / 80 classes
+                for (int apply_sigmoid = 0; apply_sigmoid < 2; ++apply_sigmoid) {
+                    std::vector<float> out = RandomRows(rng, queries, dim);
+                    const int64_t shape[3] = { 1, queries, dim };
+                    Ort::Value v = Ort::Value::CreateTensor<float>(Cpu(), out.data(), out.size(), shape, 3);
+
+                    PostprocessOptions opt;
+                    opt.apply_sigmoid = apply_sigmoid != 0;
+                    opt.score_thresh = opt.apply_sigmoid ? 0.3f : 0.5f;
+                    const LetterBoxInfo lb = Letterbox(fr[0], fr[1], in[0], in[1]);
+
+                    const std::vector<Det> got = PostprocessRTDETR(v, in[0], in[1], lb, fr[0], fr[1], opt);
+                    const std::vector<Det> want = Reference(out.data(), queries, dim, in[0], in[1], lb, fr[0], fr[1], opt);
+                    CHECK(!want.empty());
+                    CHECK_EQ(Mismatches(got, want), 0);
+                    checked += static_cast<int>(want.size());
+                }
+            }
+        }
+    }
+    CHECK(checked > 1000);
+}
+
+TEST_CASE(BatchMatchesScalarReference) {
+    std::mt19937 rng(7);
+    const int64_t queries = 300, dim = 84, batch = 3;
+    std::vector<float> out = RandomRows(rng, queries * batch, dim);
+    const int64_t shape[3] = { batch, queries, dim };
+    Ort::Value v = Ort::Value::CreateTensor<float>(Cpu(), out.data(), out.size(), shape, 3);
+
+    const int frames[3][2] = { { 1920, 1080 }, { 1000, 1000 }, { 720, 1280 } };
+    std::vector<BatchItemInfo> items(batch);
+    for (int i = 0; i < batch; ++i) {
+        items[i].lb = Letterbox(frames[i][0], frames[i][1], 640, 640);
+        items[i].orig_w = frames[i][0];
+        items[i].orig_h = frames[i][1];
+    }
+    PostprocessOptions opt;
+    const auto got = PostprocessRTDETRBatch(v, 640, 640, items, opt);
+    CHECK_EQ(got.size(), static_cast<size_t>(batch));
+    for (int i = 0; i < batch && i < static_cast<int>(got.size()); ++i) {
+        const auto want = Reference(out.data() + i * queries * dim, queries, dim, 640, 640,
+            items[i].lb, items[i].orig_w, items[i].orig_h, opt);
+        CHECK_EQ(Mismatches(got[i], want), 0);
+    }
+}
+
+TEST_CASE(TopKKeepsBestScores) {
+    std::mt19937 rng(3);
+    const int64_t queries = 300, dim = 84;
+    std::vector<float> out = RandomRows(rng, queries, dim);
+    const int64_t shape[3] = { 1, queries, dim };
+    Ort::Value v = Ort::Value::CreateTensor<float>(Cpu(), out.data(), out.size(), shape, 3);
+    const LetterBoxInfo lb = Letterbox(1920, 1080, 640, 640);
+
+    PostprocessOptions opt;
+    opt.score_thresh = 0.2f;
+    std::vector<Det> want = Reference(out.data(), queries, dim, 640, 640, lb, 1920, 1080, opt);
+    opt.top_k = 10;
+    const std::vector<Det> got = PostprocessRTDETR(v, 640, 640, lb, 1920, 1080, opt);
+
+    CHECK(want.size() > 10);
+    CHECK_EQ(got.size(), 10u);
+    std::sort(want.begin(), want.end(), [](const Det& a, const Det& b) { return a.score > b.score; });
+    for (size_t i = 0; i < got.size() && i < want.size(); ++i) CHECK(SameBits(got[i].score, want[i].score));
+}
+
+int main() {
+    return test::RunAll();
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Minimal test harness: no framework dependency, one executable per test file, registered with
+// CTest. A failed CHECK reports and the test goes on; main() returns non-zero on any failure.
+namespace test {
+
+    struct Case {
+        const char* name;
+        void (*fn)();
+    };
+
+    inline std::vector<Case>& Cases() {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    inline int& Failures() {
+        static int n = 0;
+        return n;
+    }
+
+    struct Registrar {
+        Registrar(const char* name, void (*fn)()) { Cases().push_back({ name, fn }); }
+    };
+
+    inline void Fail(const char* file, int line, const std::string& what) {
+        ++Failures();
+        std::cerr << file << ":" << line << ": FAILED " << what << "\n";
+    }
+
+    inline int RunAll() {
+        for (const Case& c : Cases()) {
+            const int before = Failures();
+            try {
+                c.fn();
+            }
+            catch (const std::exception& e) {
+                Fail(c.name, 0, std::string("exception: ") + e.what());
+            }
+            std::cout << (Failures() == before ? "[ OK ] " : "[FAIL] ") << c.name << "\n";
+        }
+        return Failures() == 0 ? 0 : 1;
+    }
+
+    // Unique file name in the temp directory, removed again by the destructor
+    class TempFile {
+    public:
+        explicit TempFile(const std::string& suffix) {
+#if defined(_WIN32)
+            const long long pid = _getpid();
+#else
+            const long long pid = getpid();
+#endif
+            static int seq = 0;
+            path_ = std::filesystem::temp_directory_path()
+                / ("cppinfer_test_" + std::to_string(pid) + "_" + std::to_string(seq++) + suffix);
+        }
+        ~TempFile() {
+            std::error_code ec;
+            std::filesystem::remove(path_, ec);
+        }
+        TempFile(const TempFile&) = delete;
+        TempFile& operator=(const TempFile&) = delete;
+
+        const std::filesystem::path& Path() const { return path_; }
+
+    private:
+        std::filesystem::path path_;
+    };
+
+    // Protobuf wire format, just enough to write an ONNX model
+    class Pb {
+    public:
+        Pb& Int(int field, int64_t v) {
+            Tag(field, 0);
+            Varint(static_cast<uint64_t>(v));
+            return *this;
+        }
+        Pb& Bytes(int field, const std::string& b) {
+            Tag(field, 2);
+            Varint(b.size());
+            s_ += b;
+            return *this;
+        }
+        Pb& Msg(int field, const Pb& m) { return Bytes(field, m.s_); }
+        const std::string& Str() const { return s_; }
+
+    private:
+        void Varint(uint64_t v) {
+            while (v >= 0x80) {
+                s_ += static_cast<char>((v & 0x7f) | 0x80);
+                v >>= 7;
+            }
+            s_ += static_cast<char>(v);
+        }
+        void Tag(int field, int wire) { Varint(static_cast<uint64_t>(field) << 3 | static_cast<unsigned>(wire)); }
+
+        std::string s_;
+    };
+
+    // ValueInfoProto of a float / int64 tensor
+    inline Pb TensorValueInfo(const std::string& name, int elem_type, const std::vector<int64_t>& dims) {
+        Pb shape;
+        for (int64_t d : dims) shape.Msg(1, Pb().Int(1, d));
+        Pb tensor;
+        tensor.Int(1, elem_type).Msg(2, shape);
+        return Pb().Bytes(1, name).Msg(2, Pb().Msg(1, tensor));
+    }
+
+    // Stand-in for an RT-DETR export without a model file in the repo: input "images"
+    // [1,3,h,w] float, output "out" [1, h*w/2, 6] float = the input reshaped, i.e. rows of
+    // cx, cy, w, h and two class logits made of pixel values. Shapes are static, so every
+    // output can be pre-bound. h*w must be even.
+    inline void WriteReshapeModel(const std::filesystem::path& path, int w, int h) {
+        const int64_t shape_values[3] = { 1, -1, 6 };
+        std::string raw(sizeof(shape_values), '\0');
+        std::memcpy(&raw[0], shape_values, sizeof(shape_values));  // little-endian host
+        Pb shape_init;
+        shape_init.Int(1, 3).Int(2, 7 /* INT64 */).Bytes(8, "shape").Bytes(9, raw);
+
+        Pb node;
+        node.Bytes(1, "images").Bytes(1, "shape").Bytes(2, "out").Bytes(3, "reshape").Bytes(4, "Reshape");
+
+        Pb graph;
+        graph.Msg(1, node)
+            .Bytes(2, "cppinfer_test")
+            .Msg(5, shape_init)
+            .Msg(11, TensorValueInfo("images", 1 /* FLOAT */, { 1, 3, h, w }))
+            .Msg(12, TensorValueInfo("out", 1, { 1, static_cast<int64_t>(w) * h / 2, 6 }));
+
+        Pb model;
+        model.Int(1, 7 /* IR version */)
+            .Bytes(2, "cppinfer_test")
+            .Msg(7, graph)
+            .Msg(8, Pb().Bytes(1, "").Int(2, 13 /* opset */));
+
+        std::ofstream f(path, std::ios::binary);
+        f.write(model.Str().data(), static_cast<std::streamsize>(model.Str().size()));
+        if (!f) throw std::runtime_error("cannot write test model " + path.string());
+    }
+
+} // namespace test
+
+#define TEST_CASE(name)                                           \
+    static void name();                                           \
+    static const test::Registrar name##_registrar(#name, name);   \
+    static void name()
+
+#define CHECK(cond)                                               \
+    do {                                                          \
+        if (!(cond)) test::Fail(__FILE__, __LINE__, #cond);       \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                            \
+    do {                                                          \
+        const auto& va_ = (a);                                    \
+        const auto& vb_ = (b);                                    \
+        if (!(va_ == vb_)) {                                      \
+            std::ostringstream os_;                               \
+            os_ << #a " == " #b " (" << va_ << " vs " << vb_ << ")"; \
+            test::Fail(__FILE__, __LINE__, os_.str());            \
+        }                                                         \
+    } while (0)